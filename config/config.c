@@ -160,6 +160,7 @@ Settings config = {
 
     .cache_dir              = NULL,
     .window_thumbnail       = FALSE,
-    .drun_use_desktop_cache = FALSE,
-    .drun_reload_desktop_cache = FALSE
+    .drun_use_desktop_cache = TRUE,
+    .drun_reload_desktop_cache = FALSE,
+    .run_use_path_cache     = TRUE
 };
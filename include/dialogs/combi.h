@@ -46,5 +46,12 @@
 /** #Mode object representing the combi dialog. */
 extern Mode combi_mode;
 
+/**
+ * @param mode The mode to look for.
+ *
+ * @returns TRUE when the (initialized) combi mode combines mode.
+ */
+gboolean combi_mode_has_mode ( const Mode *mode );
+
 /*@}*/
 #endif // ROFI_DIALOG_COMBI_H
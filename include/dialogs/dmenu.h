@@ -42,6 +42,14 @@
  */
 int dmenu_switcher_dialog ( void );
 
+/**
+ * Headless dmenu, filter (and sort) the input against the filter and print the result.
+ * The input is matched by the worker pool while it is read, no display is needed.
+ *
+ * @returns TRUE
+ */
+int dmenu_dump ( void );
+
 /**
  * Print dmenu mode commandline options to stdout, for use in help menu.
  */
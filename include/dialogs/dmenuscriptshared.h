@@ -18,4 +18,15 @@ typedef struct {
  * Updates entry with the parsed values from buffer.
  */
 void dmenuscript_parse_entry_extras ( G_GNUC_UNUSED Mode *sw, DmenuScriptEntry *entry, char *buffer, size_t length );
+
+/**
+ * @param store The store to add the row to.
+ * @param data The unvalidated row.
+ * @param length The length of data.
+ *
+ * Add data as the next row of store, invalid UTF-8 is replaced by the replacement character while copying.
+ *
+ * @returns the index of the row or #ROFI_STRING_STORE_INVALID.
+ */
+uint32_t dmenuscript_append_row ( RofiStringStore *store, const char *data, size_t length );
 #endif // ROFI_DIALOGS_DMENU_SCRIPT_SHARED_H
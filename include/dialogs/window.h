@@ -36,9 +36,18 @@
  */
 #include <config.h>
 #ifdef WINDOW_MODE
+#include <xcb/xcb.h>
 
 extern Mode window_mode;
 extern Mode window_mode_cd;
+
+/**
+ * @param ev The property notify event.
+ *
+ * Apply a property change on the root window or a cached client to the window modes,
+ * so their rows stay current while shown.
+ */
+void window_mode_property_notify ( const xcb_property_notify_event_t *ev );
 #endif // WINDOW_MODE
 /* @}*/
 #endif // ROFI_DIALOG_WINDOW_H
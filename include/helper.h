@@ -137,6 +137,19 @@ int find_arg ( const char * const key );
  * @returns TRUE when matches, FALSE otherwise
  */
 int helper_token_match ( rofi_int_matcher * const *tokens, const char *input );
+
+/**
+ * @param tokens  List of (input) tokens to match.
+ * @param input   The entry to match against.
+ * @param folded  The g_utf8_casefold() of input, or NULL.
+ *
+ * Like helper_token_match(), but case-insensitive tokens are matched against
+ * the folded entry with a case-sensitive regex, so a mode that case-folds its
+ * entries once does not pay for caseless matching on every keystroke.
+ *
+ * @returns TRUE when matches, FALSE otherwise
+ */
+int helper_token_match_folded ( rofi_int_matcher * const *tokens, const char *input, const char *folded );
 /**
  * @param cmd The command to execute.
  *
@@ -167,6 +180,14 @@ void remove_pid_file ( int fd );
  */
 int config_sanity_check ( void );
 
+/**
+ * Parse and check only the matching and sorting configuration.
+ * Unlike #config_sanity_check this does not need a display.
+ *
+ * @returns TRUE when an invalid option was found.
+ */
+int config_sanity_check_filter ( void );
+
 /**
  * @param arg string to parse.
  *
@@ -215,6 +236,17 @@ unsigned int levenshtein ( const char *needle, const glong needlelen, const char
  */
 char * rofi_force_utf8 ( const gchar *data, ssize_t length );
 
+/**
+ * @param data the character array to validate
+ * @param length the length of the data array, or -1 when nul terminated
+ * @param end [out] Set to the first invalid byte, or the end of data. (optional)
+ *
+ * Validate UTF-8 like g_utf8_validate does, but check runs of ASCII characters vectorized.
+ *
+ * @returns TRUE if data is valid UTF-8
+ */
+gboolean rofi_utf8_validate ( const char *data, ssize_t length, const char **end );
+
 /**
  * @param input the char array holding latin text
  * @param length the length of the data array
@@ -316,6 +348,15 @@ gboolean helper_execute_command ( const char *wd, const char *cmd, gboolean run_
  */
 cairo_surface_t *cairo_image_surface_create_from_svg ( const gchar* file, int height );
 
+/**
+ * @param dst The premultiplied output.
+ * @param src The ARGB input, does not need to be aligned.
+ * @param len The number of pixels.
+ *
+ * Premultiply the color channels with alpha for cairo, rounding c * a / 255 to the nearest integer.
+ */
+void rofi_premultiply_argb ( uint32_t *dst, const uint32_t *src, size_t len );
+
 /**
  * Ranges.
  */
@@ -28,6 +28,9 @@
 #ifndef ROFI_HISTORY_H
 #define ROFI_HISTORY_H
 
+#include <stdint.h>
+#include <glib.h>
+
 /**
  * @defgroup HISTORY History
  * @ingroup HELPERS
@@ -67,5 +70,66 @@ void history_remove ( const char *filename, const char *entry ) __attribute__( (
  */
 char ** history_get_list ( const char *filename, unsigned int * length ) __attribute__( ( nonnull ) );
 
+/**
+ * Binary index of a history file, mapped from disk when it is up to date.
+ */
+typedef struct _HistoryIndex   HistoryIndex;
+
+/**
+ * The history of one entry.
+ */
+typedef struct
+{
+    /** Position in the list, 0 is the most used. */
+    unsigned int rank;
+    /** Use count, only meaningful compared to other entries. */
+    int64_t      count;
+    /** Higher is used more recently, 0 if not used since the history was compacted. */
+    int64_t      last_used;
+} HistoryIndexEntry;
+
+/**
+ * @param filename The filename of the history cache.
+ *
+ * Open the index kept next to the history file, it is rebuilt when the
+ * history changed.
+ *
+ * @returns the index, or NULL if there is no history.
+ */
+HistoryIndex * history_index_open ( const char *filename ) __attribute__( ( nonnull ) );
+
+/**
+ * @param index The index to close, can be NULL.
+ *
+ * Free the index, strings returned by it become invalid.
+ */
+void history_index_close ( HistoryIndex *index );
+
+/**
+ * @param index The index, can be NULL.
+ *
+ * @returns the number of entries in the history.
+ */
+unsigned int history_index_get_length ( const HistoryIndex *index );
+
+/**
+ * @param index The index, can be NULL.
+ * @param rank The position in the list.
+ *
+ * @returns the entry, owned by the index, or NULL if rank is out of range.
+ */
+const char * history_index_get_entry ( const HistoryIndex *index, unsigned int rank );
+
+/**
+ * @param index The index, can be NULL.
+ * @param entry The entry to look up.
+ * @param result Filled in when found, can be NULL.
+ *
+ * Look up an entry in constant time.
+ *
+ * @returns TRUE if the entry is in the history.
+ */
+gboolean history_index_lookup ( const HistoryIndex *index, const char *entry, HistoryIndexEntry *result ) __attribute__( ( nonnull ( 2 ) ) );
+
 /*@}*/
 #endif // ROFI_HISTORY_H
@@ -0,0 +1,129 @@
+/*
+ * rofi
+ *
+ * MIT/X11 License
+ * Copyright © 2013-2020 Qball Cow <qball@gmpclient.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef ROFI_DESKTOP_ENTRY_H
+#define ROFI_DESKTOP_ENTRY_H
+
+#include <glib.h>
+
+/**
+ * @defgroup DESKTOPENTRY DesktopEntry
+ * @ingroup HELPERS
+ *
+ * Single pass reader for desktop files, a light-weight replacement for GKeyFile.
+ *
+ * Only the `Desktop Entry` and `Desktop Action` groups are kept. Of the
+ * translated keys only the best match for the current locale is kept, the
+ * other translations are skipped while reading. Values are only unescaped
+ * when they are asked for. The getters follow the GKeyFile getters, but
+ * return NULL or FALSE instead of an error.
+ *
+ * @{
+ */
+
+/** A desktop file read by rofi_desktop_entry_load(). */
+typedef struct _RofiDesktopEntry   RofiDesktopEntry;
+
+/**
+ * @param path  The desktop file to read.
+ * @param error Set when the file cannot be read or is not a valid key file.
+ *
+ * @returns the desktop entry, free with rofi_desktop_entry_free(), or NULL on error.
+ */
+RofiDesktopEntry *rofi_desktop_entry_load ( const char *path, GError **error );
+
+/**
+ * @param de The desktop entry to free (can be NULL).
+ */
+void rofi_desktop_entry_free ( RofiDesktopEntry *de );
+
+/**
+ * @param de    The desktop entry.
+ * @param group The group name.
+ *
+ * @returns TRUE if the group is in the file.
+ */
+gboolean rofi_desktop_entry_has_group ( const RofiDesktopEntry *de, const char *group );
+
+/**
+ * @param de    The desktop entry.
+ * @param group The group name.
+ * @param key   The key name.
+ *
+ * @returns TRUE if the untranslated key is in the group.
+ */
+gboolean rofi_desktop_entry_has_key ( const RofiDesktopEntry *de, const char *group, const char *key );
+
+/**
+ * @param de    The desktop entry.
+ * @param group The group name.
+ * @param key   The key name.
+ *
+ * @returns the unescaped, untranslated, value or NULL. Free with g_free().
+ */
+char *rofi_desktop_entry_get_string ( const RofiDesktopEntry *de, const char *group, const char *key );
+
+/**
+ * @param de    The desktop entry.
+ * @param group The group name.
+ * @param key   The key name.
+ *
+ * @returns the unescaped value for the current locale or NULL. Free with g_free().
+ */
+char *rofi_desktop_entry_get_locale_string ( const RofiDesktopEntry *de, const char *group, const char *key );
+
+/**
+ * @param de     The desktop entry.
+ * @param group  The group name.
+ * @param key    The key name.
+ * @param length Set to the length of the list (can be NULL).
+ *
+ * @returns the untranslated value split on ';' or NULL. Free with g_strfreev().
+ */
+char **rofi_desktop_entry_get_string_list ( const RofiDesktopEntry *de, const char *group, const char *key, gsize *length );
+
+/**
+ * @param de     The desktop entry.
+ * @param group  The group name.
+ * @param key    The key name.
+ * @param length Set to the length of the list (can be NULL).
+ *
+ * @returns the value for the current locale split on ';' or NULL. Free with g_strfreev().
+ */
+char **rofi_desktop_entry_get_locale_string_list ( const RofiDesktopEntry *de, const char *group, const char *key, gsize *length );
+
+/**
+ * @param de    The desktop entry.
+ * @param group The group name.
+ * @param key   The key name.
+ *
+ * @returns the boolean value, FALSE if missing or invalid.
+ */
+gboolean rofi_desktop_entry_get_boolean ( const RofiDesktopEntry *de, const char *group, const char *key );
+
+/*@}*/
+#endif // ROFI_DESKTOP_ENTRY_H
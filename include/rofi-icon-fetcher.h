@@ -39,11 +39,28 @@ uint32_t rofi_icon_fetcher_query ( const char *name, const int size );
 /**
  * @param uid The unique id representing the matching request.
  *
- * If the surface is used, the user should reference the surface.
+ * If the surface is used, the user should reference the surface, the fetcher drops
+ * its own reference to icons that were not used recently.
+ * If the icon is not loaded yet, its request is moved up the queue.
  *
  * @returns the surface with the icon, NULL when not found.
  */
 cairo_surface_t * rofi_icon_fetcher_get ( const uint32_t uid );
 
+/**
+ * Tell the icon fetcher the visible icons changed.
+ * Icons requested after this are loaded before the ones requested earlier,
+ * queued requests that were not repeated since the previous change are cancelled.
+ * A cancelled request is queued again when its icon is requested.
+ */
+void rofi_icon_fetcher_visible_changed ( void );
+
+/**
+ * @param prefetch TRUE if the following requests are for icons that are not visible yet.
+ *
+ * Prefetched icons are loaded after the visible ones.
+ */
+void rofi_icon_fetcher_set_prefetch ( gboolean prefetch );
+
 /* @} */
 #endif // ROFI_ICON_FETCHER_H
@@ -0,0 +1,171 @@
+/*
+ * rofi
+ *
+ * MIT/X11 License
+ * Copyright © 2013-2020 Qball Cow <qball@gmpclient.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+#ifndef ROFI_STRING_STORE_H
+#define ROFI_STRING_STORE_H
+
+#include <stdint.h>
+#include <glib.h>
+
+/**
+ * @defgroup STRINGSTORE StringStore
+ * @ingroup HELPERS
+ *
+ * Append-only store for the (often tens of thousands of) rows a #Mode shows.
+ *
+ * Strings are copied back to back into one anonymous memory reservation, rows
+ * only keep a 32-bit offset and length into it. Pages are committed as the
+ * store grows and the reservation never moves, so the pointers returned stay
+ * valid until the store is freed. Freeing the store releases everything with
+ * a single unmap. Adding rows is not thread-safe, but the strings returned
+ * earlier can be read from other threads while rows are added.
+ *
+ * A row can also be appended in parts, so a caller that transforms the input
+ * (e.g. repairing invalid UTF-8) writes it into the store without a temporary copy.
+ *
+ * Optionally a case-folded copy and/or a collation key of each row is kept in
+ * a parallel column. They are computed once when the row is added, so matching
+ * and sorting do not have to redo it for every row on every keystroke.
+ *
+ * @{
+ */
+
+/** Handle returned when a string could not be added. */
+#define ROFI_STRING_STORE_INVALID    UINT32_MAX
+
+/**
+ * Optional columns kept next to the rows.
+ */
+typedef enum
+{
+    /** Only the rows themselves. */
+    ROFI_STRING_STORE_PLAIN    = 0,
+    /** Keep a g_utf8_casefold() copy of each row. */
+    ROFI_STRING_STORE_CASEFOLD = 1,
+    /** Keep a g_utf8_collate_key() of each row. */
+    ROFI_STRING_STORE_SORT_KEY = 2,
+} RofiStringStoreFlags;
+
+/** Opaque string store. */
+typedef struct _RofiStringStore   RofiStringStore;
+
+/**
+ * @param flags The optional columns to keep.
+ *
+ * Create a new, empty, store.
+ *
+ * @returns a new store, free with rofi_string_store_free().
+ */
+RofiStringStore * rofi_string_store_new ( RofiStringStoreFlags flags );
+
+/**
+ * @param store The store to free (can be NULL).
+ *
+ * Free the store and all the strings in it.
+ */
+void rofi_string_store_free ( RofiStringStore *store );
+
+/**
+ * @param store The store to add to.
+ * @param str   The (valid UTF-8) string to add.
+ * @param len   The length of str, or -1 if it is NUL terminated.
+ *
+ * Copy str into the store as the next row.
+ *
+ * @returns the index of the new row or #ROFI_STRING_STORE_INVALID when the store is full.
+ */
+uint32_t rofi_string_store_append ( RofiStringStore *store, const char *str, gssize len );
+
+/**
+ * @param store The store to add to.
+ * @param str   The (valid UTF-8) part to add.
+ * @param len   The length of str.
+ *
+ * Copy str to the end of the row being appended. The row is added by
+ * rofi_string_store_append_end(), do not call other functions that add rows in between.
+ */
+void rofi_string_store_append_part ( RofiStringStore *store, const char *str, gsize len );
+
+/**
+ * @param store The store to add to.
+ *
+ * Add the parts copied with rofi_string_store_append_part() as the next row.
+ *
+ * @returns the index of the new row or #ROFI_STRING_STORE_INVALID when the store is full.
+ */
+uint32_t rofi_string_store_append_end ( RofiStringStore *store );
+
+/**
+ * @param store The store, with at least one row.
+ *
+ * Remove the last row, its space is reused by the next row.
+ * The string returned for it is no longer valid.
+ */
+void rofi_string_store_pop ( RofiStringStore *store );
+
+/**
+ * @param store The store.
+ *
+ * @returns the number of rows in the store.
+ */
+uint32_t rofi_string_store_get_length ( const RofiStringStore *store );
+
+/**
+ * @param store The store.
+ * @param index The row.
+ *
+ * @returns the NUL terminated row, valid until the store is freed or the row is popped.
+ */
+const char * rofi_string_store_get ( const RofiStringStore *store, uint32_t index );
+
+/**
+ * @param store The store.
+ * @param index The row.
+ *
+ * @returns the length of the row in bytes.
+ */
+uint32_t rofi_string_store_get_size ( const RofiStringStore *store, uint32_t index );
+
+/**
+ * @param store The store, created with #ROFI_STRING_STORE_CASEFOLD.
+ * @param index The row.
+ *
+ * @returns the case-folded row, or NULL if the column is not kept.
+ */
+const char * rofi_string_store_get_casefold ( const RofiStringStore *store, uint32_t index );
+
+/**
+ * @param store The store, created with #ROFI_STRING_STORE_SORT_KEY.
+ * @param index The row.
+ *
+ * @returns the collation key of the row (compare with strcmp), or NULL if the column is not kept.
+ */
+const char * rofi_string_store_get_sort_key ( const RofiStringStore *store, uint32_t index );
+
+/*@}*/
+#endif // ROFI_STRING_STORE_H
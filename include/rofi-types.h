@@ -234,6 +234,8 @@ typedef struct rofi_range_pair
 typedef struct rofi_int_matcher_t
 {
     GRegex   *regex;
+    /** Case-sensitive regex of the case-folded token, NULL if not case-insensitive or a user regex. */
+    GRegex   *folded;
     gboolean invert;
 } rofi_int_matcher;
 
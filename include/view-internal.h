@@ -113,6 +113,8 @@ struct RofiViewState
     int              mouse_seen;
     /** Flag indicating if view needs to be reloaded. */
     int              reload;
+    /** Flag indicating rows got appended to the mode since the last filter. */
+    int              append;
     /** The function to be called when finalizing this view */
     void             ( *finalize )( struct RofiViewState *state );
 
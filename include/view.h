@@ -227,6 +227,13 @@ Mode * rofi_view_get_mode ( RofiViewState *state );
  */
 void rofi_view_hide ( void );
 
+/**
+ * Indicate icons shown in the current view finished loading.
+ * The rows pick up their icon when they are drawn, so unlike #rofi_view_reload this
+ * only queues a redraw of the list, nothing is reloaded or refiltered.
+ */
+void rofi_view_icons_ready ( void );
+
 /**
  * Indicate the current view needs to reload its data.
  * This can only be done when *more* information is available.
@@ -235,6 +242,24 @@ void rofi_view_hide ( void );
  */
 void rofi_view_reload ( void  );
 
+/**
+ * Indicate the mode of the current view appended rows at the end of its list.
+ * Only the new rows are matched against the current filter and merged into the result,
+ * rows that where already filtered are not rescanned.
+ *
+ * Like #rofi_view_reload the update happens 'lazy', if a full reload is pending that wins.
+ */
+void rofi_view_append ( void  );
+
+/**
+ * @param reload TRUE when rows where added or removed, FALSE when only their content changed.
+ *
+ * Indicate the mode of the current view changed its rows in place.
+ * Unlike #rofi_view_reload this is not delayed, the rows are refiltered before the next draw,
+ * so the view never shows indexes the mode no longer has.
+ */
+void rofi_view_rows_changed ( gboolean reload );
+
 /**
  * @param state The handle to the view
  * @param mode The new mode to display
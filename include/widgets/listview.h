@@ -68,6 +68,15 @@ typedef void ( *listview_update_callback )( textbox *tb,icon *ico,  unsigned int
  */
 typedef void ( *listview_mouse_activated_cb )( listview *, gboolean, void * );
 
+/**
+ * @param ico The icon of a row, to get the icon size from.
+ * @param entry The element to prefetch the icon for.
+ * @param udata User data
+ *
+ * Prefetch callback, this is called for elements just outside the visible ones.
+ */
+typedef void ( *listview_prefetch_cb )( icon *ico, unsigned int entry, void *udata );
+
 /**
  * @param parent The widget's parent.
  * @param name The name of the to be created widget.
@@ -190,6 +199,14 @@ void listview_set_scroll_type ( listview *lv, ScrollType type );
  * Set the mouse activated callback.
  */
 void listview_set_mouse_activated_cb ( listview *lv, listview_mouse_activated_cb cb, void *udata );
+/**
+ * @param lv Handler to the listview object
+ * @param cb The callback
+ * @param udata User data
+ *
+ * Set the callback to prefetch icons of the elements around the visible ones.
+ */
+void listview_set_prefetch_cb ( listview *lv, listview_prefetch_cb cb, void *udata );
 /**
  * @param lv Handler to the listview object
  * @param enable boolean to enable/disable multi-select
@@ -59,6 +59,26 @@ xcb_window_t xcb_stuff_get_root_window ( void );
  */
 char* window_get_text_prop ( xcb_window_t w, xcb_atom_t atom );
 
+/**
+ * @param w The xcb_window_t to read property from.
+ * @param atom The property identifier
+ *
+ * Send the request for a text property without waiting for the reply, so
+ * several requests can be in flight in one round trip.
+ *
+ * @returns the cookie to pass to window_get_text_prop_reply()
+ */
+xcb_get_property_cookie_t window_get_text_prop_cookie ( xcb_window_t w, xcb_atom_t atom );
+
+/**
+ * @param c The cookie returned by window_get_text_prop_cookie()
+ *
+ * Wait for the reply of a text property request and convert it to utf8.
+ *
+ * @returns a newly allocated string with the result or NULL
+ */
+char* window_get_text_prop_reply ( xcb_get_property_cookie_t c );
+
 /**
  * @param w The xcb_window_t to set property on
  * @param prop Atom of the property to change
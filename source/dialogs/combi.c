@@ -297,6 +297,17 @@ static char * combi_preprocess_input ( Mode *sw, const char *input )
     return g_strdup ( input );
 }
 
+gboolean combi_mode_has_mode ( const Mode *mode )
+{
+    const CombiModePrivateData *pd = (const CombiModePrivateData *) mode_get_private_data ( &combi_mode );
+    for ( unsigned int i = 0; pd != NULL && i < pd->num_switchers; i++ ) {
+        if ( pd->switchers[i].mode == mode ) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
 Mode combi_mode =
 {
     .name               = "combi",
@@ -42,6 +42,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <poll.h>
 #include "rofi.h"
 #include "settings.h"
 #include "widgets/textbox.h"
@@ -49,7 +50,9 @@
 #include "helper.h"
 #include "xrmoptions.h"
 #include "view.h"
+#include "theme.h"
 #include "rofi-icon-fetcher.h"
+#include "rofi-string-store.h"
 
 #include "dialogs/dmenuscriptshared.h"
 
@@ -73,6 +76,17 @@ static inline void bittoggle ( uint32_t *array, unsigned int index )
     *v ^= 1 << bit;
 }
 
+/**
+ * Slot in the open addressing table used to de-duplicate rows.
+ */
+typedef struct
+{
+    /** Hash of the row. */
+    uint32_t hash;
+    /** Index of the row + 1, 0 if the slot is empty. */
+    uint32_t index;
+} DmenuDedupSlot;
+
 typedef struct
 {
     /** Settings */
@@ -91,6 +105,8 @@ typedef struct
     unsigned int           do_markup;
     // List with entries.
     DmenuScriptEntry         *cmd_list;
+    /** Backing store of the cmd_list entries. */
+    RofiStringStore        *strings;
     unsigned int           cmd_list_real_length;
     unsigned int           cmd_list_length;
     unsigned int           only_selected;
@@ -98,8 +114,24 @@ typedef struct
 
     gchar                  **columns;
     gchar                  *column_separator;
+    /** Regex splitting the columns, NULL if the separator is a single literal character. */
+    GRegex                 *column_regex;
+    /** Columns (1 based) to match against, NULL to match the whole row. */
+    unsigned int           *match_columns;
+    unsigned int           num_match_columns;
+    /** (start, end) byte offsets of the columns of all rows, NULL if columns are not used. */
+    GArray                 *column_bounds;
+    /** Per row the index of its first column in column_bounds. */
+    uint32_t               *column_row;
     gboolean               multi_select;
 
+    /** Table to find duplicate rows, NULL if duplicates are allowed. */
+    DmenuDedupSlot         *dedup_table;
+    /** Size of dedup_table, a power of two. */
+    uint32_t               dedup_size;
+    /** Number of rows dropped as duplicate. */
+    unsigned int           num_duplicates;
+
     GCancellable           *cancel;
     gulong                 cancel_source;
     GInputStream           *input_stream;
@@ -112,12 +144,156 @@ static void async_close_callback ( GObject *source_object, GAsyncResult *res, G_
     g_debug ( "Closing data stream." );
 }
 
+/**
+ * @param column_row The per row index in column_bounds.
+ * @param column_bounds The column (start,end) pairs.
+ * @param index The row.
+ * @param ncols [out] The number of columns of the row.
+ *
+ * @returns the (start,end) pairs of the columns of the row.
+ */
+static inline const uint32_t * dmenu_row_columns ( const uint32_t *column_row, const uint32_t *column_bounds, unsigned int index, unsigned int *ncols )
+{
+    if ( column_row == NULL ) {
+        *ncols = 0;
+        return NULL;
+    }
+    *ncols = column_row[index + 1] - column_row[index];
+    return &( column_bounds[2 * column_row[index]] );
+}
+
+/**
+ * @param pd The dmenu private data.
+ * @param entry The row to split.
+ * @param len The length of entry.
+ *
+ * Index the column boundaries of the last added row.
+ */
+static void dmenu_index_columns ( DmenuModePrivateData *pd, const char *entry, gsize len )
+{
+    uint32_t bounds[2] = { 0, 0 };
+    if ( pd->column_regex == NULL ) {
+        const char *iter = entry;
+        const char *sep  = NULL;
+        while ( ( sep = memchr ( iter, pd->column_separator[0], len - ( iter - entry ) ) ) != NULL ) {
+            bounds[0] = iter - entry;
+            bounds[1] = sep - entry;
+            g_array_append_vals ( pd->column_bounds, bounds, 2 );
+            iter = sep + 1;
+        }
+        bounds[0] = iter - entry;
+    }
+    else {
+        GMatchInfo *mi = NULL;
+        g_regex_match_full ( pd->column_regex, entry, len, 0, 0, &mi, NULL );
+        while ( g_match_info_matches ( mi ) ) {
+            gint start, end;
+            if ( g_match_info_fetch_pos ( mi, 0, &start, &end ) && end > start ) {
+                bounds[1] = start;
+                g_array_append_vals ( pd->column_bounds, bounds, 2 );
+                bounds[0] = end;
+            }
+            g_match_info_next ( mi, NULL );
+        }
+        g_match_info_free ( mi );
+    }
+    bounds[1] = len;
+    g_array_append_vals ( pd->column_bounds, bounds, 2 );
+    pd->column_row[pd->cmd_list_length + 1] = pd->column_bounds->len / 2;
+}
+
+/**
+ * @param data The row.
+ * @param len The length of data.
+ *
+ * FNV-1a hash of the row.
+ */
+static inline uint32_t dmenu_dedup_hash ( const char *data, gsize len )
+{
+    uint32_t hash = 2166136261u;
+    for ( gsize i = 0; i < len; i++ ) {
+        hash ^= (unsigned char) data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @param pd The dmenu private data.
+ * @param entry The row about to be added.
+ * @param len The length of entry.
+ * @param hash [out] The hash of entry, to pass to dmenu_dedup_insert.
+ *
+ * Check if entry was seen before. Lookup takes (amortized) constant time.
+ *
+ * @returns TRUE if the row is a duplicate.
+ */
+static gboolean dmenu_dedup_check ( const DmenuModePrivateData *pd, const char *entry, gsize len, uint32_t *hash )
+{
+    *hash = dmenu_dedup_hash ( entry, len );
+    uint32_t pos = *hash & ( pd->dedup_size - 1 );
+    while ( pd->dedup_table[pos].index != 0 ) {
+        const DmenuDedupSlot *slot = &( pd->dedup_table[pos] );
+        if ( slot->hash == *hash && strcmp ( pd->cmd_list[slot->index - 1].entry, entry ) == 0 ) {
+            return TRUE;
+        }
+        pos = ( pos + 1 ) & ( pd->dedup_size - 1 );
+    }
+    return FALSE;
+}
+
+/**
+ * @param pd The dmenu private data.
+ * @param hash The hash of the row just added.
+ *
+ * Remember the last added row (at cmd_list_length) for duplicate lookups.
+ */
+static void dmenu_dedup_insert ( DmenuModePrivateData *pd, uint32_t hash )
+{
+    // Keep the load factor below a half.
+    if ( ( pd->cmd_list_length + 1 ) * 2 > pd->dedup_size ) {
+        uint32_t       old_size  = pd->dedup_size;
+        DmenuDedupSlot *old      = pd->dedup_table;
+        pd->dedup_size  = MAX ( old_size * 2, 1024 );
+        pd->dedup_table = g_malloc0 ( pd->dedup_size * sizeof ( DmenuDedupSlot ) );
+        for ( uint32_t i = 0; i < old_size; i++ ) {
+            if ( old[i].index != 0 ) {
+                uint32_t pos = old[i].hash & ( pd->dedup_size - 1 );
+                while ( pd->dedup_table[pos].index != 0 ) {
+                    pos = ( pos + 1 ) & ( pd->dedup_size - 1 );
+                }
+                pd->dedup_table[pos] = old[i];
+            }
+        }
+        g_free ( old );
+    }
+    uint32_t pos = hash & ( pd->dedup_size - 1 );
+    while ( pd->dedup_table[pos].index != 0 ) {
+        pos = ( pos + 1 ) & ( pd->dedup_size - 1 );
+    }
+    pd->dedup_table[pos].hash  = hash;
+    pd->dedup_table[pos].index = pd->cmd_list_length + 1;
+}
+
+/**
+ * @param pd The dmenu private data.
+ * @param data The row read, ownership is taken.
+ * @param len The length of data.
+ *
+ * Add a row to the list.
+ */
 static void read_add ( DmenuModePrivateData * pd, char *data, gsize len )
 {
     gsize data_len = len;
     if ( ( pd->cmd_list_length + 2 ) > pd->cmd_list_real_length ) {
         pd->cmd_list_real_length = MAX ( pd->cmd_list_real_length * 2, 512 );
         pd->cmd_list             = g_realloc ( pd->cmd_list, ( pd->cmd_list_real_length ) * sizeof ( DmenuScriptEntry ) );
+        if ( pd->column_bounds != NULL ) {
+            pd->column_row = g_realloc ( pd->column_row, ( pd->cmd_list_real_length ) * sizeof ( uint32_t ) );
+            if ( pd->cmd_list_length == 0 ) {
+                pd->column_row[0] = 0;
+            }
+        }
     }
     // Init.
     pd->cmd_list[pd->cmd_list_length].icon_fetch_uid = 0;
@@ -127,9 +303,31 @@ static void read_add ( DmenuModePrivateData * pd, char *data, gsize len )
         data_len = end-data;
         dmenuscript_parse_entry_extras ( NULL, &(pd->cmd_list[pd->cmd_list_length]), end+1, len-data_len);
     }
-    char *utfstr = rofi_force_utf8 ( data, data_len );
-    pd->cmd_list[pd->cmd_list_length].entry      = utfstr;
+    uint32_t index = dmenuscript_append_row ( pd->strings, data, data_len );
+    g_free ( data );
+    if ( index == ROFI_STRING_STORE_INVALID ) {
+        g_free ( pd->cmd_list[pd->cmd_list_length].icon_name );
+        return;
+    }
+    const char *utfstr = rofi_string_store_get ( pd->strings, index );
+    gsize      utflen  = rofi_string_store_get_size ( pd->strings, index );
+    uint32_t   hash    = 0;
+    if ( pd->dedup_table != NULL && dmenu_dedup_check ( pd, utfstr, utflen, &hash ) ) {
+        // Keep the first occurrence only.
+        rofi_string_store_pop ( pd->strings );
+        g_free ( pd->cmd_list[pd->cmd_list_length].icon_name );
+        pd->num_duplicates++;
+        return;
+    }
+    // Pointers into the store stay valid while it grows.
+    pd->cmd_list[pd->cmd_list_length].entry      = (char *) utfstr;
     pd->cmd_list[pd->cmd_list_length + 1].entry  = NULL;
+    if ( pd->column_bounds != NULL ) {
+        dmenu_index_columns ( pd, pd->cmd_list[pd->cmd_list_length].entry, utflen );
+    }
+    if ( pd->dedup_table != NULL ) {
+        dmenu_dedup_insert ( pd, hash );
+    }
 
     pd->cmd_list_length++;
 }
@@ -143,8 +341,7 @@ static void async_read_callback ( GObject *source_object, GAsyncResult *res, gpo
         // Absorb separator, already in buffer so should not block.
         g_data_input_stream_read_byte ( stream, NULL, NULL );
         read_add ( pd, data, len );
-        g_free ( data );
-        rofi_view_reload ();
+        rofi_view_append ();
 
         g_data_input_stream_read_upto_async ( pd->data_input_stream, &( pd->separator ), 1, G_PRIORITY_LOW, pd->cancel,
                                               async_read_callback, pd );
@@ -157,8 +354,8 @@ static void async_read_callback ( GObject *source_object, GAsyncResult *res, gpo
         g_data_input_stream_read_byte ( stream, NULL, &error );
         if (  error == NULL ) {
             // Add empty line.
-            read_add ( pd, "", 0 );
-            rofi_view_reload ();
+            read_add ( pd, g_strdup ( "" ), 0 );
+            rofi_view_append ();
 
             g_data_input_stream_read_upto_async ( pd->data_input_stream, &( pd->separator ), 1, G_PRIORITY_LOW, pd->cancel,
                                                   async_read_callback, pd );
@@ -181,9 +378,88 @@ static void async_read_cancel ( G_GNUC_UNUSED GCancellable *cancel, G_GNUC_UNUSE
     g_debug ( "Cancelled the async read." );
 }
 
-static int get_dmenu_async ( DmenuModePrivateData *pd, int sync_pre_read )
+/**
+ * @param pd The dmenu private data.
+ * @param deadline Monotonic time (in us) to give up waiting.
+ *
+ * Wait until a complete row is buffered, so reading it does not block.
+ * Only reads what is pending on the pipe, a partial row is kept in the buffer.
+ *
+ * @returns FALSE when the deadline passed before a complete row was available.
+ */
+static gboolean dmenu_wait_row ( DmenuModePrivateData *pd, gint64 deadline )
+{
+    GBufferedInputStream *bstream = G_BUFFERED_INPUT_STREAM ( pd->data_input_stream );
+    struct pollfd        pfd      = {
+        .fd     = g_unix_input_stream_get_fd ( G_UNIX_INPUT_STREAM ( pd->input_stream ) ),
+        .events = POLLIN,
+    };
+    while ( TRUE ) {
+        gsize      available = 0;
+        const char *buffer   = g_buffered_input_stream_peek_buffer ( bstream, &available );
+        if ( available > 0 && memchr ( buffer, pd->separator, available ) != NULL ) {
+            return TRUE;
+        }
+        gint64 remaining = deadline - g_get_monotonic_time ();
+        if ( remaining <= 0 ) {
+            return FALSE;
+        }
+        int r = poll ( &pfd, 1, (int) ( ( remaining + 999 ) / 1000 ) );
+        if ( r < 0 && errno == EINTR ) {
+            continue;
+        }
+        if ( r == 0 ) {
+            return FALSE;
+        }
+        if ( r < 0 ) {
+            // Let the read report the error.
+            return TRUE;
+        }
+        // Make room for a row longer than the buffer.
+        gsize size = g_buffered_input_stream_get_buffer_size ( bstream );
+        if ( available == size ) {
+            g_buffered_input_stream_set_buffer_size ( bstream, size * 2 );
+        }
+        // Data (or end of stream) is pending, so this single read does not block.
+        if ( g_buffered_input_stream_fill ( bstream, -1, NULL, NULL ) <= 0 ) {
+            // End of stream or error, the read returns the remainder without blocking.
+            return TRUE;
+        }
+    }
+}
+
+/**
+ * The view does not exist yet when pre-reading, so look up the lines and columns
+ * of the listview in the theme, the same way the listview does when it is created.
+ *
+ * @returns the number of rows on the first page, 0 if the listview shows no rows.
+ */
+static unsigned int dmenu_first_page_rows ( void )
+{
+    ThemeWidget *wid     = rofi_theme_find_widget ( "listview", NULL, FALSE );
+    Property    *lines   = rofi_theme_find_property ( wid, P_INTEGER, "lines", FALSE );
+    Property    *columns = rofi_theme_find_property ( wid, P_INTEGER, "columns", FALSE );
+    int         nlines   = ( lines != NULL && lines->type == P_INTEGER ) ? lines->value.i : (int) config.menu_lines;
+    int         ncolumns = ( columns != NULL && columns->type == P_INTEGER ) ? columns->value.i : (int) config.menu_columns;
+    return MAX ( 0, nlines ) * MAX ( 1, ncolumns );
+}
+
+/**
+ * @param pd The dmenu private data.
+ * @param sync_pre_read Maximum number of rows to read blocking.
+ * @param deadline Monotonic time (in us) to stop pre-reading, 0 to wait for sync_pre_read rows.
+ *
+ * Read the first rows blocking, then switch to async reading.
+ *
+ * @returns FALSE when the input was exhausted while pre-reading.
+ */
+static int get_dmenu_async ( DmenuModePrivateData *pd, int sync_pre_read, gint64 deadline )
 {
     while ( sync_pre_read-- ) {
+        if ( deadline > 0 && !dmenu_wait_row ( pd, deadline ) ) {
+            g_debug ( "First page deadline passed after %u rows.", pd->cmd_list_length );
+            break;
+        }
         gsize len   = 0;
         char  *data = g_data_input_stream_read_upto ( pd->data_input_stream, &( pd->separator ), 1, &len, NULL, NULL );
         if ( data == NULL ) {
@@ -192,7 +468,6 @@ static int get_dmenu_async ( DmenuModePrivateData *pd, int sync_pre_read )
         }
         g_data_input_stream_read_byte ( pd->data_input_stream, NULL, NULL );
         read_add ( pd, data, len );
-        g_free ( data );
     }
     g_data_input_stream_read_upto_async ( pd->data_input_stream, &( pd->separator ), 1, G_PRIORITY_LOW, pd->cancel,
                                           async_read_callback, pd );
@@ -208,7 +483,6 @@ static void get_dmenu_sync ( DmenuModePrivateData *pd )
         }
         g_data_input_stream_read_byte ( pd->data_input_stream, NULL, NULL );
         read_add ( pd, data, len );
-        g_free ( data );
     }
     g_input_stream_close_async ( G_INPUT_STREAM ( pd->input_stream ), G_PRIORITY_LOW, pd->cancel, async_close_callback, pd );
 }
@@ -219,32 +493,34 @@ static unsigned int dmenu_mode_get_num_entries ( const Mode *sw )
     return rmpd->cmd_list_length;
 }
 
-static gchar * dmenu_format_output_string ( const DmenuModePrivateData *pd, const char *input )
+/**
+ * @param pd The dmenu private data.
+ * @param input The row.
+ * @param bounds The column (start,end) pairs of the row.
+ * @param ncols The number of columns of the row.
+ *
+ * @returns the row as it should be displayed.
+ */
+static gchar * dmenu_format_output_string ( const DmenuModePrivateData *pd, const char *input, const uint32_t *bounds, unsigned int ncols )
 {
     if ( pd->columns == NULL ) {
         return g_strdup ( input );
     }
-    char     *retv       = NULL;
-    char     ** splitted = g_regex_split_simple ( pd->column_separator, input, G_REGEX_CASELESS, 00 );
-    uint32_t ns          = 0;
-    for (; splitted && splitted[ns]; ns++ ) {
-        ;
-    }
+    GString *retv = NULL;
     for ( uint32_t i = 0; pd->columns && pd->columns[i]; i++ ) {
         unsigned int index = (unsigned int ) g_ascii_strtoull ( pd->columns[i], NULL, 10 );
-        if ( index < ns && index > 0 ) {
+        if ( index > 0 && index <= ncols ) {
+            const uint32_t *col = &( bounds[2 * ( index - 1 )] );
             if ( retv == NULL ) {
-                retv = g_strdup ( splitted[index - 1] );
+                retv = g_string_new_len ( input + col[0], col[1] - col[0] );
             }
             else {
-                gchar *t = g_strjoin ( "\t", retv, splitted[index - 1], NULL );
-                g_free ( retv );
-                retv = t;
+                g_string_append_c ( retv, '\t' );
+                g_string_append_len ( retv, input + col[0], col[1] - col[0] );
             }
         }
     }
-    g_strfreev ( splitted );
-    return retv ? retv : g_strdup ( "" );
+    return retv ? g_string_free ( retv, FALSE ) : g_strdup ( "" );
 }
 
 static inline unsigned int get_index ( unsigned int length, int index )
@@ -280,7 +556,12 @@ static char *get_display_data ( const Mode *data, unsigned int index, int *state
     if ( pd->do_markup ) {
         *state |= MARKUP;
     }
-    return get_entry ? dmenu_format_output_string ( pd, retv[index].entry ) : NULL;
+    if ( get_entry ) {
+        unsigned int   ncols   = 0;
+        const uint32_t *bounds = dmenu_row_columns ( pd->column_row, pd->column_bounds ? (uint32_t *) pd->column_bounds->data : NULL, index, &ncols );
+        return dmenu_format_output_string ( pd, retv[index].entry, bounds, ncols );
+    }
+    return NULL;
 }
 
 static void dmenu_mode_free ( Mode *sw )
@@ -306,15 +587,28 @@ static void dmenu_mode_free ( Mode *sw )
         }
 
         for ( size_t i = 0; i < pd->cmd_list_length; i++ ) {
-            if ( pd->cmd_list[i].entry ) {
-                g_free ( pd->cmd_list[i].entry );
-                g_free ( pd->cmd_list[i].icon_name );
-            }
+            g_free ( pd->cmd_list[i].icon_name );
         }
         g_free ( pd->cmd_list );
+        rofi_string_store_free ( pd->strings );
         g_free ( pd->urgent_list );
         g_free ( pd->active_list );
         g_free ( pd->selected_list );
+        g_free ( pd->match_columns );
+        if ( pd->dedup_table != NULL ) {
+            g_debug ( "Collapsed %u duplicate rows.", pd->num_duplicates );
+            if ( find_arg ( "-report-duplicates" ) >= 0 ) {
+                fprintf ( stderr, "%u duplicate rows collapsed.\n", pd->num_duplicates );
+            }
+            g_free ( pd->dedup_table );
+        }
+        g_free ( pd->column_row );
+        if ( pd->column_bounds ) {
+            g_array_free ( pd->column_bounds, TRUE );
+        }
+        if ( pd->column_regex ) {
+            g_regex_unref ( pd->column_regex );
+        }
 
         g_free ( pd );
         mode_set_private_data ( sw, NULL );
@@ -352,6 +646,8 @@ static int dmenu_mode_init ( Mode *sw )
 
     pd->separator     = '\n';
     pd->selected_line = UINT32_MAX;
+    // Case-fold the rows once, instead of matching caseless on every keystroke.
+    pd->strings       = rofi_string_store_new ( config.case_sensitive ? ROFI_STRING_STORE_PLAIN : ROFI_STRING_STORE_CASEFOLD );
 
     find_arg_str ( "-mesg", &( pd->message ) );
 
@@ -404,6 +700,12 @@ static int dmenu_mode_init ( Mode *sw )
         char *estr = rofi_expand_path ( str );
         fd = open ( str, O_RDONLY );
         if ( fd < 0 ) {
+            if ( find_arg ( "-dump" ) >= 0 ) {
+                // No display to show the error on.
+                g_warning ( "Failed to open file: %s: %s", estr, g_strerror ( errno ) );
+                g_free ( estr );
+                return FALSE;
+            }
             char *msg = g_markup_printf_escaped ( "Failed to open file: <b>%s</b>:\n\t<i>%s</i>", estr, g_strerror ( errno ) );
             rofi_view_error_dialog ( msg, TRUE );
             g_free ( msg );
@@ -419,22 +721,98 @@ static int dmenu_mode_init ( Mode *sw )
         pd->input_stream      = g_unix_input_stream_new ( fd, fd != STDIN_FILENO );
         pd->data_input_stream = g_data_input_stream_new ( pd->input_stream );
     }
+    if ( find_arg ( "-no-duplicates" ) >= 0 ) {
+        pd->dedup_size  = 1024;
+        pd->dedup_table = g_malloc0 ( pd->dedup_size * sizeof ( DmenuDedupSlot ) );
+    }
     gchar *columns = NULL;
     if ( find_arg_str ( "-display-columns", &columns ) ) {
-        pd->columns          = g_strsplit ( columns, ",", 0 );
+        pd->columns = g_strsplit ( columns, ",", 0 );
+    }
+    columns = NULL;
+    if ( find_arg_str ( "-match-columns", &columns ) ) {
+        gchar **match_columns = g_strsplit ( columns, ",", 0 );
+        pd->match_columns = g_malloc0 ( ( g_strv_length ( match_columns ) + 1 ) * sizeof ( unsigned int ) );
+        for ( unsigned int i = 0; match_columns[i]; i++ ) {
+            unsigned int index = (unsigned int ) g_ascii_strtoull ( match_columns[i], NULL, 10 );
+            if ( index > 0 ) {
+                pd->match_columns[pd->num_match_columns++] = index;
+            }
+        }
+        g_strfreev ( match_columns );
+    }
+    if ( pd->columns != NULL || pd->match_columns != NULL ) {
         pd->column_separator = "\t";
         find_arg_str ( "-display-column-separator", &pd->column_separator );
+        // A single literal character is split with memchr, anything else is a regex.
+        const char *sep = pd->column_separator;
+        if ( !( strlen ( sep ) == 1 && !g_ascii_isalpha ( sep[0] ) && strchr ( "\\^$.|?*+()[]{}", sep[0] ) == NULL ) ) {
+            GError *error = NULL;
+            pd->column_regex = g_regex_new ( sep, G_REGEX_CASELESS | G_REGEX_OPTIMIZE, 0, &error );
+            if ( error != NULL ) {
+                g_warning ( "Invalid column separator: '%s': %s", sep, error->message );
+                g_error_free ( error );
+                pd->column_separator = "\t";
+            }
+        }
+        pd->column_bounds = g_array_new ( FALSE, FALSE, sizeof ( uint32_t ) );
     }
     return TRUE;
 }
 
-static int dmenu_token_match ( const Mode *sw, rofi_int_matcher **tokens, unsigned int index )
+/**
+ * @param pd The dmenu private data.
+ * @param tokens The tokens to match.
+ * @param entry The row to match.
+ * @param folded The case-folded row, or NULL.
+ * @param bounds The column (start,end) pairs of the row.
+ * @param ncols The number of columns of the row.
+ *
+ * Match a row against the tokens, when rows are pango markup the markup is stripped first.
+ * With -match-columns only the selected columns are matched.
+ * This is called from the worker threads.
+ *
+ * @returns TRUE when the row matches.
+ */
+static int dmenu_match_entry ( const DmenuModePrivateData *pd, rofi_int_matcher **tokens, const char *entry, const char *folded, const uint32_t *bounds, unsigned int ncols )
 {
-    DmenuModePrivateData *rmpd = (DmenuModePrivateData *) mode_get_private_data ( sw );
-    if ( rmpd->do_markup) {
+    if ( pd->match_columns != NULL ) {
+        if ( pd->do_markup ) {
+            // Markup can span columns, match the selected columns stripped from markup.
+            GString *str = g_string_new ( "" );
+            for ( unsigned int c = 0; c < pd->num_match_columns; c++ ) {
+                unsigned int index = pd->match_columns[c];
+                if ( index <= ncols ) {
+                    g_string_append_len ( str, entry + bounds[2 * ( index - 1 )], bounds[2 * index - 1] - bounds[2 * ( index - 1 )] );
+                    g_string_append_c ( str, '\t' );
+                }
+            }
+            char *esc = NULL;
+            pango_parse_markup ( str->str, -1, 0, NULL, &esc, NULL, NULL );
+            g_string_free ( str, TRUE );
+            int retv = esc ? helper_token_match ( tokens, esc ) : FALSE;
+            g_free ( esc );
+            return retv;
+        }
+        // Each token has to match in one of the selected columns.
+        int match = TRUE;
+        for ( int j = 0; match && tokens && tokens[j]; j++ ) {
+            match = FALSE;
+            for ( unsigned int c = 0; !match && c < pd->num_match_columns; c++ ) {
+                unsigned int index = pd->match_columns[c];
+                if ( index <= ncols ) {
+                    const uint32_t *col = &( bounds[2 * ( index - 1 )] );
+                    match = g_regex_match_full ( tokens[j]->regex, entry + col[0], col[1] - col[0], 0, 0, NULL, NULL );
+                }
+            }
+            match ^= tokens[j]->invert;
+        }
+        return match;
+    }
+    if ( pd->do_markup) {
         /** Strip out the markup when matching. */
         char *esc = NULL;
-        pango_parse_markup(rmpd->cmd_list[index].entry, -1, 0, NULL, &esc, NULL, NULL);
+        pango_parse_markup(entry, -1, 0, NULL, &esc, NULL, NULL);
         if ( esc ) {
             int retv = helper_token_match ( tokens, esc);
             g_free (esc);
@@ -443,9 +821,17 @@ static int dmenu_token_match ( const Mode *sw, rofi_int_matcher **tokens, unsign
         return FALSE;
 
     } else {
-        return helper_token_match ( tokens, rmpd->cmd_list[index].entry );
+        return helper_token_match_folded ( tokens, entry, folded );
     }
 }
+
+static int dmenu_token_match ( const Mode *sw, rofi_int_matcher **tokens, unsigned int index )
+{
+    DmenuModePrivateData *rmpd = (DmenuModePrivateData *) mode_get_private_data ( sw );
+    unsigned int         ncols   = 0;
+    const uint32_t       *bounds = dmenu_row_columns ( rmpd->column_row, rmpd->column_bounds ? (uint32_t *) rmpd->column_bounds->data : NULL, index, &ncols );
+    return dmenu_match_entry ( rmpd, tokens, rmpd->cmd_list[index].entry, rofi_string_store_get_casefold ( rmpd->strings, index ), bounds, ncols );
+}
 static char *dmenu_get_message ( const Mode *sw )
 {
     DmenuModePrivateData *pd = (DmenuModePrivateData *) mode_get_private_data ( sw );
@@ -629,7 +1015,7 @@ int dmenu_switcher_dialog ( void )
     int                  async      = TRUE;
 
     // For now these only work in sync mode.
-    if ( find_arg ( "-sync" ) >= 0 || find_arg ( "-dump" ) >= 0 || find_arg ( "-select" ) >= 0
+    if ( find_arg ( "-sync" ) >= 0 || find_arg ( "-select" ) >= 0
          || find_arg ( "-no-custom" ) >= 0 || find_arg ( "-only-match" ) >= 0 || config.auto_select ||
          find_arg ( "-selected-row" ) >= 0 ) {
         async = FALSE;
@@ -637,9 +1023,19 @@ int dmenu_switcher_dialog ( void )
     // Check if the subsystem is setup for reading, otherwise do not read.
     if ( pd->cancel != NULL ) {
         if ( async ) {
-            unsigned int pre_read = 25;
+            unsigned int pre_read   = 25;
+            gint64       deadline   = 0;
+            unsigned int first_page = 0;
             find_arg_uint ( "-async-pre-read", &pre_read );
-            async = get_dmenu_async ( pd, pre_read );
+            if ( find_arg_uint ( "-async-first-page", &first_page ) ) {
+                // Read until the visible page is filled or the deadline passed.
+                unsigned int page = dmenu_first_page_rows ();
+                if ( page > 0 ) {
+                    pre_read = page;
+                }
+                deadline = g_get_monotonic_time () + first_page * G_TIME_SPAN_MILLISECOND;
+            }
+            async = get_dmenu_async ( pd, pre_read, deadline );
         }
         else {
             get_dmenu_sync ( pd );
@@ -680,26 +1076,13 @@ int dmenu_switcher_dialog ( void )
         rofi_int_matcher **tokens = helper_tokenize ( select, config.case_sensitive );
         unsigned int     i        = 0;
         for ( i = 0; i < cmd_list_length; i++ ) {
-            if ( helper_token_match ( tokens, cmd_list[i].entry ) ) {
+            if ( helper_token_match_folded ( tokens, cmd_list[i].entry, rofi_string_store_get_casefold ( pd->strings, i ) ) ) {
                 pd->selected_line = i;
                 break;
             }
         }
         helper_tokenize_free ( tokens );
     }
-    if ( find_arg ( "-dump" ) >= 0 ) {
-        rofi_int_matcher **tokens = helper_tokenize ( config.filter ? config.filter : "", config.case_sensitive );
-        unsigned int     i        = 0;
-        for ( i = 0; i < cmd_list_length; i++ ) {
-            if ( tokens == NULL || helper_token_match ( tokens, cmd_list[i].entry ) ) {
-                rofi_output_formatted_line ( pd->format, cmd_list[i].entry , i, config.filter );
-            }
-        }
-        helper_tokenize_free ( tokens );
-        dmenu_mode_free ( &dmenu_mode );
-        g_free ( input );
-        return TRUE;
-    }
     find_arg_str (  "-p", &( dmenu_mode.display_name ) );
     RofiViewState *state = rofi_view_create ( &dmenu_mode, input, menu_flags, dmenu_finalize );
     // @TODO we should do this better.
@@ -712,6 +1095,253 @@ int dmenu_switcher_dialog ( void )
     return FALSE;
 }
 
+/** Number of rows in one headless filter job. */
+#define DMENU_DUMP_BATCH    4096
+
+/**
+ * A batch of rows filtered by a worker thread in headless mode.
+ */
+typedef struct
+{
+    /** Generic thread state. */
+    thread_state               st;
+
+    /** Condition. */
+    GCond                      *cond;
+    /** Lock for condition. */
+    GMutex                     *mutex;
+    /** Outstanding jobs, protected by lock. */
+    unsigned int               *acount;
+
+    /** The dmenu private data (read-only). */
+    const DmenuModePrivateData *pd;
+    /** Tokens to match. */
+    rofi_int_matcher           **tokens;
+    /** Pattern input to sort on. */
+    const char                 *pattern;
+    /** Length of pattern. */
+    glong                      plen;
+
+    /** The rows of this batch, not owned. */
+    char                       **rows;
+    /** The case-folded rows of this batch, not owned, NULL if not kept. */
+    const char                 **folded;
+    /** Copy of the column index of the rows, NULL if columns are not used. */
+    uint32_t                   *column_row;
+    /** Copy of the column (start,end) pairs of the rows. */
+    uint32_t                   *column_bounds;
+    /** Index of the first row. */
+    unsigned int               start;
+    /** Number of rows. */
+    unsigned int               length;
+    /** Index (in the batch) of the matched rows. */
+    unsigned int               *matches;
+    /** Sort distance of the matched rows. */
+    int                        *distance;
+    /** Number of matched rows. */
+    unsigned int               count;
+} DmenuDumpBatch;
+
+static void dmenu_dump_filter_batch ( thread_state *ts, G_GNUC_UNUSED gpointer user_data )
+{
+    DmenuDumpBatch *b = (DmenuDumpBatch *) ts;
+    for ( unsigned int i = 0; i < b->length; i++ ) {
+        unsigned int   ncols   = 0;
+        const uint32_t *bounds = dmenu_row_columns ( b->column_row, b->column_bounds, i, &ncols );
+        const char     *folded = b->folded ? b->folded[i] : NULL;
+        if ( b->tokens != NULL && !dmenu_match_entry ( b->pd, b->tokens, b->rows[i], folded, bounds, ncols ) ) {
+            continue;
+        }
+        b->matches[b->count] = i;
+        if ( config.sort && b->tokens != NULL ) {
+            // Score on what would be displayed, like the view does.
+            // Without -display-columns that is the row, the scorers ignore case so the folded row will do.
+            char       *str = ( folded != NULL && b->pd->columns == NULL ) ? NULL : dmenu_format_output_string ( b->pd, b->rows[i], bounds, ncols );
+            const char *row = str ? str : folded;
+            glong      slen = g_utf8_strlen ( row, -1 );
+            switch ( config.sorting_method_enum )
+            {
+            case SORT_FZF:
+                b->distance[b->count] = rofi_scorer_fuzzy_evaluate ( b->pattern, b->plen, row, slen );
+                break;
+            case SORT_NORMAL:
+            default:
+                b->distance[b->count] = levenshtein ( b->pattern, b->plen, row, slen );
+                break;
+            }
+            g_free ( str );
+        }
+        b->count++;
+    }
+    g_mutex_lock ( b->mutex );
+    ( *( b->acount ) )--;
+    g_cond_signal ( b->cond );
+    g_mutex_unlock ( b->mutex );
+}
+
+/**
+ * @param pd The dmenu private data.
+ * @param batches The list of batches, newest first.
+ * @param tokens The tokens to match.
+ * @param pattern Pattern to sort on.
+ * @param plen Length of pattern.
+ * @param count Outstanding jobs.
+ * @param mutex Lock for count.
+ * @param cond Condition to signal on count.
+ *
+ * Hand the rows read since the previous batch to the worker pool.
+ *
+ * @returns the updated list of batches.
+ */
+static GList * dmenu_dump_push_batch ( DmenuModePrivateData *pd, GList *batches, rofi_int_matcher **tokens, const char *pattern, glong plen,
+                                       unsigned int *count, GMutex *mutex, GCond *cond )
+{
+    DmenuDumpBatch *last = batches ? (DmenuDumpBatch *) batches->data : NULL;
+    unsigned int   start = last ? ( last->start + last->length ) : 0;
+    if ( start == pd->cmd_list_length ) {
+        return batches;
+    }
+    DmenuDumpBatch *b = g_malloc0 ( sizeof ( DmenuDumpBatch ) );
+    b->st.callback = dmenu_dump_filter_batch;
+    b->cond        = cond;
+    b->mutex       = mutex;
+    b->acount      = count;
+    b->pd          = pd;
+    b->tokens      = tokens;
+    b->pattern     = pattern;
+    b->plen        = plen;
+    b->start       = start;
+    b->length      = pd->cmd_list_length - start;
+    // cmd_list gets re-allocated while the worker runs, copy the row pointers.
+    b->rows = g_malloc ( b->length * sizeof ( char* ) );
+    for ( unsigned int i = 0; i < b->length; i++ ) {
+        b->rows[i] = pd->cmd_list[start + i].entry;
+    }
+    if ( rofi_string_store_get_casefold ( pd->strings, 0 ) != NULL ) {
+        b->folded = g_malloc ( b->length * sizeof ( char* ) );
+        for ( unsigned int i = 0; i < b->length; i++ ) {
+            b->folded[i] = rofi_string_store_get_casefold ( pd->strings, start + i );
+        }
+    }
+    if ( pd->column_bounds != NULL ) {
+        uint32_t first = pd->column_row[start];
+        b->column_row = g_malloc ( ( b->length + 1 ) * sizeof ( uint32_t ) );
+        for ( unsigned int i = 0; i <= b->length; i++ ) {
+            b->column_row[i] = pd->column_row[start + i] - first;
+        }
+        b->column_bounds = g_memdup ( &g_array_index ( pd->column_bounds, uint32_t, 2 * first ),
+                                      2 * b->column_row[b->length] * sizeof ( uint32_t ) );
+    }
+    b->matches  = g_malloc ( b->length * sizeof ( unsigned int ) );
+    b->distance = g_malloc0 ( b->length * sizeof ( int ) );
+
+    g_mutex_lock ( mutex );
+    ( *count )++;
+    g_mutex_unlock ( mutex );
+    g_thread_pool_push ( tpool, b, NULL );
+    return g_list_prepend ( batches, b );
+}
+
+/**
+ * Sort the matched rows on distance.
+ */
+static int dmenu_dump_sort ( const void *p1, const void *p2, void *arg )
+{
+    const unsigned int *a         = p1;
+    const unsigned int *b         = p2;
+    int                *distances = arg;
+
+    return distances[*a] - distances[*b];
+}
+
+int dmenu_dump ( void )
+{
+    if ( !mode_init ( &dmenu_mode ) ) {
+        rofi_set_return_code ( EXIT_FAILURE );
+        return TRUE;
+    }
+    DmenuModePrivateData *pd = (DmenuModePrivateData *) dmenu_mode.private_data;
+    pd->do_markup = ( find_arg ( "-markup-rows" ) >= 0 );
+
+    gchar            *pattern = mode_preprocess_input ( &dmenu_mode, config.filter ? config.filter : "" );
+    glong            plen     = g_utf8_strlen ( pattern, -1 );
+    rofi_int_matcher **tokens = plen > 0 ? helper_tokenize ( pattern, config.case_sensitive ) : NULL;
+
+    GList            *batches = NULL;
+    GCond            cond;
+    GMutex           mutex;
+    unsigned int     count = 0;
+    g_mutex_init ( &mutex );
+    g_cond_init ( &cond );
+
+    // Filter the input while it streams in.
+    while ( pd->data_input_stream != NULL ) {
+        gsize len   = 0;
+        char  *data = g_data_input_stream_read_upto ( pd->data_input_stream, &( pd->separator ), 1, &len, NULL, NULL );
+        if ( data == NULL ) {
+            break;
+        }
+        g_data_input_stream_read_byte ( pd->data_input_stream, NULL, NULL );
+        read_add ( pd, data, len );
+        if ( ( pd->cmd_list_length % DMENU_DUMP_BATCH ) == 0 ) {
+            batches = dmenu_dump_push_batch ( pd, batches, tokens, pattern, plen, &count, &mutex, &cond );
+        }
+    }
+    batches = dmenu_dump_push_batch ( pd, batches, tokens, pattern, plen, &count, &mutex, &cond );
+
+    g_mutex_lock ( &mutex );
+    while ( count > 0 ) {
+        g_cond_wait ( &cond, &mutex );
+    }
+    g_mutex_unlock ( &mutex );
+    g_cond_clear ( &cond );
+    g_mutex_clear ( &mutex );
+
+    // Collect the results in input order.
+    unsigned int num_matches = 0;
+    batches = g_list_reverse ( batches );
+    for ( GList *iter = batches; iter != NULL; iter = g_list_next ( iter ) ) {
+        num_matches += ( (DmenuDumpBatch *) iter->data )->count;
+    }
+    unsigned int *line_map = g_malloc ( ( num_matches + 1 ) * sizeof ( unsigned int ) );
+    int          *distance = g_malloc0 ( ( pd->cmd_list_length + 1 ) * sizeof ( int ) );
+    unsigned int j         = 0;
+    for ( GList *iter = batches; iter != NULL; iter = g_list_next ( iter ) ) {
+        DmenuDumpBatch *b = (DmenuDumpBatch *) iter->data;
+        for ( unsigned int i = 0; i < b->count; i++ ) {
+            line_map[j]             = b->start + b->matches[i];
+            distance[line_map[j++]] = b->distance[i];
+        }
+        g_free ( b->rows );
+        g_free ( b->folded );
+        g_free ( b->column_row );
+        g_free ( b->column_bounds );
+        g_free ( b->matches );
+        g_free ( b->distance );
+        g_free ( b );
+    }
+    g_list_free ( batches );
+    if ( config.sort && tokens != NULL ) {
+        g_qsort_with_data ( line_map, num_matches, sizeof ( unsigned int ), dmenu_dump_sort, distance );
+    }
+
+    // Write the result in large blocks.
+    static char buffer[1 << 16];
+    setvbuf ( stdout, buffer, _IOFBF, sizeof ( buffer ) );
+    for ( unsigned int i = 0; i < num_matches; i++ ) {
+        rofi_output_formatted_line ( pd->format, pd->cmd_list[line_map[i]].entry, line_map[i], config.filter );
+    }
+    fflush ( stdout );
+
+    g_free ( line_map );
+    g_free ( distance );
+    g_free ( pattern );
+    helper_tokenize_free ( tokens );
+    mode_destroy ( &dmenu_mode );
+    rofi_set_return_code ( EXIT_SUCCESS );
+    return TRUE;
+}
+
 void print_dmenu_options ( void )
 {
     int is_term = isatty ( fileno ( stdout ) );
@@ -733,5 +1363,10 @@ void print_dmenu_options ( void )
     print_help_msg ( "-input", "[filename]", "Read input from file instead from standard input.", NULL, is_term );
     print_help_msg ( "-sync", "", "Force dmenu to first read all input data, then show dialog.", NULL, is_term );
     print_help_msg ( "-async-pre-read", "[number]", "Read several entries blocking before switching to async mode", "25", is_term );
+    print_help_msg ( "-async-first-page", "[ms]", "Show the window when the first page is read or after [ms] milliseconds", NULL, is_term );
+    print_help_msg ( "-match-columns", "[list]", "Comma separated list of columns to match against", NULL, is_term );
+    print_help_msg ( "-no-duplicates", "", "Only keep the first occurrence of duplicate rows", NULL, is_term );
+    print_help_msg ( "-report-duplicates", "", "With -no-duplicates print the number of collapsed rows on exit", NULL, is_term );
     print_help_msg ( "-w", "windowid", "Position over window with X11 windowid.", NULL, is_term );
+    print_help_msg ( "-dump", "", "Filter (and sort) the input using -filter, print the result and exit. Needs no display.", NULL, is_term );
 }
@@ -37,8 +37,11 @@
 #include <unistd.h>
 #include <limits.h>
 #include <signal.h>
+#include <time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <dirent.h>
 #include <strings.h>
 #include <string.h>
@@ -54,6 +57,7 @@
 #include "xcb.h"
 
 #include "rofi-icon-fetcher.h"
+#include "rofi-desktop-entry.h"
 
 #define DRUN_CACHE_FILE    "rofi3.druncache"
 #define DRUN_DESKTOP_CACHE_FILE    "rofi-drun-desktop.cache"
@@ -61,6 +65,8 @@
 char *DRUN_GROUP_NAME = "Desktop Entry";
 
 typedef struct _DRunModePrivateData DRunModePrivateData;
+/** The mapped desktop cache. */
+typedef struct _DRunCache           DRunCache;
 /**
  * Store extra information about the entry.
  * Currently the executable and if it should run in terminal.
@@ -99,10 +105,11 @@ typedef struct
     /* Comments */
     char            *comment;
 
-    GKeyFile        *key_file;
-
     gint            sort_index;
 
+    /* The strings point into the cache mapping. */
+    gboolean        from_cache;
+
     uint32_t        icon_fetch_uid;
 } DRunModeEntry;
 
@@ -149,6 +156,14 @@ struct _DRunModePrivateData
     const gchar   *icon_theme;
     // DE
     gchar         **current_desktop_list;
+
+    // Mapped cache file, entries loaded from it point into it.
+    DRunCache     *cache;
+    // Directories and files walked, recorded for the cache.
+    GArray        *cache_dirs;
+    GArray        *cache_files;
+    // Something changed since the cache was written.
+    gboolean      cache_dirty;
 };
 
 struct RegexEvalArg
@@ -233,25 +248,18 @@ static void exec_cmd_entry ( DRunModeEntry *e )
         return;
     }
 
-    if ( e->key_file == NULL ) {
-        GKeyFile *kf = g_key_file_new ();
-        GError   *error = NULL;
-        gboolean res    = g_key_file_load_from_file ( kf, e->path, 0, &error );
-        if ( res )
-        {
-            e->key_file = kf;
-        }
-        else {
-            g_warning ( "[%s] [%s] Failed to parse desktop file because: %s.", e->app_id, e->path, error->message );
-            g_error_free ( error );
-            g_key_file_free ( kf );
-
-            return;
-        }
+    // Launch fields are not kept around, read them from the file when activated.
+    GError           *kf_error = NULL;
+    RofiDesktopEntry *de       = rofi_desktop_entry_load ( e->path, &kf_error );
+    if ( de == NULL ) {
+        g_warning ( "[%s] [%s] Failed to parse desktop file because: %s.", e->app_id, e->path, kf_error->message );
+        g_error_free ( kf_error );
+        g_free ( str );
+        return;
     }
 
     const gchar *fp        = g_strstrip ( str );
-    gchar       *exec_path = g_key_file_get_string ( e->key_file, e->action, "Path", NULL );
+    gchar       *exec_path = rofi_desktop_entry_get_string ( de, e->action, "Path" );
     if ( exec_path != NULL && strlen ( exec_path ) == 0 ) {
         // If it is empty, ignore this property. (#529)
         g_free ( exec_path );
@@ -263,14 +271,15 @@ static void exec_cmd_entry ( DRunModeEntry *e )
         .icon   = e->icon_name,
         .app_id = e->app_id,
     };
-    gboolean                 sn       = g_key_file_get_boolean ( e->key_file, e->action, "StartupNotify", NULL );
+    gboolean                 sn       = rofi_desktop_entry_get_boolean ( de, e->action, "StartupNotify" );
     gchar                    *wmclass = NULL;
-    if ( sn && g_key_file_has_key ( e->key_file, e->action, "StartupWMClass", NULL ) ) {
-        context.wmclass = wmclass = g_key_file_get_string ( e->key_file, e->action, "StartupWMClass", NULL );
+    if ( sn && rofi_desktop_entry_has_key ( de, e->action, "StartupWMClass" ) ) {
+        context.wmclass = wmclass = rofi_desktop_entry_get_string ( de, e->action, "StartupWMClass" );
     }
 
     // Returns false if not found, if key not found, we don't want run in terminal.
-    gboolean terminal = g_key_file_get_boolean ( e->key_file, e->action, "Terminal", NULL );
+    gboolean terminal = rofi_desktop_entry_get_boolean ( de, e->action, "Terminal" );
+    rofi_desktop_entry_free ( de );
     if ( helper_execute_command ( exec_path, fp, terminal, sn ? &context : NULL ) ) {
         char *path = g_build_filename ( cache_dir, DRUN_CACHE_FILE, NULL );
         // Store it based on the unique identifiers (desktop_id).
@@ -295,81 +304,94 @@ static gboolean rofi_strv_contains ( const char * const *categories, const char
     return FALSE;
 }
 /**
- * This function absorbs/freeś path, so this is no longer available afterwards.
+ * The outcome of reading a desktop file, kept in the cache to replay it.
+ */
+typedef enum
+{
+    /** Not parsed, an entry with the same id was seen before. */
+    DRUN_FILE_SKIPPED    = 0,
+    /** Not a (supported) application. */
+    DRUN_FILE_INVALID    = 1,
+    /** Hidden application, its id is disabled. */
+    DRUN_FILE_DISABLED   = 2,
+    /** Entries were added. */
+    DRUN_FILE_OK         = 3,
+    /** Mask for the above states. */
+    DRUN_FILE_STATE_MASK = 3,
+    /** The outcome depends on TryExec, so it has to be parsed again. */
+    DRUN_FILE_TRYEXEC    = 4,
+} DRunFileState;
+
+/**
+ * @param root The application directory the file was found in.
+ * @param path The path of the desktop file.
+ * @param id Buffer of at least strlen ( path ) - strlen ( root ) bytes, set to the desktop id.
  */
-static void read_desktop_file ( DRunModePrivateData *pd, const char *root, const char *path, const gchar *basename, const char *action )
+static void drun_desktop_id ( const char *root, const char *path, char *id )
 {
-    int parse_action = ( config.drun_show_actions && action != DRUN_GROUP_NAME );
-    // Create ID on stack.
     // We know strlen (path ) > strlen(root)+1
     const ssize_t id_len = strlen ( path ) - strlen ( root );
-    char          id[id_len];
     g_strlcpy ( id, &( path[strlen ( root ) + 1] ), id_len );
     for ( int index = 0; index < id_len; index++ ) {
         if ( id[index] == '/' ) {
             id[index] = '-';
         }
     }
+}
 
-    // Check if item is on disabled list.
-    if ( g_hash_table_contains ( pd->disabled_entries, id ) && !parse_action ) {
-        g_debug ( "[%s] [%s] Skipping, was previously seen.", id, path );
-        return ;
-    }
-    GKeyFile *kf    = g_key_file_new ();
-    GError   *error = NULL;
-    gboolean res    = g_key_file_load_from_file ( kf, path, 0, &error );
-    // If error, skip to next entry
-    if ( !res ) {
-        g_debug ( "[%s] [%s] Failed to parse desktop file because: %s.", id, path, error->message );
-        g_error_free ( error );
-        g_key_file_free ( kf );
-        return ;
-    }
-
-    if ( g_key_file_has_group ( kf, action ) == FALSE ) {
+/**
+ * @param pd The drun mode data, only read.
+ * @param entries The #DRunModeEntry list to append to.
+ * @param de The desktop file.
+ * @param root The application directory the file was found in.
+ * @param path The path of the desktop file.
+ * @param basename The filename of the desktop file.
+ * @param id The desktop id.
+ * @param action The group to read.
+ *
+ * @returns how the group was handled.
+ */
+static DRunFileState drun_read_desktop_entry ( const DRunModePrivateData *pd, GArray *entries, const RofiDesktopEntry *de,
+                                               const char *root, const char *path, const gchar *basename, const char *id,
+                                               const char *action )
+{
+    if ( rofi_desktop_entry_has_group ( de, action ) == FALSE ) {
         // No type? ignore.
         g_debug ( "[%s] [%s] Invalid desktop file: No %s group", id, path, action );
-        g_key_file_free ( kf );
-        return ;
+        return DRUN_FILE_INVALID;
     }
     // Skip non Application entries.
-    gchar *key = g_key_file_get_string ( kf, DRUN_GROUP_NAME, "Type", NULL );
+    gchar *key = rofi_desktop_entry_get_string ( de, DRUN_GROUP_NAME, "Type" );
     if ( key == NULL ) {
         // No type? ignore.
         g_debug ( "[%s] [%s] Invalid desktop file: No type indicated", id, path );
-        g_key_file_free ( kf );
-        return ;
+        return DRUN_FILE_INVALID;
     }
     if ( g_strcmp0 ( key, "Application" ) ) {
         g_debug ( "[%s] [%s] Skipping desktop file: Not of type application (%s)", id, path, key );
         g_free ( key );
-        g_key_file_free ( kf );
-        return ;
+        return DRUN_FILE_INVALID;
     }
     g_free ( key );
 
     // Name key is required.
-    if ( !g_key_file_has_key ( kf, DRUN_GROUP_NAME, "Name", NULL ) ) {
+    if ( !rofi_desktop_entry_has_key ( de, DRUN_GROUP_NAME, "Name" ) ) {
         g_debug ( "[%s] [%s] Invalid desktop file: no 'Name' key present.", id, path );
-        g_key_file_free ( kf );
-        return ;
+        return DRUN_FILE_INVALID;
     }
 
     // Skip hidden entries.
-    if ( g_key_file_get_boolean ( kf, DRUN_GROUP_NAME, "Hidden", NULL ) ) {
+    if ( rofi_desktop_entry_get_boolean ( de, DRUN_GROUP_NAME, "Hidden" ) ) {
         g_debug ( "[%s] [%s] Adding desktop file to disabled list: 'Hidden' key is true", id, path );
-        g_key_file_free ( kf );
-        g_hash_table_add ( pd->disabled_entries, g_strdup ( id ) );
-        return ;
+        return DRUN_FILE_DISABLED;
     }
     if ( pd->current_desktop_list ) {
         gboolean show = TRUE;
         // If the DE is set, check the keys.
-        if ( g_key_file_has_key ( kf, DRUN_GROUP_NAME, "OnlyShowIn", NULL ) ) {
+        if ( rofi_desktop_entry_has_key ( de, DRUN_GROUP_NAME, "OnlyShowIn" ) ) {
             gsize llength = 0;
             show = FALSE;
-            gchar **list = g_key_file_get_string_list ( kf, DRUN_GROUP_NAME, "OnlyShowIn", &llength, NULL );
+            gchar **list = rofi_desktop_entry_get_string_list ( de, DRUN_GROUP_NAME, "OnlyShowIn", &llength );
             if ( list ) {
                 for ( gsize lcd = 0; !show && pd->current_desktop_list[lcd]; lcd++ ) {
                     for ( gsize lle = 0; !show && lle < llength; lle++ ) {
@@ -379,9 +401,9 @@ static void read_desktop_file ( DRunModePrivateData *pd, const char *root, const
                 g_strfreev ( list );
             }
         }
-        if ( show && g_key_file_has_key ( kf, DRUN_GROUP_NAME, "NotShowIn", NULL ) ) {
+        if ( show && rofi_desktop_entry_has_key ( de, DRUN_GROUP_NAME, "NotShowIn" ) ) {
             gsize llength = 0;
-            gchar **list  = g_key_file_get_string_list ( kf, DRUN_GROUP_NAME, "NotShowIn", &llength, NULL );
+            gchar **list  = rofi_desktop_entry_get_string_list ( de, DRUN_GROUP_NAME, "NotShowIn", &llength );
             if ( list ) {
                 for ( gsize lcd = 0; show && pd->current_desktop_list[lcd]; lcd++ ) {
                     for ( gsize lle = 0; show && lle < llength; lle++ ) {
@@ -394,41 +416,36 @@ static void read_desktop_file ( DRunModePrivateData *pd, const char *root, const
 
         if ( !show ) {
             g_debug ( "[%s] [%s] Adding desktop file to disabled list: 'OnlyShowIn'/'NotShowIn' keys don't match current desktop", id, path );
-            g_key_file_free ( kf );
-            g_hash_table_add ( pd->disabled_entries, g_strdup ( id ) );
-            return ;
+            return DRUN_FILE_DISABLED;
         }
     }
     // Skip entries that have NoDisplay set.
-    if ( g_key_file_get_boolean ( kf, DRUN_GROUP_NAME, "NoDisplay", NULL ) ) {
+    if ( rofi_desktop_entry_get_boolean ( de, DRUN_GROUP_NAME, "NoDisplay" ) ) {
         g_debug ( "[%s] [%s] Adding desktop file to disabled list: 'NoDisplay' key is true", id, path );
-        g_key_file_free ( kf );
-        g_hash_table_add ( pd->disabled_entries, g_strdup ( id ) );
-        return ;
+        return DRUN_FILE_DISABLED;
     }
     // We need Exec, don't support DBusActivatable
-    if ( !g_key_file_has_key ( kf, DRUN_GROUP_NAME, "Exec", NULL ) ) {
+    if ( !rofi_desktop_entry_has_key ( de, DRUN_GROUP_NAME, "Exec" ) ) {
         g_debug ( "[%s] [%s] Unsupported desktop file: no 'Exec' key present.", id, path );
-        g_key_file_free ( kf );
-        return ;
+        return DRUN_FILE_INVALID;
     }
 
-    if ( g_key_file_has_key ( kf, DRUN_GROUP_NAME, "TryExec", NULL ) ) {
-        char *te = g_key_file_get_string ( kf, DRUN_GROUP_NAME, "TryExec", NULL );
+    DRunFileState tryexec = 0;
+    if ( rofi_desktop_entry_has_key ( de, DRUN_GROUP_NAME, "TryExec" ) ) {
+        tryexec = DRUN_FILE_TRYEXEC;
+        char *te = rofi_desktop_entry_get_string ( de, DRUN_GROUP_NAME, "TryExec" );
         if ( !g_path_is_absolute ( te ) ) {
             char *fp = g_find_program_in_path ( te );
             if ( fp == NULL ) {
                 g_free ( te );
-                g_key_file_free ( kf );
-                return ;
+                return DRUN_FILE_INVALID | DRUN_FILE_TRYEXEC;
             }
             g_free ( fp );
         }
         else {
             if ( g_file_test ( te, G_FILE_TEST_IS_EXECUTABLE ) == FALSE ) {
                 g_free ( te );
-                g_key_file_free ( kf );
-                return ;
+                return DRUN_FILE_INVALID | DRUN_FILE_TRYEXEC;
             }
         }
         g_free ( te );
@@ -436,167 +453,116 @@ static void read_desktop_file ( DRunModePrivateData *pd, const char *root, const
 
     char **categories = NULL;
     if ( pd->show_categories ) {
-        categories = g_key_file_get_locale_string_list ( kf, DRUN_GROUP_NAME, "Categories", NULL, NULL, NULL );
+        categories = rofi_desktop_entry_get_locale_string_list ( de, DRUN_GROUP_NAME, "Categories", NULL );
         if (  !rofi_strv_contains( (const char * const *)categories, (const char *const *)pd->show_categories ) ){
             g_strfreev(categories);
-            g_key_file_free ( kf );
-            return ;
+            return DRUN_FILE_INVALID | tryexec;
         }
     }
 
-    size_t nl = ( ( pd->cmd_list_length ) + 1 );
-    if ( nl >= pd->cmd_list_length_actual ) {
-        pd->cmd_list_length_actual += 256;
-        pd->entry_list              = g_realloc ( pd->entry_list, pd->cmd_list_length_actual * sizeof ( *( pd->entry_list ) ) );
-    }
-    // Make sure order is preserved, this will break when cmd_list_length is bigger then INT_MAX.
-    // This is not likely to happen.
-    if ( G_UNLIKELY ( pd->cmd_list_length > INT_MAX ) ) {
-        // Default to smallest value.
-        pd->entry_list[pd->cmd_list_length].sort_index = INT_MIN;
-    }
-    else {
-        pd->entry_list[pd->cmd_list_length].sort_index = -nl;
-    }
-    pd->entry_list[pd->cmd_list_length].icon_size      = 0;
-    pd->entry_list[pd->cmd_list_length].icon_fetch_uid = 0;
-    pd->entry_list[pd->cmd_list_length].root           = g_strdup ( root );
-    pd->entry_list[pd->cmd_list_length].path           = g_strdup ( path );
-    pd->entry_list[pd->cmd_list_length].desktop_id     = g_strdup ( id );
-    pd->entry_list[pd->cmd_list_length].app_id         = g_strndup ( basename, strlen ( basename ) - strlen ( ".desktop" ) );
-    gchar *n = g_key_file_get_locale_string ( kf, DRUN_GROUP_NAME, "Name", NULL, NULL );
+    // The sort index is set when the entries are merged.
+    g_array_set_size ( entries, entries->len + 1 );
+    DRunModeEntry *entry = &g_array_index ( entries, DRunModeEntry, entries->len - 1 );
+    entry->icon_size      = 0;
+    entry->icon_fetch_uid = 0;
+    entry->from_cache     = FALSE;
+    entry->root           = g_strdup ( root );
+    entry->path           = g_strdup ( path );
+    entry->desktop_id     = g_strdup ( id );
+    entry->app_id         = g_strndup ( basename, strlen ( basename ) - strlen ( ".desktop" ) );
+    gchar *n = rofi_desktop_entry_get_locale_string ( de, DRUN_GROUP_NAME, "Name" );
 
     if ( action != DRUN_GROUP_NAME ) {
-        gchar *na = g_key_file_get_locale_string ( kf, action, "Name", NULL, NULL );
+        gchar *na = rofi_desktop_entry_get_locale_string ( de, action, "Name" );
         gchar *l  = g_strdup_printf ( "%s - %s", n, na );
         g_free ( n );
+        g_free ( na );
         n = l;
     }
-    pd->entry_list[pd->cmd_list_length].name   = n;
-    pd->entry_list[pd->cmd_list_length].action = DRUN_GROUP_NAME;
-    gchar *gn = g_key_file_get_locale_string ( kf, DRUN_GROUP_NAME, "GenericName", NULL, NULL );
-    pd->entry_list[pd->cmd_list_length].generic_name = gn;
+    entry->name   = n;
+    entry->action = DRUN_GROUP_NAME;
+    gchar *gn = rofi_desktop_entry_get_locale_string ( de, DRUN_GROUP_NAME, "GenericName" );
+    entry->generic_name = gn;
 
     if ( matching_entry_fields[DRUN_MATCH_FIELD_KEYWORDS].enabled ) {
-            pd->entry_list[pd->cmd_list_length].keywords = g_key_file_get_locale_string_list ( kf, DRUN_GROUP_NAME, "Keywords", NULL, NULL, NULL );
+            entry->keywords = rofi_desktop_entry_get_locale_string_list ( de, DRUN_GROUP_NAME, "Keywords", NULL );
     } else {
-        pd->entry_list[pd->cmd_list_length].keywords = NULL;
+        entry->keywords = NULL;
     }
 
     if ( matching_entry_fields[DRUN_MATCH_FIELD_CATEGORIES].enabled ) {
         if ( categories ) {
-            pd->entry_list[pd->cmd_list_length].categories = categories;
+            entry->categories = categories;
             categories = NULL;
         } else {
-            pd->entry_list[pd->cmd_list_length].categories = g_key_file_get_locale_string_list ( kf, DRUN_GROUP_NAME, "Categories", NULL, NULL, NULL );
+            entry->categories = rofi_desktop_entry_get_locale_string_list ( de, DRUN_GROUP_NAME, "Categories", NULL );
         }
     }
     else {
-        pd->entry_list[pd->cmd_list_length].categories = NULL;
+        entry->categories = NULL;
     }
     g_strfreev(categories);
 
-    pd->entry_list[pd->cmd_list_length].exec = g_key_file_get_string ( kf, action, "Exec", NULL );
+    entry->exec = rofi_desktop_entry_get_string ( de, action, "Exec" );
 
     if ( matching_entry_fields[DRUN_MATCH_FIELD_COMMENT].enabled ) {
-        pd->entry_list[pd->cmd_list_length].comment = g_key_file_get_locale_string ( kf,
-                                                                                     DRUN_GROUP_NAME, "Comment", NULL, NULL );
+        entry->comment = rofi_desktop_entry_get_locale_string ( de, DRUN_GROUP_NAME, "Comment" );
     }
     else {
-        pd->entry_list[pd->cmd_list_length].comment = NULL;
+        entry->comment = NULL;
     }
     if ( config.show_icons ) {
-        pd->entry_list[pd->cmd_list_length].icon_name = g_key_file_get_locale_string ( kf, DRUN_GROUP_NAME, "Icon", NULL, NULL );
+        entry->icon_name = rofi_desktop_entry_get_locale_string ( de, DRUN_GROUP_NAME, "Icon" );
     }
     else{
-        pd->entry_list[pd->cmd_list_length].icon_name = NULL;
+        entry->icon_name = NULL;
     }
-    pd->entry_list[pd->cmd_list_length].icon = NULL;
+    entry->icon = NULL;
 
-    // Keep keyfile around.
-    pd->entry_list[pd->cmd_list_length].key_file = kf;
-    // We don't want to parse items with this id anymore.
-    g_hash_table_add ( pd->disabled_entries, g_strdup ( id ) );
     g_debug ( "[%s] Using file %s.", id, path );
-    ( pd->cmd_list_length )++;
 
-    if ( !parse_action ) {
+    if ( config.drun_show_actions && action == DRUN_GROUP_NAME ) {
         gsize actions_length = 0;
-        char  **actions      = g_key_file_get_string_list ( kf, DRUN_GROUP_NAME, "Actions", &actions_length, NULL );
+        char  **actions      = rofi_desktop_entry_get_string_list ( de, DRUN_GROUP_NAME, "Actions", &actions_length );
         for ( gsize iter = 0; iter < actions_length; iter++ ) {
             char *new_action = g_strdup_printf ( "Desktop Action %s", actions[iter] );
-            read_desktop_file ( pd, root, path, basename, new_action );
+            drun_read_desktop_entry ( pd, entries, de, root, path, basename, id, new_action );
             g_free ( new_action );
         }
         g_strfreev ( actions );
     }
-    return ;
+    return DRUN_FILE_OK | tryexec;
 }
 
 /**
- * Internal spider used to get list of executables.
+ * @param pd The drun mode data, only read.
+ * @param entries The #DRunModeEntry list to append to.
+ * @param root The application directory the file was found in.
+ * @param path The path of the desktop file.
+ * @param basename The filename of the desktop file.
+ * @param id The desktop id.
+ *
+ * Only touches entries, so files can be read from multiple threads. Whether
+ * the id was seen before is up to the caller.
+ *
+ * @returns how the file was handled.
  */
-static void walk_dir ( DRunModePrivateData *pd, const char *root, const char *dirname )
+static DRunFileState read_desktop_file ( const DRunModePrivateData *pd, GArray *entries, const char *root, const char *path,
+                                         const gchar *basename, const char *id )
 {
-    DIR *dir;
-
-    g_debug ( "Checking directory %s for desktop files.", dirname );
-    dir = opendir ( dirname );
-    if ( dir == NULL ) {
-        return;
-    }
-
-    struct dirent *file;
-    gchar         *filename = NULL;
-    struct stat   st;
-    while ( ( file = readdir ( dir ) ) != NULL ) {
-        if ( file->d_name[0] == '.' ) {
-            continue;
-        }
-        switch ( file->d_type )
-        {
-        case DT_LNK:
-        case DT_REG:
-        case DT_DIR:
-        case DT_UNKNOWN:
-            filename = g_build_filename ( dirname, file->d_name, NULL );
-            break;
-        default:
-            continue;
-        }
-
-        // On a link, or if FS does not support providing this information
-        // Fallback to stat method.
-        if ( file->d_type == DT_LNK || file->d_type == DT_UNKNOWN ) {
-            file->d_type = DT_UNKNOWN;
-            if ( stat ( filename, &st ) == 0 ) {
-                if ( S_ISDIR ( st.st_mode ) ) {
-                    file->d_type = DT_DIR;
-                }
-                else if ( S_ISREG ( st.st_mode ) ) {
-                    file->d_type = DT_REG;
-                }
-            }
-        }
-
-        switch ( file->d_type )
-        {
-        case DT_REG:
-            // Skip files not ending on .desktop.
-            if ( g_str_has_suffix ( file->d_name, ".desktop" ) ) {
-                read_desktop_file ( pd, root, filename, file->d_name, DRUN_GROUP_NAME );
-            }
-            break;
-        case DT_DIR:
-            walk_dir ( pd, root, filename );
-            break;
-        default:
-            break;
-        }
-        g_free ( filename );
+    GError           *error = NULL;
+    RofiDesktopEntry *de    = rofi_desktop_entry_load ( path, &error );
+    // If error, skip to next entry
+    if ( de == NULL ) {
+        g_debug ( "[%s] [%s] Failed to parse desktop file because: %s.", id, path, error->message );
+        g_error_free ( error );
+        return DRUN_FILE_INVALID;
     }
-    closedir ( dir );
+    DRunFileState state = drun_read_desktop_entry ( pd, entries, de, root, path, basename, id, DRUN_GROUP_NAME );
+    rofi_desktop_entry_free ( de );
+    return state;
 }
+
 /**
  * @param entry The command entry to remove from history
  *
@@ -612,24 +578,23 @@ static void delete_entry_history ( const DRunModeEntry *entry )
 static void get_apps_history ( DRunModePrivateData *pd )
 {
     TICK_N ( "Start drun history" );
-    unsigned int length = 0;
-    gchar        *path  = g_build_filename ( cache_dir, DRUN_CACHE_FILE, NULL );
-    gchar        **retv = history_get_list ( path, &length );
-    for ( unsigned int index = 0; index < length; index++ ) {
-        for ( size_t i = 0; i < pd->cmd_list_length; i++ ) {
-            if ( g_strcmp0 ( pd->entry_list[i].desktop_id, retv[index] ) == 0 ) {
-                unsigned int sort_index = length - index;
-                if ( G_LIKELY ( sort_index < INT_MAX ) ) {
-                    pd->entry_list[i].sort_index = sort_index;
-                }
-                else {
-                    // This won't sort right anymore, but never gonna hit it anyway.
-                    pd->entry_list[i].sort_index = INT_MAX;
-                }
+    gchar        *path   = g_build_filename ( cache_dir, DRUN_CACHE_FILE, NULL );
+    HistoryIndex *index  = history_index_open ( path );
+    unsigned int length  = history_index_get_length ( index );
+    for ( size_t i = 0; length > 0 && i < pd->cmd_list_length; i++ ) {
+        HistoryIndexEntry entry;
+        if ( history_index_lookup ( index, pd->entry_list[i].desktop_id, &entry ) ) {
+            unsigned int sort_index = length - entry.rank;
+            if ( G_LIKELY ( sort_index < INT_MAX ) ) {
+                pd->entry_list[i].sort_index = sort_index;
+            }
+            else {
+                // This won't sort right anymore, but never gonna hit it anyway.
+                pd->entry_list[i].sort_index = INT_MAX;
             }
         }
     }
-    g_strfreev ( retv );
+    history_index_close ( index );
     g_free ( path );
     TICK_N ( "Stop drun history" );
 }
@@ -646,215 +611,1104 @@ static gint drun_int_sort_list ( gconstpointer a, gconstpointer b, G_GNUC_UNUSED
     }
 }
 
+static gint drun_int_sort_order ( gconstpointer a, gconstpointer b, gpointer user_data )
+{
+    const DRunModeEntry *list = (const DRunModeEntry *) user_data;
+    return drun_int_sort_list ( &( list[*( (const guint *) a )] ), &( list[*( (const guint *) b )] ), NULL );
+}
+
 /*******************************************
  * Cache voodoo                            *
  *******************************************/
 
-#define CACHE_VERSION 1
-static void drun_write_str ( FILE *fd, const char *str )
+/** Version of the cache format. */
+#define CACHE_VERSION    4
+/** Magic at the start of the cache file. */
+#define CACHE_MAGIC      "rofidrun"
+/** Offset used for a NULL string in the cache. */
+#define CACHE_NULL       UINT32_MAX
+
+/**
+ * The fields of a #DRunModeEntry stored in the cache.
+ */
+typedef enum
 {
-    size_t l =  (str == NULL? 0 : strlen(str));
-    fwrite ( &l, sizeof(l),1, fd );
-    // Only write string if it is not NULL or empty.
-    if ( l > 0 ) {
-        // Also writeout terminating '\0'
-        fwrite ( str, 1, l+1, fd );
-    }
+    DRUN_CACHE_ACTION,
+    DRUN_CACHE_ROOT,
+    DRUN_CACHE_PATH,
+    DRUN_CACHE_APP_ID,
+    DRUN_CACHE_DESKTOP_ID,
+    DRUN_CACHE_ICON_NAME,
+    DRUN_CACHE_EXEC,
+    DRUN_CACHE_NAME,
+    DRUN_CACHE_GENERIC_NAME,
+    DRUN_CACHE_CATEGORIES,
+    DRUN_CACHE_KEYWORDS,
+    DRUN_CACHE_COMMENT,
+    DRUN_CACHE_NUM_FIELDS,
+} DRunCacheField;
+
+/**
+ * Header of the cache file. It is followed by the directory table, the file
+ * table, the entry table, the rank table and the string blob.
+ */
+typedef struct
+{
+    /** #CACHE_MAGIC */
+    char     magic[8];
+    /** #CACHE_VERSION */
+    uint32_t version;
+    /** Number of entries in the entry table. */
+    uint32_t num_entries;
+    /** Number of pointers needed for all entry string lists, including the NULL terminators. */
+    uint32_t num_list_items;
+    /** Size of the string blob. */
+    uint32_t blob_size;
+    /** Number of records in the directory table. */
+    uint32_t num_dirs;
+    /** Number of records in the file table. */
+    uint32_t num_files;
+    /** Offset of the settings the cache was made with, see drun_cache_config_key(). */
+    uint32_t config_key;
+    /** Number of records in the rank table, 0 or num_entries. */
+    uint32_t num_ranks;
+    /** Modification time of the history the ranks were made with, -1 when it cannot be trusted. */
+    int64_t  history_mtime;
+    /** Size of the history the ranks were made with. */
+    int64_t  history_size;
+} DRunCacheHeader;
+
+/**
+ * A directory walked, used to skip reading it when its mtime did not change.
+ */
+typedef struct
+{
+    /** Offset of the path. */
+    uint32_t path;
+    /** Offset of the list of desktop files in it. */
+    uint32_t files;
+    /** Offset of the list of sub directories in it. */
+    uint32_t subdirs;
+    /** Keeps mtime aligned. */
+    uint32_t padding;
+    /** Modification time, -1 when it cannot be trusted. */
+    int64_t  mtime;
+} DRunCacheDir;
+
+/**
+ * A desktop file, used to skip parsing it when its mtime and size did not change.
+ */
+typedef struct
+{
+    /** Offset of the path. */
+    uint32_t path;
+    /** The #DRunFileState of reading it. */
+    uint32_t state;
+    /** The first entry read from it. */
+    uint32_t first_entry;
+    /** The number of entries read from it. */
+    uint32_t num_entries;
+    /** Modification time, -1 when it cannot be trusted. */
+    int64_t  mtime;
+    /** File size. */
+    int64_t  size;
+} DRunCacheFile;
+
+/**
+ * Entry in the cache entry table.
+ */
+typedef struct
+{
+    /** Offsets of the fields in the string blob, string lists are stored back to back and end with an empty string. */
+    uint32_t fields[DRUN_CACHE_NUM_FIELDS];
+} DRunCacheEntry;
+
+/**
+ * Entry in the rank table, the table holds the entries in sorted order.
+ */
+typedef struct
+{
+    /** Index in the entry table. */
+    uint32_t entry;
+    /** The sort index of the entry, see drun_int_sort_list(). */
+    int32_t  sort_index;
+} DRunCacheRank;
+
+G_STATIC_ASSERT ( sizeof ( DRunCacheHeader ) % 8 == 0 );
+G_STATIC_ASSERT ( sizeof ( DRunCacheDir ) % 8 == 0 );
+G_STATIC_ASSERT ( sizeof ( DRunCacheFile ) % 8 == 0 );
+
+struct _DRunCache
+{
+    /** The mapping of the cache file. */
+    void                  *map;
+    /** The size of the mapping. */
+    size_t                map_size;
+    /** The header at the start of the mapping. */
+    const DRunCacheHeader *header;
+    /** The entry table. */
+    const DRunCacheEntry  *entries;
+    /** The rank table. */
+    const DRunCacheRank   *ranks;
+    /** The string blob. */
+    const char            *blob;
+    /** Path to #DRunCacheDir. */
+    GHashTable            *dirs;
+    /** Path to #DRunCacheFile. */
+    GHashTable            *files;
+    /** Pointers for the string lists of the cached entries. */
+    char                  **lists;
+    /** The number of pointers in lists that are in use. */
+    uint32_t              lists_used;
+};
+
+/**
+ * A directory walked, written to the cache as #DRunCacheDir.
+ */
+typedef struct
+{
+    char    *path;
+    char    **files;
+    char    **subdirs;
+    int64_t mtime;
+} DRunDir;
+
+/**
+ * A desktop file found, written to the cache as #DRunCacheFile.
+ */
+typedef struct
+{
+    char                *path;
+    DRunFileState       state;
+    uint32_t            first_entry;
+    uint32_t            num_entries;
+    int64_t             mtime;
+    int64_t             size;
+
+    /** The application directory it was found in, not owned. */
+    const char          *root;
+    /** The filename, points into path. */
+    const char          *basename;
+    /** The desktop id. */
+    char                *id;
+    /** The cached result to use, NULL if it has to be parsed. */
+    const DRunCacheFile *cached;
+    /** The cached result of a file parsed again, the cache is outdated if the result differs. */
+    const DRunCacheFile *recheck;
+    /** The file needs to be parsed. */
+    gboolean            parse;
+    /** The result of parsing it. */
+    DRunFileState       parse_state;
+    /** The entries parsed, in the buffer of the worker that parsed it. */
+    GArray              *entries;
+    /** The first entry in entries. */
+    guint               parse_first;
+    /** The number of entries parsed. */
+    guint               parse_count;
+} DRunFile;
+
+static void drun_dir_clear ( gpointer data )
+{
+    DRunDir *dir = (DRunDir *) data;
+    g_free ( dir->path );
+    g_strfreev ( dir->files );
+    g_strfreev ( dir->subdirs );
 }
-static void drun_read_string ( FILE *fd, char **str )
+
+static void drun_file_clear ( gpointer data )
 {
-    size_t l = 0;
+    DRunFile *file = (DRunFile *) data;
+    g_free ( file->path );
+    g_free ( file->id );
+}
 
-    if ( fread ( &l, sizeof(l), 1, fd ) != 1 ){
-        g_warning( "Failed to read entry, cache corrupt?" );
-        return;
+/**
+ * @param mtime The modification time.
+ *
+ * A change within the same second can go unnoticed, so a recent modification
+ * time is never matched.
+ *
+ * @returns the modification time to store in the cache.
+ */
+static int64_t drun_cache_mtime ( time_t mtime )
+{
+    return ( mtime >= time ( NULL ) - 1 ) ? -1 : (int64_t) mtime;
+}
+
+/**
+ * Everything besides the desktop files that changes what is read from them.
+ *
+ * @returns a newly allocated string, a cache made with a different one is ignored.
+ */
+static char *drun_cache_config_key ( void )
+{
+    GString *key = g_string_new ( NULL );
+    for ( const gchar * const *iter = g_get_language_names (); *iter != NULL; iter++ ) {
+        g_string_append_printf ( key, "%s;", *iter );
     }
-    (*str) = NULL;
-    if ( l > 0 ) {
-        // Include \0
-        l++;
-        (*str) = g_malloc(l);
-        if ( fread ( (*str), 1, l, fd ) != l ){
-            g_warning( "Failed to read entry, cache corrupt?" );
-        }
+    g_string_append_printf ( key, "|%s;", g_get_user_data_dir () );
+    for ( const gchar * const *iter = g_get_system_data_dirs (); *iter != NULL; iter++ ) {
+        g_string_append_printf ( key, "%s;", *iter );
     }
+    const char *current_desktop = g_getenv ( "XDG_CURRENT_DESKTOP" );
+    g_string_append_printf ( key, "|%s|%s|%d%d%d|", current_desktop ? current_desktop : "",
+                             config.drun_categories ? config.drun_categories : "",
+                             config.drun_show_actions, config.show_icons, config.disable_history );
+    for ( unsigned int i = 0; i < DRUN_MATCH_NUM_FIELDS; i++ ) {
+        g_string_append_c ( key, matching_entry_fields[i].enabled ? '1' : '0' );
+    }
+    return g_string_free ( key, FALSE );
 }
-static void drun_write_strv ( FILE *fd, char **str )
+
+static uint32_t drun_cache_add_str ( GString *blob, const char *str )
 {
-    guint vl = (str == NULL? 0 : g_strv_length ( str ));
-    fwrite ( &vl, sizeof(vl),1, fd );
-    for ( guint index = 0; index < vl ; index++ ) {
-        drun_write_str ( fd, str[index] );
+    if ( str == NULL ) {
+        return CACHE_NULL;
     }
+    uint32_t offset = blob->len;
+    // Also write out the terminating '\0', strings are used in place.
+    g_string_append_len ( blob, str, strlen ( str ) + 1 );
+    return offset;
 }
-static void drun_read_stringv ( FILE *fd, char ***str )
+
+static uint32_t drun_cache_add_strv ( GString *blob, char **strv, uint32_t *num_list_items )
 {
-    guint vl = 0;
-    (*str) = NULL;
-    if ( fread ( &vl, sizeof(vl), 1, fd ) != 1 ){
-        g_warning( "Failed to read entry, cache corrupt?" );
-        return;
-    }
-    if ( vl > 0 ){
-        // Include terminating NULL entry.
-        (*str) = g_malloc0((vl+1)*sizeof(**str));
-        for ( guint index = 0; index < vl; index++ ) {
-            drun_read_string ( fd, &((*str)[index]));
+    if ( strv == NULL ) {
+        return CACHE_NULL;
+    }
+    uint32_t offset = blob->len;
+    for ( ; *strv != NULL; strv++ ) {
+        // Empty strings would end the list.
+        if ( ( *strv )[0] != '\0' ) {
+            drun_cache_add_str ( blob, *strv );
+            ( *num_list_items )++;
         }
     }
+    g_string_append_c ( blob, '\0' );
+    ( *num_list_items )++;
+    return offset;
 }
 
-static void write_cache ( DRunModePrivateData *pd, const char *cache_file )
+/**
+ * @param pd The drun mode data, with the entries in the order they were read.
+ * @param cache_file The cache file.
+ * @param config_key The result of drun_cache_config_key().
+ * @param order The sorted order of the entries.
+ * @param history_mtime The modification time of the history the order was made with.
+ * @param history_size The size of the history the order was made with.
+ */
+static void write_cache ( DRunModePrivateData *pd, const char *cache_file, const char *config_key,
+                          const guint *order, int64_t history_mtime, int64_t history_size )
 {
     if ( cache_file == NULL || config.drun_use_desktop_cache == FALSE ) return;
     TICK_N ( "DRUN Write CACHE: start" );
 
-    FILE *fd = fopen ( cache_file, "w" );
-    if ( fd == NULL ){
+    DRunCacheHeader header = {
+        .version     = CACHE_VERSION,
+        .num_entries = pd->cmd_list_length,
+        .num_dirs    = pd->cache_dirs->len,
+        .num_files     = pd->cache_files->len,
+        .num_ranks     = pd->cmd_list_length,
+        .history_mtime = history_mtime,
+        .history_size  = history_size,
+    };
+    memcpy ( header.magic, CACHE_MAGIC, sizeof ( header.magic ) );
+    DRunCacheDir    *dirs    = g_malloc0_n ( header.num_dirs, sizeof ( DRunCacheDir ) );
+    DRunCacheFile   *files   = g_malloc0_n ( header.num_files, sizeof ( DRunCacheFile ) );
+    DRunCacheEntry  *entries = g_malloc0_n ( header.num_entries, sizeof ( DRunCacheEntry ) );
+    DRunCacheRank   *ranks   = g_malloc0_n ( header.num_ranks, sizeof ( DRunCacheRank ) );
+    GString         *blob    = g_string_sized_new ( 256 * pd->cmd_list_length + 64 * header.num_files + 1 );
+    // Directory listings do not need list pointers when read.
+    uint32_t        num_names = 0;
+
+    header.config_key = drun_cache_add_str ( blob, config_key );
+    for ( unsigned int index = 0; index < header.num_dirs; index++ ) {
+        DRunDir *dir = &g_array_index ( pd->cache_dirs, DRunDir, index );
+        dirs[index].path    = drun_cache_add_str ( blob, dir->path );
+        dirs[index].files   = drun_cache_add_strv ( blob, dir->files, &num_names );
+        dirs[index].subdirs = drun_cache_add_strv ( blob, dir->subdirs, &num_names );
+        dirs[index].mtime   = dir->mtime;
+    }
+    for ( unsigned int index = 0; index < header.num_files; index++ ) {
+        DRunFile *file = &g_array_index ( pd->cache_files, DRunFile, index );
+        files[index].path        = drun_cache_add_str ( blob, file->path );
+        files[index].state       = file->state;
+        files[index].first_entry = file->first_entry;
+        files[index].num_entries = file->num_entries;
+        files[index].mtime       = file->mtime;
+        files[index].size        = file->size;
+    }
+    for ( unsigned int index = 0; index < pd->cmd_list_length; index++ ) {
+        DRunModeEntry  *entry = &( pd->entry_list[index] );
+        DRunCacheEntry *ce    = &( entries[index] );
+
+        ce->fields[DRUN_CACHE_ACTION]       = drun_cache_add_str ( blob, entry->action );
+        ce->fields[DRUN_CACHE_ROOT]         = drun_cache_add_str ( blob, entry->root );
+        ce->fields[DRUN_CACHE_PATH]         = drun_cache_add_str ( blob, entry->path );
+        ce->fields[DRUN_CACHE_APP_ID]       = drun_cache_add_str ( blob, entry->app_id );
+        ce->fields[DRUN_CACHE_DESKTOP_ID]   = drun_cache_add_str ( blob, entry->desktop_id );
+        ce->fields[DRUN_CACHE_ICON_NAME]    = drun_cache_add_str ( blob, entry->icon_name );
+        ce->fields[DRUN_CACHE_EXEC]         = drun_cache_add_str ( blob, entry->exec );
+        ce->fields[DRUN_CACHE_NAME]         = drun_cache_add_str ( blob, entry->name );
+        ce->fields[DRUN_CACHE_GENERIC_NAME] = drun_cache_add_str ( blob, entry->generic_name );
+        ce->fields[DRUN_CACHE_CATEGORIES]   = drun_cache_add_strv ( blob, entry->categories, &( header.num_list_items ) );
+        ce->fields[DRUN_CACHE_KEYWORDS]     = drun_cache_add_strv ( blob, entry->keywords, &( header.num_list_items ) );
+        ce->fields[DRUN_CACHE_COMMENT]      = drun_cache_add_str ( blob, entry->comment );
+    }
+    for ( unsigned int index = 0; index < header.num_ranks; index++ ) {
+        ranks[index].entry      = order[index];
+        ranks[index].sort_index = pd->entry_list[order[index]].sort_index;
+    }
+    // The blob always ends with a '\0', so every offset in it is a valid string.
+    g_string_append_c ( blob, '\0' );
+    header.blob_size = blob->len;
+
+    // Write to a new, uniquely named file. Other instances might have the old one mapped,
+    // or be writing their own.
+    char *tmp_file = g_strconcat ( cache_file, ".XXXXXX", NULL );
+    int  tmp_fd    = g_mkstemp ( tmp_file );
+    FILE *fd       = ( tmp_fd >= 0 ) ? fdopen ( tmp_fd, "w" ) : NULL;
+    if ( fd == NULL ) {
         g_warning ( "Failed to write to cache file" );
-        return;
+        if ( tmp_fd >= 0 ) {
+            close ( tmp_fd );
+            unlink ( tmp_file );
+        }
     }
-    uint8_t version = CACHE_VERSION;
-    fwrite ( &version, sizeof(version),1, fd );
-
-    fwrite ( &(pd->cmd_list_length), sizeof(pd->cmd_list_length),1,fd );
-    for ( unsigned int index = 0; index < pd->cmd_list_length; index ++ )
-    {
-        DRunModeEntry *entry = & ( pd->entry_list[index] );
-
-        drun_write_str ( fd, entry->action );
-        drun_write_str ( fd, entry->root );
-        drun_write_str ( fd, entry->path );
-        drun_write_str ( fd, entry->app_id );
-        drun_write_str ( fd, entry->desktop_id );
-        drun_write_str ( fd, entry->icon_name );
-        drun_write_str ( fd, entry->exec );
-        drun_write_str ( fd, entry->name );
-        drun_write_str ( fd, entry->generic_name );
-
-        drun_write_strv ( fd, entry->categories );
-        drun_write_strv ( fd, entry->keywords );
+    else {
+        gboolean ok = fwrite ( &header, sizeof ( header ), 1, fd ) == 1;
+        ok = ok && fwrite ( dirs, sizeof ( DRunCacheDir ), header.num_dirs, fd ) == header.num_dirs;
+        ok = ok && fwrite ( files, sizeof ( DRunCacheFile ), header.num_files, fd ) == header.num_files;
+        ok = ok && fwrite ( entries, sizeof ( DRunCacheEntry ), header.num_entries, fd ) == header.num_entries;
+        ok = ok && fwrite ( ranks, sizeof ( DRunCacheRank ), header.num_ranks, fd ) == header.num_ranks;
+        ok = ok && fwrite ( blob->str, 1, blob->len, fd ) == blob->len;
+        if ( fclose ( fd ) != 0 || !ok || rename ( tmp_file, cache_file ) != 0 ) {
+            g_warning ( "Failed to write to cache file: %s", g_strerror ( errno ) );
+            unlink ( tmp_file );
+        }
+    }
+    g_free ( tmp_file );
+    g_string_free ( blob, TRUE );
+    g_free ( ranks );
+    g_free ( entries );
+    g_free ( files );
+    g_free ( dirs );
+    TICK_N ( "DRUN Write CACHE: end" );
+}
 
-        drun_write_str ( fd, entry->comment );
+/**
+ * @param cache The cache.
+ * @param offset The offset of the string.
+ * @param str Set to the string in the blob.
+ *
+ * @returns FALSE if offset is invalid.
+ */
+static inline gboolean drun_cache_get_str ( const DRunCache *cache, uint32_t offset, char **str )
+{
+    if ( offset == CACHE_NULL ) {
+        *str = NULL;
+        return TRUE;
+    }
+    if ( offset >= cache->header->blob_size ) {
+        return FALSE;
+    }
+    *str = (char *) &( cache->blob[offset] );
+    return TRUE;
+}
 
+/**
+ * @param cache The cache, the list takes its pointers from #DRunCache::lists.
+ * @param offset The offset of the list.
+ * @param strv Set to the NULL terminated list.
+ *
+ * @returns FALSE if offset is invalid or the pointers ran out.
+ */
+static gboolean drun_cache_get_strv ( DRunCache *cache, uint32_t offset, char ***strv )
+{
+    *strv = NULL;
+    if ( offset == CACHE_NULL ) {
+        return TRUE;
     }
+    char **list = &( cache->lists[cache->lists_used] );
+    do {
+        if ( offset >= cache->header->blob_size || cache->lists_used >= cache->header->num_list_items ) {
+            return FALSE;
+        }
+        char *str = (char *) &( cache->blob[offset] );
+        cache->lists[( cache->lists_used )++] = ( *str == '\0' ) ? NULL : str;
+        // The blob ends with a '\0', so this stays within the blob.
+        offset += strlen ( str ) + 1;
+    } while ( cache->lists[cache->lists_used - 1] != NULL );
+    *strv = list;
+    return TRUE;
+}
 
-    fclose ( fd) ;
-    TICK_N ( "DRUN Write CACHE: end" );
+/**
+ * @param cache The cache.
+ * @param offset The offset of the list.
+ *
+ * @returns a newly allocated copy of the list, or NULL if offset is invalid.
+ */
+static char **drun_cache_dup_strv ( const DRunCache *cache, uint32_t offset )
+{
+    if ( offset >= cache->header->blob_size ) {
+        return NULL;
+    }
+    GPtrArray *list = g_ptr_array_new ();
+    // The blob ends with a '\0', so this stays within the blob.
+    for ( const char *str = &( cache->blob[offset] ); *str != '\0'; str += strlen ( str ) + 1 ) {
+        g_ptr_array_add ( list, g_strdup ( str ) );
+    }
+    g_ptr_array_add ( list, NULL );
+    return (char * *) g_ptr_array_free ( list, FALSE );
 }
 
+static void drun_cache_free ( DRunCache *cache )
+{
+    if ( cache == NULL ) {
+        return;
+    }
+    if ( cache->dirs != NULL ) {
+        g_hash_table_destroy ( cache->dirs );
+    }
+    if ( cache->files != NULL ) {
+        g_hash_table_destroy ( cache->files );
+    }
+    g_free ( cache->lists );
+    munmap ( cache->map, cache->map_size );
+    g_free ( cache );
+}
 
 /**
- * Read cache file. returns FALSE when success.
+ * @param cache_file The cache file.
+ * @param config_key The result of drun_cache_config_key().
+ *
+ * The cache is mapped and entries loaded from it point into the mapping.
+ *
+ * @returns the cache, or NULL if it is missing or unusable.
  */
-static gboolean drun_read_cache ( DRunModePrivateData *pd, const char *cache_file )
+static DRunCache *drun_read_cache ( const char *cache_file, const char *config_key )
 {
-    if ( cache_file == NULL || config.drun_use_desktop_cache == FALSE ) return TRUE;
+    if ( cache_file == NULL || config.drun_use_desktop_cache == FALSE ) return NULL;
 
     if ( config.drun_reload_desktop_cache ) {
-        return TRUE;
+        return NULL;
     }
     TICK_N ( "DRUN Read CACHE: start" );
-    FILE *fd = fopen ( cache_file, "r" );
-    if ( fd == NULL ) {
+    int fd = open ( cache_file, O_RDONLY );
+    if ( fd < 0 ) {
         TICK_N ( "DRUN Read CACHE: stop" );
-        return TRUE;
+        return NULL;
     }
-
-    // Read version.
-    uint8_t version = 0;
-
-    if ( fread ( &version, sizeof(version),1, fd ) != 1 )
-    {
-        fclose ( fd );
+    struct stat st;
+    void        *map = MAP_FAILED;
+    if ( fstat ( fd, &st ) == 0 && (size_t) st.st_size >= sizeof ( DRunCacheHeader ) ) {
+        map = mmap ( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    }
+    close ( fd );
+    if ( map == MAP_FAILED ) {
         g_warning ( "Cache corrupt, ignoring." );
         TICK_N ( "DRUN Read CACHE: stop" );
-        return FALSE;
+        return NULL;
     }
 
-    if ( version != CACHE_VERSION ) {
-        fclose ( fd );
+    DRunCache *cache = g_malloc0 ( sizeof ( *cache ) );
+    cache->map      = map;
+    cache->map_size = st.st_size;
+    cache->header   = (const DRunCacheHeader *) map;
+    const DRunCacheHeader *header = cache->header;
+    if ( memcmp ( header->magic, CACHE_MAGIC, sizeof ( header->magic ) ) != 0 || header->version != CACHE_VERSION ) {
+        drun_cache_free ( cache );
         g_warning ( "Cache file wrong version, ignoring." );
         TICK_N ( "DRUN Read CACHE: stop" );
-        return FALSE;
+        return NULL;
+    }
+    const DRunCacheDir  *dirs      = (const DRunCacheDir *) ( header + 1 );
+    const DRunCacheFile *files     = (const DRunCacheFile *) ( dirs + header->num_dirs );
+    cache->entries = (const DRunCacheEntry *) ( files + header->num_files );
+    cache->ranks   = (const DRunCacheRank *) ( cache->entries + header->num_entries );
+    cache->blob    = (const char *) ( cache->ranks + header->num_ranks );
+    uint32_t            blob_size  = header->blob_size;
+    uint64_t            file_size  = sizeof ( DRunCacheHeader )
+                                     + (uint64_t) header->num_dirs * sizeof ( DRunCacheDir )
+                                     + (uint64_t) header->num_files * sizeof ( DRunCacheFile )
+                                     + (uint64_t) header->num_entries * sizeof ( DRunCacheEntry )
+                                     + (uint64_t) header->num_ranks * sizeof ( DRunCacheRank )
+                                     + blob_size;
+    // Every list item takes at least one byte of the blob.
+    if ( file_size != (uint64_t) st.st_size || blob_size == 0 || cache->blob[blob_size - 1] != '\0'
+         || header->num_list_items > blob_size || ( header->num_ranks != 0 && header->num_ranks != header->num_entries ) ) {
+        drun_cache_free ( cache );
+        g_warning ( "Cache corrupt, ignoring." );
+        TICK_N ( "DRUN Read CACHE: stop" );
+        return NULL;
+    }
+    char *key = NULL;
+    if ( !drun_cache_get_str ( cache, header->config_key, &key ) || g_strcmp0 ( key, config_key ) != 0 ) {
+        drun_cache_free ( cache );
+        g_debug ( "Cache made with different settings, ignoring." );
+        TICK_N ( "DRUN Read CACHE: stop" );
+        return NULL;
     }
 
-    if ( fread ( &(pd->cmd_list_length), sizeof(pd->cmd_list_length),1,fd ) != 1 ){
-        fclose ( fd );
+    // Paths point into the mapping, so nothing to free.
+    cache->dirs  = g_hash_table_new ( g_str_hash, g_str_equal );
+    cache->files = g_hash_table_new ( g_str_hash, g_str_equal );
+    gboolean valid = TRUE;
+    for ( uint32_t index = 0; valid && index < header->num_dirs; index++ ) {
+        char *path = NULL;
+        valid = drun_cache_get_str ( cache, dirs[index].path, &path ) && path != NULL;
+        if ( valid ) {
+            g_hash_table_insert ( cache->dirs, path, (gpointer) &( dirs[index] ) );
+        }
+    }
+    for ( uint32_t index = 0; valid && index < header->num_files; index++ ) {
+        char *path = NULL;
+        valid = drun_cache_get_str ( cache, files[index].path, &path ) && path != NULL
+                && files[index].first_entry <= header->num_entries
+                && files[index].num_entries <= header->num_entries - files[index].first_entry;
+        if ( valid ) {
+            g_hash_table_insert ( cache->files, path, (gpointer) &( files[index] ) );
+        }
+    }
+    if ( !valid ) {
+        drun_cache_free ( cache );
         g_warning ( "Cache corrupt, ignoring." );
         TICK_N ( "DRUN Read CACHE: stop" );
-        return FALSE;
+        return NULL;
     }
-    // set actual length to length;
-    pd->cmd_list_length_actual = pd->cmd_list_length;
+    cache->lists = g_malloc_n ( header->num_list_items, sizeof ( char * ) );
 
-    pd->entry_list = g_malloc0 ( pd->cmd_list_length_actual * sizeof ( *( pd->entry_list ) ));
+    TICK_N ( "DRUN Read CACHE: stop" );
+    return cache;
+}
 
-    for ( unsigned int index = 0; index < pd->cmd_list_length; index++ )
-    {
-        DRunModeEntry *entry = & ( pd->entry_list[index] );
+/**
+ * @param pd The drun mode data.
+ * @param entry The entry to add, ownership of its content is taken.
+ *
+ * Add the entry at the end of the list, entries keep the order they were added in.
+ */
+static void drun_entry_list_add ( DRunModePrivateData *pd, const DRunModeEntry *entry )
+{
+    size_t nl = ( ( pd->cmd_list_length ) + 1 );
+    if ( nl >= pd->cmd_list_length_actual ) {
+        pd->cmd_list_length_actual += 256;
+        pd->entry_list              = g_realloc ( pd->entry_list, pd->cmd_list_length_actual * sizeof ( *( pd->entry_list ) ) );
+    }
+    pd->entry_list[pd->cmd_list_length] = *entry;
+    // Make sure order is preserved, this will break when cmd_list_length is bigger then INT_MAX.
+    // This is not likely to happen.
+    if ( G_UNLIKELY ( pd->cmd_list_length > INT_MAX ) ) {
+        // Default to smallest value.
+        pd->entry_list[pd->cmd_list_length].sort_index = INT_MIN;
+    }
+    else {
+        pd->entry_list[pd->cmd_list_length].sort_index = -nl;
+    }
+    ( pd->cmd_list_length )++;
+}
 
-        drun_read_string ( fd, &(entry->action) );
-        drun_read_string ( fd, &(entry->root) );
-        drun_read_string ( fd, &(entry->path) );
-        drun_read_string ( fd, &(entry->app_id) );
-        drun_read_string ( fd, &(entry->desktop_id) );
-        drun_read_string ( fd, &(entry->icon_name) );
-        drun_read_string ( fd, &(entry->exec) );
-        drun_read_string ( fd, &(entry->name) );
-        drun_read_string ( fd, &(entry->generic_name) );
+/**
+ * @param pd The drun mode data.
+ * @param cf The cached file.
+ *
+ * Add the entries read from the file the last time.
+ *
+ * @returns FALSE if the cached entries are invalid, nothing is added then.
+ */
+static gboolean drun_cache_replay_entries ( DRunModePrivateData *pd, const DRunCacheFile *cf )
+{
+    DRunCache    *cache      = pd->cache;
+    unsigned int length      = pd->cmd_list_length;
+    uint32_t     lists_used  = cache->lists_used;
+    for ( uint32_t index = cf->first_entry; index < cf->first_entry + cf->num_entries; index++ ) {
+        const DRunCacheEntry *ce    = &( cache->entries[index] );
+        DRunModeEntry        entry  = { .from_cache = TRUE, };
+        gboolean             valid  = drun_cache_get_str ( cache, ce->fields[DRUN_CACHE_ACTION], &( entry.action ) )
+                                      && drun_cache_get_str ( cache, ce->fields[DRUN_CACHE_ROOT], &( entry.root ) )
+                                      && drun_cache_get_str ( cache, ce->fields[DRUN_CACHE_PATH], &( entry.path ) )
+                                      && drun_cache_get_str ( cache, ce->fields[DRUN_CACHE_APP_ID], &( entry.app_id ) )
+                                      && drun_cache_get_str ( cache, ce->fields[DRUN_CACHE_DESKTOP_ID], &( entry.desktop_id ) )
+                                      && drun_cache_get_str ( cache, ce->fields[DRUN_CACHE_ICON_NAME], &( entry.icon_name ) )
+                                      && drun_cache_get_str ( cache, ce->fields[DRUN_CACHE_EXEC], &( entry.exec ) )
+                                      && drun_cache_get_str ( cache, ce->fields[DRUN_CACHE_NAME], &( entry.name ) )
+                                      && drun_cache_get_str ( cache, ce->fields[DRUN_CACHE_GENERIC_NAME], &( entry.generic_name ) )
+                                      && drun_cache_get_strv ( cache, ce->fields[DRUN_CACHE_CATEGORIES], &( entry.categories ) )
+                                      && drun_cache_get_strv ( cache, ce->fields[DRUN_CACHE_KEYWORDS], &( entry.keywords ) )
+                                      && drun_cache_get_str ( cache, ce->fields[DRUN_CACHE_COMMENT], &( entry.comment ) );
+        if ( !valid || entry.desktop_id == NULL || entry.name == NULL || entry.exec == NULL ) {
+            pd->cmd_list_length = length;
+            cache->lists_used   = lists_used;
+            return FALSE;
+        }
+        drun_entry_list_add ( pd, &entry );
+    }
+    return TRUE;
+}
 
-        drun_read_stringv ( fd, &(entry->categories) );
-        drun_read_stringv ( fd, &(entry->keywords) );
+/**
+ * @param pd The drun mode data.
+ * @param root The application directory.
+ * @param path The path of the desktop file, ownership is taken.
+ * @param basename The filename of the desktop file.
+ *
+ * Record the desktop file, and decide if the result of the last time can be
+ * taken from the cache or if it has to be parsed.
+ */
+static void drun_add_file ( DRunModePrivateData *pd, const char *root, char *path, const char *basename )
+{
+    DRunFile    file = {
+        .path     = path,
+        .root     = root,
+        .basename = path + strlen ( path ) - strlen ( basename ),
+        .id       = g_malloc ( strlen ( path ) - strlen ( root ) ),
+        .mtime    = -1,
+        .size     = -1,
+    };
+    drun_desktop_id ( root, path, file.id );
+
+    struct stat st;
+    if ( stat ( path, &st ) == 0 ) {
+        file.mtime = drun_cache_mtime ( st.st_mtime );
+        file.size  = st.st_size;
+    }
+    // Ids claimed by earlier files with a known result, the rest is sorted out when merging.
+    if ( !g_hash_table_contains ( pd->disabled_entries, file.id ) ) {
+        const DRunCacheFile *cf        = pd->cache ? g_hash_table_lookup ( pd->cache->files, path ) : NULL;
+        gboolean            unchanged  = cf != NULL && cf->mtime >= 0 && cf->mtime == file.mtime && cf->size == file.size;
+        DRunFileState       state      = unchanged ? ( cf->state & DRUN_FILE_STATE_MASK ) : DRUN_FILE_SKIPPED;
+        // TryExec depends on more then the file, so always check it again.
+        if ( unchanged && ( cf->state & DRUN_FILE_TRYEXEC ) == 0 && state != DRUN_FILE_SKIPPED ) {
+            file.cached = cf;
+            if ( state != DRUN_FILE_INVALID ) {
+                g_hash_table_add ( pd->disabled_entries, g_strdup ( file.id ) );
+            }
+        }
+        else {
+            file.parse = TRUE;
+            if ( !unchanged || ( cf->state & DRUN_FILE_TRYEXEC ) == 0 ) {
+                pd->cache_dirty = TRUE;
+            }
+            else {
+                file.recheck = cf;
+            }
+        }
+    }
+    g_array_append_val ( pd->cache_files, file );
+}
 
-        drun_read_string ( fd, &(entry->comment) );
+/**
+ * @param dir The directory to fill in.
+ *
+ * List the desktop files and sub directories of dir.
+ *
+ * @returns FALSE if the directory could not be opened.
+ */
+static gboolean drun_read_dir ( DRunDir *dir )
+{
+    DIR *d = opendir ( dir->path );
+    if ( d == NULL ) {
+        return FALSE;
     }
+    GPtrArray     *files   = g_ptr_array_new ();
+    GPtrArray     *subdirs = g_ptr_array_new ();
+    struct dirent *file;
+    struct stat   st;
+    while ( ( file = readdir ( d ) ) != NULL ) {
+        if ( file->d_name[0] == '.' ) {
+            continue;
+        }
+        switch ( file->d_type )
+        {
+        case DT_LNK:
+        case DT_REG:
+        case DT_DIR:
+        case DT_UNKNOWN:
+            break;
+        default:
+            continue;
+        }
 
+        // On a link, or if FS does not support providing this information
+        // Fallback to stat method.
+        if ( file->d_type == DT_LNK || file->d_type == DT_UNKNOWN ) {
+            gchar *filename = g_build_filename ( dir->path, file->d_name, NULL );
+            file->d_type = DT_UNKNOWN;
+            if ( stat ( filename, &st ) == 0 ) {
+                if ( S_ISDIR ( st.st_mode ) ) {
+                    file->d_type = DT_DIR;
+                }
+                else if ( S_ISREG ( st.st_mode ) ) {
+                    file->d_type = DT_REG;
+                }
+            }
+            g_free ( filename );
+        }
 
-    fclose ( fd );
-    TICK_N ( "DRUN Read CACHE: stop" );
-    return FALSE;
+        switch ( file->d_type )
+        {
+        case DT_REG:
+            // Skip files not ending on .desktop.
+            if ( g_str_has_suffix ( file->d_name, ".desktop" ) ) {
+                g_ptr_array_add ( files, g_strdup ( file->d_name ) );
+            }
+            break;
+        case DT_DIR:
+            g_ptr_array_add ( subdirs, g_strdup ( file->d_name ) );
+            break;
+        default:
+            break;
+        }
+    }
+    closedir ( d );
+    g_ptr_array_add ( files, NULL );
+    g_ptr_array_add ( subdirs, NULL );
+    dir->files   = (char * *) g_ptr_array_free ( files, FALSE );
+    dir->subdirs = (char * *) g_ptr_array_free ( subdirs, FALSE );
+    return TRUE;
 }
 
-static void get_apps ( DRunModePrivateData *pd )
+/**
+ * Internal spider used to get list of executables.
+ *
+ * The desktop files of a directory are read before its sub directories.
+ */
+static void walk_dir ( DRunModePrivateData *pd, const char *root, const char *dirname )
 {
-    char *cache_file = g_build_filename ( cache_dir, DRUN_DESKTOP_CACHE_FILE, NULL );
-    TICK_N ( "Get Desktop apps (start)" );
-    if ( drun_read_cache ( pd, cache_file ) )
-    {
+    g_debug ( "Checking directory %s for desktop files.", dirname );
+    struct stat st;
+    if ( stat ( dirname, &st ) != 0 ) {
+        return;
+    }
+    DRunDir            dir = { .path = g_strdup ( dirname ), .mtime = drun_cache_mtime ( st.st_mtime ) };
+    const DRunCacheDir *cd = pd->cache ? g_hash_table_lookup ( pd->cache->dirs, dirname ) : NULL;
+    // Entries were added, removed or renamed when the mtime changed.
+    if ( cd != NULL && cd->mtime >= 0 && cd->mtime == dir.mtime ) {
+        dir.files   = drun_cache_dup_strv ( pd->cache, cd->files );
+        dir.subdirs = drun_cache_dup_strv ( pd->cache, cd->subdirs );
+    }
+    if ( dir.files == NULL || dir.subdirs == NULL ) {
+        g_strfreev ( dir.files );
+        g_strfreev ( dir.subdirs );
+        dir.files   = NULL;
+        dir.subdirs = NULL;
+        if ( !drun_read_dir ( &dir ) ) {
+            g_free ( dir.path );
+            return;
+        }
+        pd->cache_dirty = TRUE;
+    }
+    g_array_append_val ( pd->cache_dirs, dir );
 
-        gchar *dir;
-        // First read the user directory.
-        dir = g_build_filename ( g_get_user_data_dir (), "applications", NULL );
-        walk_dir ( pd, dir, dir );
-        g_free ( dir );
-        TICK_N ( "Get Desktop apps (user dir)" );
-        // Then read thee system data dirs.
-        const gchar * const * sys = g_get_system_data_dirs ();
-        for ( const gchar * const *iter = sys; *iter != NULL; ++iter ) {
-            gboolean unique = TRUE;
-            // Stupid duplicate detection, better then walking dir.
-            for ( const gchar *const *iterd = sys; iterd != iter; ++iterd ) {
-                if ( g_strcmp0 ( *iter, *iterd ) == 0 ) {
-                    unique = FALSE;
+    for ( char **iter = dir.files; *iter != NULL; iter++ ) {
+        drun_add_file ( pd, root, g_build_filename ( dirname, *iter, NULL ), *iter );
+    }
+    for ( char **iter = dir.subdirs; *iter != NULL; iter++ ) {
+        gchar *filename = g_build_filename ( dirname, *iter, NULL );
+        walk_dir ( pd, root, filename );
+        g_free ( filename );
+    }
+}
+
+/** Number of desktop files parsed by one job. */
+#define DRUN_PARSE_BATCH    64
+
+/**
+ * A batch of desktop files parsed by a worker thread.
+ */
+typedef struct
+{
+    /** Generic thread state. */
+    thread_state              st;
+
+    /** Condition. */
+    GCond                     *cond;
+    /** Lock for condition. */
+    GMutex                    *mutex;
+    /** Outstanding jobs, protected by lock. */
+    unsigned int              *acount;
+
+    /** The drun mode data (read-only). */
+    const DRunModePrivateData *pd;
+    /** The files to parse, not owned. */
+    DRunFile                  **files;
+    /** Number of files. */
+    unsigned int              length;
+    /** The entries parsed from the files. */
+    GArray                    *entries;
+} DRunParseBatch;
+
+static void drun_parse_batch ( thread_state *ts, G_GNUC_UNUSED gpointer user_data )
+{
+    DRunParseBatch *b = (DRunParseBatch *) ts;
+    for ( unsigned int i = 0; i < b->length; i++ ) {
+        DRunFile *file = b->files[i];
+        file->entries     = b->entries;
+        file->parse_first = b->entries->len;
+        file->parse_state = read_desktop_file ( b->pd, b->entries, file->root, file->path, file->basename, file->id );
+        file->parse_count = b->entries->len - file->parse_first;
+    }
+    if ( b->acount != NULL ) {
+        g_mutex_lock ( b->mutex );
+        ( *( b->acount ) )--;
+        g_cond_signal ( b->cond );
+        g_mutex_unlock ( b->mutex );
+    }
+}
+
+/**
+ * @param pd The drun mode data.
+ * @param buffers Gets the entry lists of the workers added.
+ *
+ * Parse the desktop files that need it in parallel.
+ */
+static void drun_parse_files ( DRunModePrivateData *pd, GPtrArray *buffers )
+{
+    GPtrArray *files = g_ptr_array_new ();
+    for ( guint i = 0; i < pd->cache_files->len; i++ ) {
+        DRunFile *file = &g_array_index ( pd->cache_files, DRunFile, i );
+        if ( file->parse ) {
+            g_ptr_array_add ( files, file );
+        }
+    }
+    unsigned int   nb       = ( files->len + DRUN_PARSE_BATCH - 1 ) / DRUN_PARSE_BATCH;
+    DRunParseBatch *batches = g_malloc0_n ( nb, sizeof ( DRunParseBatch ) );
+    GCond          cond;
+    GMutex         mutex;
+    g_mutex_init ( &mutex );
+    g_cond_init ( &cond );
+    // The first batch is parsed in this thread, the pool is not there when only dumping the config.
+    unsigned int count = ( tpool != NULL && nb > 1 ) ? ( nb - 1 ) : 0;
+    for ( unsigned int i = 0; i < nb; i++ ) {
+        DRunParseBatch *b = &( batches[i] );
+        b->st.callback = drun_parse_batch;
+        b->pd          = pd;
+        b->files       = (DRunFile * *) &( files->pdata[i * DRUN_PARSE_BATCH] );
+        b->length      = MIN ( DRUN_PARSE_BATCH, files->len - i * DRUN_PARSE_BATCH );
+        b->entries     = g_array_new ( FALSE, TRUE, sizeof ( DRunModeEntry ) );
+        g_ptr_array_add ( buffers, b->entries );
+        if ( i > 0 && count > 0 ) {
+            b->cond   = &cond;
+            b->mutex  = &mutex;
+            b->acount = &count;
+            g_thread_pool_push ( tpool, b, NULL );
+        }
+    }
+    for ( unsigned int i = 0; i < nb; i++ ) {
+        if ( batches[i].acount == NULL ) {
+            drun_parse_batch ( (thread_state *) &( batches[i] ), NULL );
+        }
+    }
+    g_mutex_lock ( &mutex );
+    while ( count > 0 ) {
+        g_cond_wait ( &cond, &mutex );
+    }
+    g_mutex_unlock ( &mutex );
+    g_cond_clear ( &cond );
+    g_mutex_clear ( &mutex );
+    g_free ( batches );
+    g_ptr_array_free ( files, TRUE );
+}
+
+static void drun_entry_clear ( DRunModeEntry *e );
+
+/**
+ * @param pd The drun mode data.
+ * @param buffers The entry lists of the workers, new ones are added.
+ *
+ * Add the entries of the files in the order the files were found, the first
+ * file with a desktop id wins.
+ */
+static void drun_merge_files ( DRunModePrivateData *pd, GPtrArray *buffers )
+{
+    GArray *late = NULL;
+    g_hash_table_remove_all ( pd->disabled_entries );
+    for ( guint i = 0; i < pd->cache_files->len; i++ ) {
+        DRunFile *file = &g_array_index ( pd->cache_files, DRunFile, i );
+        file->first_entry = pd->cmd_list_length;
+        if ( g_hash_table_contains ( pd->disabled_entries, file->id ) ) {
+            g_debug ( "[%s] [%s] Skipping, was previously seen.", file->id, file->path );
+            file->state = DRUN_FILE_SKIPPED;
+            for ( guint j = 0; j < file->parse_count; j++ ) {
+                drun_entry_clear ( &g_array_index ( file->entries, DRunModeEntry, file->parse_first + j ) );
+            }
+        }
+        else if ( file->cached != NULL && drun_cache_replay_entries ( pd, file->cached ) ) {
+            file->state = file->cached->state;
+        }
+        else {
+            if ( file->entries == NULL ) {
+                // Expected to be skipped, or the cached entries were invalid.
+                if ( late == NULL ) {
+                    late = g_array_new ( FALSE, TRUE, sizeof ( DRunModeEntry ) );
+                    g_ptr_array_add ( buffers, late );
                 }
+                file->entries     = late;
+                file->parse_first = late->len;
+                file->parse_state = read_desktop_file ( pd, late, file->root, file->path, file->basename, file->id );
+                file->parse_count = late->len - file->parse_first;
+                pd->cache_dirty   = TRUE;
             }
-            // Check, we seem to be getting empty string...
-            if ( unique && ( **iter ) != '\0' ) {
-                dir = g_build_filename ( *iter, "applications", NULL );
-                walk_dir ( pd, dir, dir );
-                g_free ( dir );
+            file->state = file->parse_state;
+            for ( guint j = 0; j < file->parse_count; j++ ) {
+                drun_entry_list_add ( pd, &g_array_index ( file->entries, DRunModeEntry, file->parse_first + j ) );
             }
         }
-        TICK_N ( "Get Desktop apps (system dirs)" );
-        get_apps_history ( pd );
+        file->num_entries = pd->cmd_list_length - file->first_entry;
+        // The same file can give a different result when TryExec is found now, or no longer.
+        if ( file->recheck != NULL && ( file->recheck->state != file->state || file->recheck->num_entries != file->num_entries ) ) {
+            pd->cache_dirty = TRUE;
+        }
+        if ( ( file->state & DRUN_FILE_STATE_MASK ) == DRUN_FILE_OK || ( file->state & DRUN_FILE_STATE_MASK ) == DRUN_FILE_DISABLED ) {
+            // We don't want to use items with this id anymore.
+            g_hash_table_add ( pd->disabled_entries, g_strdup ( file->id ) );
+        }
+    }
+}
 
-        g_qsort_with_data ( pd->entry_list, pd->cmd_list_length, sizeof ( DRunModeEntry ), drun_int_sort_list, NULL );
+/**
+ * @param pd The drun mode data.
+ * @param order Filled in with the entries in sorted order.
+ *
+ * Take the ranking from the cache, this only works when the entries are the
+ * ones the cache was written with.
+ *
+ * @returns FALSE if the cached ranking is invalid.
+ */
+static gboolean drun_cache_replay_ranks ( DRunModePrivateData *pd, guint *order )
+{
+    const DRunCacheRank *ranks = pd->cache->ranks;
+    gboolean            *seen  = g_malloc0_n ( pd->cmd_list_length, sizeof ( gboolean ) );
+    gboolean            valid  = TRUE;
+    for ( unsigned int index = 0; valid && index < pd->cmd_list_length; index++ ) {
+        valid = ranks[index].entry < pd->cmd_list_length && !seen[ranks[index].entry];
+        if ( valid ) {
+            seen[ranks[index].entry] = TRUE;
+            order[index]             = ranks[index].entry;
+        }
+    }
+    g_free ( seen );
+    if ( !valid ) {
+        return FALSE;
+    }
+    for ( unsigned int index = 0; index < pd->cmd_list_length; index++ ) {
+        pd->entry_list[ranks[index].entry].sort_index = ranks[index].sort_index;
+    }
+    return TRUE;
+}
 
-        TICK_N ( "Sorting done." );
+/**
+ * @param pd The drun mode data.
+ * @param history_mtime The modification time of the history.
+ * @param history_size The size of the history.
+ *
+ * Rank the entries on history and name. The ranking is taken from the cache
+ * when neither the entries nor the history changed.
+ *
+ * @returns the entries in sorted order, free with g_free().
+ */
+static guint *drun_rank_entries ( DRunModePrivateData *pd, int64_t history_mtime, int64_t history_size )
+{
+    guint *order = g_malloc_n ( pd->cmd_list_length, sizeof ( guint ) );
+    if ( !pd->cache_dirty && pd->cache != NULL && pd->cache->header->num_ranks == pd->cmd_list_length
+         && history_mtime >= 0 && pd->cache->header->history_mtime == history_mtime
+         && pd->cache->header->history_size == history_size ) {
+        if ( drun_cache_replay_ranks ( pd, order ) ) {
+            TICK_N ( "Ranking from cache" );
+            return order;
+        }
+    }
+    get_apps_history ( pd );
+    for ( unsigned int index = 0; index < pd->cmd_list_length; index++ ) {
+        order[index] = index;
+    }
+    g_qsort_with_data ( order, pd->cmd_list_length, sizeof ( guint ), drun_int_sort_order, pd->entry_list );
+    pd->cache_dirty = TRUE;
+    return order;
+}
 
-        write_cache ( pd, cache_file );
+static void get_apps ( DRunModePrivateData *pd )
+{
+    char *cache_file = g_build_filename ( cache_dir, DRUN_DESKTOP_CACHE_FILE, NULL );
+    char *config_key = drun_cache_config_key ();
+    TICK_N ( "Get Desktop apps (start)" );
+    pd->cache       = drun_read_cache ( cache_file, config_key );
+    pd->cache_dirty = ( pd->cache == NULL );
+    pd->cache_dirs  = g_array_new ( FALSE, FALSE, sizeof ( DRunDir ) );
+    pd->cache_files = g_array_new ( FALSE, FALSE, sizeof ( DRunFile ) );
+    g_array_set_clear_func ( pd->cache_dirs, drun_dir_clear );
+    g_array_set_clear_func ( pd->cache_files, drun_file_clear );
+
+    // The files refer to their application directory until they are merged.
+    GPtrArray *roots = g_ptr_array_new_with_free_func ( g_free );
+    // First read the user directory.
+    g_ptr_array_add ( roots, g_build_filename ( g_get_user_data_dir (), "applications", NULL ) );
+    // Then read thee system data dirs.
+    const gchar * const * sys = g_get_system_data_dirs ();
+    for ( const gchar * const *iter = sys; *iter != NULL; ++iter ) {
+        gboolean unique = TRUE;
+        // Stupid duplicate detection, better then walking dir.
+        for ( const gchar *const *iterd = sys; iterd != iter; ++iterd ) {
+            if ( g_strcmp0 ( *iter, *iterd ) == 0 ) {
+                unique = FALSE;
+            }
+        }
+        // Check, we seem to be getting empty string...
+        if ( unique && ( **iter ) != '\0' ) {
+            g_ptr_array_add ( roots, g_build_filename ( *iter, "applications", NULL ) );
+        }
     }
+    for ( guint i = 0; i < roots->len; i++ ) {
+        const char *dir = g_ptr_array_index ( roots, i );
+        walk_dir ( pd, dir, dir );
+    }
+    TICK_N ( "Get Desktop apps (walk dirs)" );
+
+    GPtrArray *buffers = g_ptr_array_new_with_free_func ( (GDestroyNotify) g_array_unref );
+    drun_parse_files ( pd, buffers );
+    TICK_N ( "Get Desktop apps (parse files)" );
+    drun_merge_files ( pd, buffers );
+    g_ptr_array_free ( buffers, TRUE );
+    TICK_N ( "Get Desktop apps (merge files)" );
+
+    // The ranking depends on the history, an absent history is a known state too.
+    char        *history_file  = g_build_filename ( cache_dir, DRUN_CACHE_FILE, NULL );
+    int64_t     history_mtime  = 0;
+    int64_t     history_size   = 0;
+    struct stat st;
+    if ( stat ( history_file, &st ) == 0 ) {
+        history_mtime = drun_cache_mtime ( st.st_mtime );
+        history_size  = st.st_size;
+    }
+    else if ( errno != ENOENT ) {
+        history_mtime = -1;
+    }
+    g_free ( history_file );
+    guint *order = drun_rank_entries ( pd, history_mtime, history_size );
+
+    // Entries are stored in the order they were read, so before sorting.
+    if ( pd->cache_dirty ) {
+        write_cache ( pd, cache_file, config_key, order, history_mtime, history_size );
+    }
+    g_array_free ( pd->cache_dirs, TRUE );
+    g_array_free ( pd->cache_files, TRUE );
+    pd->cache_dirs  = NULL;
+    pd->cache_files = NULL;
+    g_ptr_array_free ( roots, TRUE );
+
+    if ( pd->cmd_list_length > 0 ) {
+        DRunModeEntry *sorted = g_malloc_n ( pd->cmd_list_length_actual, sizeof ( DRunModeEntry ) );
+        for ( unsigned int index = 0; index < pd->cmd_list_length; index++ ) {
+            sorted[index] = pd->entry_list[order[index]];
+        }
+        g_free ( pd->entry_list );
+        pd->entry_list = sorted;
+    }
+    g_free ( order );
+
+    TICK_N ( "Sorting done." );
+    g_free ( config_key );
     g_free ( cache_file );
 }
 
@@ -916,13 +1770,17 @@ static int drun_mode_init ( Mode *sw )
 }
 static void drun_entry_clear ( DRunModeEntry *e )
 {
+    if ( e->icon != NULL ) {
+        cairo_surface_destroy ( e->icon );
+    }
+    if ( e->from_cache ) {
+        // Strings are owned by the cache mapping.
+        return;
+    }
     g_free ( e->root );
     g_free ( e->path );
     g_free ( e->app_id );
     g_free ( e->desktop_id );
-    if ( e->icon != NULL ) {
-        cairo_surface_destroy ( e->icon );
-    }
     g_free ( e->icon_name );
     g_free ( e->exec );
     g_free ( e->name );
@@ -933,9 +1791,6 @@ static void drun_entry_clear ( DRunModeEntry *e )
     }
     g_strfreev ( e->categories );
     g_strfreev ( e->keywords );
-    if ( e->key_file ) {
-        g_key_file_free ( e->key_file );
-    }
 }
 
 static ModeMode drun_mode_result ( Mode *sw, int mretv, char **input, unsigned int selected_line )
@@ -980,6 +1835,7 @@ static void drun_mode_destroy ( Mode *sw )
         }
         g_hash_table_destroy ( rmpd->disabled_entries );
         g_free ( rmpd->entry_list );
+        drun_cache_free ( rmpd->cache );
 
         g_strfreev ( rmpd->current_desktop_list );
         g_strfreev ( rmpd->show_categories );
@@ -41,6 +41,8 @@
 #include <limits.h>
 #include <signal.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <time.h>
 #include <dirent.h>
 #include <strings.h>
 #include <string.h>
@@ -56,20 +58,24 @@
 
 #include "timings.h"
 #include "rofi-icon-fetcher.h"
+#include "rofi-string-store.h"
 /**
  * Name of the history file where previously chosen commands are stored.
  */
 #define RUN_CACHE_FILE    "rofi-3.runcache"
 
+/**
+ * Name of the cache file holding the executables found in PATH.
+ */
+#define RUN_PATH_CACHE_FILE    "rofi-run-path.cache"
+
 /**
  * The internal data structure holding the private data of the Run Mode.
  */
 typedef struct
 {
     /** list of available commands. */
-    char         **cmd_list;
-    /** Length of the #cmd_list. */
-    unsigned int cmd_list_length;
+    RofiStringStore *cmd_list;
 } RunModePrivateData;
 
 /**
@@ -124,55 +130,425 @@ static void delete_entry ( const char *cmd )
     g_free ( path );
 }
 
+/*******************************************
+ * PATH cache                              *
+ *******************************************/
+
 /**
- * @param a The First key to compare
- * @param b The second key to compare
- * @param data Unused.
+ * Version of the PATH cache format.
+ */
+#define RUN_PATH_CACHE_VERSION    1
+
+/**
+ * A directory in PATH and the executables found in it.
+ */
+typedef struct
+{
+    /** The directory as listed in PATH. */
+    const char *path;
+    /** Device of the directory. */
+    uint64_t   dev;
+    /** Inode of the directory. */
+    uint64_t   ino;
+    /** Modification time of the directory, -1 if it should not be reused. */
+    int64_t    mtime;
+    /** Index of the first executable in the scanned list. */
+    uint32_t   first;
+    /** Number of executables. */
+    uint32_t   num_names;
+    /** Cache only: the serialized executables. */
+    const char *names;
+} RunPathDir;
+
+/**
+ * The PATH cache as read from disk.
+ */
+typedef struct
+{
+    /** The file content, all strings point into this. */
+    char       *data;
+    /** End of the file content. */
+    const char *end;
+    /** The cached directories. */
+    RunPathDir *dirs;
+    /** Number of cached directories. */
+    uint32_t   num_dirs;
+} RunPathCache;
+
+/**
+ * @param data The data to read from.
+ * @param end  The end of data.
+ * @param dst  Where to store the read value.
+ * @param size The size of the value.
+ *
+ * @returns the data after the value, or NULL if data is too short.
+ */
+static const char *run_path_cache_read ( const char *data, const char *end, void *dst, size_t size )
+{
+    if ( data == NULL || (size_t) ( end - data ) < size ) {
+        return NULL;
+    }
+    memcpy ( dst, data, size );
+    return data + size;
+}
+
+/**
+ * @param data The data to read from.
+ * @param end  The end of data.
+ * @param str  Set to the NUL terminated string.
+ * @param len  Set to the length of str.
+ *
+ * @returns the data after the string, or NULL if data is too short.
+ */
+static const char *run_path_cache_read_str ( const char *data, const char *end, const char **str, uint32_t *len )
+{
+    data = run_path_cache_read ( data, end, len, sizeof ( *len ) );
+    if ( data == NULL || (size_t) ( end - data ) <= *len || data[*len] != '\0' ) {
+        return NULL;
+    }
+    *str = data;
+    return data + *len + 1;
+}
+
+/**
+ * @param fd  The file to write to.
+ * @param str The string to write.
+ * @param len The length of str.
+ */
+static void run_path_cache_write_str ( FILE *fd, const char *str, uint32_t len )
+{
+    fwrite ( &len, sizeof ( len ), 1, fd );
+    // Also write out the terminating '\0', strings are used in place.
+    fwrite ( str, 1, len + 1, fd );
+}
+
+static void run_path_cache_free ( RunPathCache *cache )
+{
+    if ( cache != NULL ) {
+        g_free ( cache->data );
+        g_free ( cache->dirs );
+        g_free ( cache );
+    }
+}
+
+/**
+ * @param cache_file The cache file to read.
  *
- * Function used for sorting.
+ * Read the PATH cache.
  *
- * @returns returns less then, equal to and greater than zero is a is less than, is a match or greater than b.
+ * @returns the cache or NULL when it does not exist or is invalid.
+ */
+static RunPathCache *run_path_cache_load ( const char *cache_file )
+{
+    gchar *data  = NULL;
+    gsize length = 0;
+    if ( !g_file_get_contents ( cache_file, &data, &length, NULL ) ) {
+        return NULL;
+    }
+    RunPathCache *cache = g_malloc0 ( sizeof ( RunPathCache ) );
+    cache->data = data;
+    cache->end  = data + length;
+
+    const char *end     = cache->end;
+    uint8_t    version  = 0;
+    uint32_t   num_dirs = 0;
+    data = (gchar *) run_path_cache_read ( data, end, &version, sizeof ( version ) );
+    if ( data == NULL || version != RUN_PATH_CACHE_VERSION ) {
+        g_debug ( "PATH cache has the wrong version, ignoring." );
+        run_path_cache_free ( cache );
+        return NULL;
+    }
+    const char *iter = run_path_cache_read ( data, end, &num_dirs, sizeof ( num_dirs ) );
+    // Every directory takes more than one byte, do not trust num_dirs beyond that.
+    cache->dirs = g_malloc0_n ( MIN ( num_dirs, length ), sizeof ( RunPathDir ) );
+    for ( uint32_t i = 0; iter != NULL && i < num_dirs; i++ ) {
+        RunPathDir *dir = &( cache->dirs[i] );
+        uint32_t   len  = 0;
+        iter = run_path_cache_read_str ( iter, end, &( dir->path ), &len );
+        iter = run_path_cache_read ( iter, end, &( dir->dev ), sizeof ( dir->dev ) );
+        iter = run_path_cache_read ( iter, end, &( dir->ino ), sizeof ( dir->ino ) );
+        iter = run_path_cache_read ( iter, end, &( dir->mtime ), sizeof ( dir->mtime ) );
+        iter = run_path_cache_read ( iter, end, &( dir->num_names ), sizeof ( dir->num_names ) );
+        dir->names = iter;
+        for ( uint32_t j = 0; iter != NULL && j < dir->num_names; j++ ) {
+            const char *name = NULL;
+            iter = run_path_cache_read_str ( iter, end, &name, &len );
+        }
+        cache->num_dirs = i + 1;
+    }
+    if ( iter == NULL ) {
+        g_warning ( "PATH cache corrupt, ignoring." );
+        run_path_cache_free ( cache );
+        return NULL;
+    }
+    return cache;
+}
+
+/**
+ * @param cache_file The cache file to write.
+ * @param dirs The scanned directories.
+ * @param scanned The executables found in the directories.
+ *
+ * Write the PATH cache, the old cache is replaced atomically.
  */
-static int sort_func ( const void *a, const void *b, G_GNUC_UNUSED void *data )
+static void run_path_cache_write ( const char *cache_file, GArray *dirs, const RofiStringStore *scanned )
 {
-    const char *astr = *( const char * const * ) a;
-    const char *bstr = *( const char * const * ) b;
+    TICK_N ( "RUN Write PATH cache: start" );
+    // Other instances might be writing their own cache, so use a unique name.
+    char *tmp_file = g_strconcat ( cache_file, ".XXXXXX", NULL );
+    int  tmp_fd    = g_mkstemp ( tmp_file );
+    FILE *fd       = ( tmp_fd >= 0 ) ? fdopen ( tmp_fd, "w" ) : NULL;
+    if ( fd == NULL ) {
+        g_warning ( "Failed to write PATH cache file: '%s'", g_strerror ( errno ) );
+        if ( tmp_fd >= 0 ) {
+            close ( tmp_fd );
+            unlink ( tmp_file );
+        }
+        g_free ( tmp_file );
+        return;
+    }
+    uint8_t  version  = RUN_PATH_CACHE_VERSION;
+    uint32_t num_dirs = dirs->len;
+    fwrite ( &version, sizeof ( version ), 1, fd );
+    fwrite ( &num_dirs, sizeof ( num_dirs ), 1, fd );
+    for ( guint i = 0; i < dirs->len; i++ ) {
+        const RunPathDir *dir = &g_array_index ( dirs, RunPathDir, i );
+        run_path_cache_write_str ( fd, dir->path, strlen ( dir->path ) );
+        fwrite ( &( dir->dev ), sizeof ( dir->dev ), 1, fd );
+        fwrite ( &( dir->ino ), sizeof ( dir->ino ), 1, fd );
+        fwrite ( &( dir->mtime ), sizeof ( dir->mtime ), 1, fd );
+        fwrite ( &( dir->num_names ), sizeof ( dir->num_names ), 1, fd );
+        for ( uint32_t j = dir->first; j < dir->first + dir->num_names; j++ ) {
+            run_path_cache_write_str ( fd, rofi_string_store_get ( scanned, j ), rofi_string_store_get_size ( scanned, j ) );
+        }
+    }
+    if ( fclose ( fd ) != 0 || rename ( tmp_file, cache_file ) != 0 ) {
+        g_warning ( "Failed to write PATH cache file: '%s'", g_strerror ( errno ) );
+        unlink ( tmp_file );
+    }
+    g_free ( tmp_file );
+    TICK_N ( "RUN Write PATH cache: end" );
+}
 
-    if ( astr == NULL && bstr == NULL ) {
-        return 0;
+/**
+ * @param cache The PATH cache (can be NULL).
+ * @param dir The directory to look up, the key is updated to match.
+ *
+ * @returns the cached directory if it is unchanged since it was cached, NULL otherwise.
+ */
+static const RunPathDir *run_path_cache_lookup ( const RunPathCache *cache, const RunPathDir *dir )
+{
+    if ( cache == NULL || dir->mtime < 0 ) {
+        return NULL;
     }
-    else if ( astr == NULL ) {
-        return 1;
+    for ( uint32_t i = 0; i < cache->num_dirs; i++ ) {
+        const RunPathDir *cd = &( cache->dirs[i] );
+        if ( cd->dev == dir->dev && cd->ino == dir->ino && cd->mtime == dir->mtime && g_strcmp0 ( cd->path, dir->path ) == 0 ) {
+            return cd;
+        }
     }
-    else if ( bstr == NULL ) {
-        return -1;
+    return NULL;
+}
+
+/**
+ * @param dirname The directory as listed in PATH.
+ * @param homedir The home directory, in UTF-8.
+ *
+ * Entries of directories in the home directory are only listed when they are executable.
+ *
+ * @returns TRUE if dirname is in the home directory.
+ */
+static gboolean run_path_is_homedir ( const char *dirname, const char *homedir )
+{
+    GError *error = NULL;
+    gchar  *dirn  = g_locale_to_utf8 ( dirname, -1, NULL, NULL, &error );
+    if ( error != NULL ) {
+        g_debug ( "Failed to convert directory name to UTF-8: %s", error->message );
+        g_clear_error ( &error );
+        return FALSE;
     }
-    return g_strcmp0 ( astr, bstr );
+    gboolean is_homedir = g_str_has_prefix ( dirn, homedir );
+    g_free ( dirn );
+    return is_homedir;
+}
+
+/**
+ * @param scanned The store to add the executables to.
+ * @param dirname The directory as listed in PATH.
+ * @param homedir The home directory, in UTF-8.
+ *
+ * Scan a directory in PATH for executables.
+ */
+static void run_path_scan_dir ( RofiStringStore *scanned, const char *dirname, const char *homedir )
+{
+    GError *error = NULL;
+    char   *fpath = rofi_expand_path ( dirname );
+    DIR    *dir   = opendir ( fpath );
+    g_debug ( "Checking path %s for executable.", fpath );
+    g_free ( fpath );
+
+    if ( dir == NULL ) {
+        return;
+    }
+    struct dirent *dent;
+    gboolean      is_homedir = run_path_is_homedir ( dirname, homedir );
+
+    while ( ( dent = readdir ( dir ) ) != NULL ) {
+        if ( dent->d_type != DT_REG && dent->d_type != DT_LNK && dent->d_type != DT_UNKNOWN ) {
+            continue;
+        }
+        // Skip dot files.
+        if ( dent->d_name[0] == '.' ) {
+            continue;
+        }
+        if ( is_homedir ) {
+            gchar    *fpath = g_build_filename ( dirname, dent->d_name, NULL );
+            gboolean b      = g_file_test ( fpath, G_FILE_TEST_IS_EXECUTABLE );
+            g_free ( fpath );
+            if ( !b ) {
+                continue;
+            }
+        }
+
+        gsize name_len;
+        gchar *name = g_filename_to_utf8 ( dent->d_name, -1, NULL, &name_len, &error );
+        if ( error != NULL ) {
+            g_debug ( "Failed to convert filename to UTF-8: %s", error->message );
+            g_clear_error ( &error );
+            g_free ( name );
+            continue;
+        }
+        rofi_string_store_append ( scanned, name, name_len );
+        g_free ( name );
+    }
+
+    closedir ( dir );
+}
+
+/**
+ * @param scanned The store to add the executables to.
+ *
+ * Internal spider used to get list of executables in PATH. Directories that
+ * did not change since the last run are taken from the PATH cache.
+ */
+static void get_apps_path ( RofiStringStore *scanned )
+{
+    GError *error   = NULL;
+    gsize  l        = 0;
+    gchar  *homedir = g_locale_to_utf8 (  g_get_home_dir (), -1, NULL, &l, &error );
+    if ( error != NULL ) {
+        g_debug ( "Failed to convert homedir to UTF-8: %s", error->message );
+        g_clear_error ( &error );
+        g_free ( homedir );
+        return;
+    }
+
+    char         *cache_file = NULL;
+    RunPathCache *cache      = NULL;
+    if ( config.run_use_path_cache ) {
+        cache_file = g_build_filename ( cache_dir, RUN_PATH_CACHE_FILE, NULL );
+        cache      = run_path_cache_load ( cache_file );
+        TICK_N ( "RUN Read PATH cache" );
+    }
+    GArray   *dirs    = g_array_new ( FALSE, TRUE, sizeof ( RunPathDir ) );
+    gboolean changed  = ( cache == NULL );
+    time_t   now      = time ( NULL );
+
+    char              *path               = g_strdup ( g_getenv ( "PATH" ) );
+    const char *const sep                 = ":";
+    char              *strtok_savepointer = NULL;
+    for ( const char *dirname = strtok_r ( path, sep, &strtok_savepointer ); dirname != NULL; dirname = strtok_r ( NULL, sep, &strtok_savepointer ) ) {
+        char        *fpath = rofi_expand_path ( dirname );
+        struct stat st;
+        int         retv = stat ( fpath, &st );
+        g_free ( fpath );
+        if ( retv != 0 || !S_ISDIR ( st.st_mode ) ) {
+            continue;
+        }
+        // Directories in the home directory are filtered on the executable bit of each file,
+        // chmod does not change the directory, so they are always scanned.
+        gboolean   is_homedir = run_path_is_homedir ( dirname, homedir );
+        RunPathDir dir        = {
+            .path  = dirname,
+            .dev   = st.st_dev,
+            .ino   = st.st_ino,
+            // Changes within the same second as the scan would go unnoticed.
+            .mtime = ( is_homedir || st.st_mtime >= now - 1 ) ? -1 : (int64_t) st.st_mtime,
+            .first = rofi_string_store_get_length ( scanned ),
+        };
+        const RunPathDir *cd = run_path_cache_lookup ( cache, &dir );
+        if ( cd != NULL ) {
+            const char *iter = cd->names;
+            for ( uint32_t j = 0; j < cd->num_names; j++ ) {
+                const char *name = NULL;
+                uint32_t   len   = 0;
+                iter = run_path_cache_read_str ( iter, cache->end, &name, &len );
+                rofi_string_store_append ( scanned, name, len );
+            }
+        }
+        else {
+            run_path_scan_dir ( scanned, dirname, homedir );
+            // The cache is never used for them, no need to write it again.
+            changed |= !is_homedir;
+        }
+        dir.num_names = rofi_string_store_get_length ( scanned ) - dir.first;
+        g_array_append_val ( dirs, dir );
+    }
+    if ( cache != NULL && cache->num_dirs != dirs->len ) {
+        changed = TRUE;
+    }
+    TICK_N ( "RUN Scan PATH" );
+    if ( cache_file != NULL && changed ) {
+        run_path_cache_write ( cache_file, dirs, scanned );
+    }
+    g_array_free ( dirs, TRUE );
+    run_path_cache_free ( cache );
+    g_free ( cache_file );
+    g_free ( path );
+    g_free ( homedir );
+}
+
+/**
+ * @param a The First key to compare
+ * @param b The second key to compare
+ * @param data The #RofiStringStore holding the keys, with a sort key column.
+ *
+ * Function used for sorting, in the collation order of the locale.
+ *
+ * @returns returns less then, equal to and greater than zero is a is less than, is a match or greater than b.
+ */
+static int sort_func ( const void *a, const void *b, void *data )
+{
+    const RofiStringStore *store = (const RofiStringStore *) data;
+    const char            *akey  = rofi_string_store_get_sort_key ( store, *( const uint32_t * ) a );
+    const char            *bkey  = rofi_string_store_get_sort_key ( store, *( const uint32_t * ) b );
+    return strcmp ( akey, bkey );
 }
 
 /**
  * External spider to get list of executables.
  */
-static char ** get_apps_external ( char **retv, unsigned int *length, unsigned int num_favorites )
+static void get_apps_external ( RofiStringStore *retv, const HistoryIndex *favorites )
 {
     int fd = execute_generator ( config.run_list_command );
     if ( fd >= 0 ) {
         FILE *inp = fdopen ( fd, "r" );
         if ( inp ) {
-            char   *buffer       = NULL;
-            size_t buffer_length = 0;
+            char    *buffer       = NULL;
+            size_t  buffer_length = 0;
+            ssize_t read_length   = 0;
 
-            while ( getline ( &buffer, &buffer_length, inp ) > 0 ) {
+            while ( ( read_length = getline ( &buffer, &buffer_length, inp ) ) > 0 ) {
                 int found = 0;
                 // Filter out line-end.
-                if ( buffer[strlen ( buffer ) - 1] == '\n' ) {
-                    buffer[strlen ( buffer ) - 1] = '\0';
+                if ( buffer[read_length - 1] == '\n' ) {
+                    buffer[--read_length] = '\0';
                 }
 
                 // This is a nice little penalty, but doable? time will tell.
-                // given num_favorites is max 25.
-                for ( unsigned int j = 0; found == 0 && j < num_favorites; j++ ) {
-                    if ( strcasecmp ( buffer, retv[j] ) == 0 ) {
+                // given the history is max 25 entries.
+                for ( unsigned int j = 0; found == 0 && j < history_index_get_length ( favorites ); j++ ) {
+                    if ( strcasecmp ( buffer, history_index_get_entry ( favorites, j ) ) == 0 ) {
                         found = 1;
                     }
                 }
@@ -181,11 +557,7 @@ static char ** get_apps_external ( char **retv, unsigned int *length, unsigned i
                     continue;
                 }
 
-                // No duplicate, add it.
-                retv              = g_realloc ( retv, ( ( *length ) + 2 ) * sizeof ( char* ) );
-                retv[( *length )] = g_strdup ( buffer );
-
-                ( *length )++;
+                rofi_string_store_append ( retv, buffer, read_length );
             }
             if ( buffer != NULL ) {
                 free ( buffer );
@@ -196,142 +568,62 @@ static char ** get_apps_external ( char **retv, unsigned int *length, unsigned i
             }
         }
     }
-    retv[( *length ) ] = NULL;
-    return retv;
 }
 
 /**
  * Internal spider used to get list of executables.
+ *
+ * @returns the favorites followed by the sorted, de-duplicated, executables.
  */
-static char ** get_apps ( unsigned int *length )
+static RofiStringStore * get_apps ( void )
 {
-    GError       *error        = NULL;
-    char         **retv        = NULL;
-    unsigned int num_favorites = 0;
-    char         *path;
+    RofiStringStore *retv = rofi_string_store_new ( config.case_sensitive ? ROFI_STRING_STORE_PLAIN : ROFI_STRING_STORE_CASEFOLD );
 
     if ( g_getenv ( "PATH" ) == NULL ) {
-        return NULL;
+        return retv;
     }
     TICK_N ( "start" );
-    path = g_build_filename ( cache_dir, RUN_CACHE_FILE, NULL );
-    retv = history_get_list ( path, length );
+    char         *path      = g_build_filename ( cache_dir, RUN_CACHE_FILE, NULL );
+    HistoryIndex *favorites = history_index_open ( path );
     g_free ( path );
-    // Keep track of how many where loaded as favorite.
-    num_favorites = ( *length );
-
-    path = g_strdup ( g_getenv ( "PATH" ) );
-
-    gsize l        = 0;
-    gchar *homedir = g_locale_to_utf8 (  g_get_home_dir (), -1, NULL, &l, &error );
-    if ( error != NULL ) {
-        g_debug ( "Failed to convert homedir to UTF-8: %s", error->message );
-        g_clear_error ( &error );
-        g_free ( homedir );
-        return NULL;
-    }
-
-    const char *const sep                 = ":";
-    char              *strtok_savepointer = NULL;
-    for ( const char *dirname = strtok_r ( path, sep, &strtok_savepointer ); dirname != NULL; dirname = strtok_r ( NULL, sep, &strtok_savepointer ) ) {
-        char *fpath = rofi_expand_path ( dirname );
-        DIR  *dir   = opendir ( fpath );
-        g_debug ( "Checking path %s for executable.", fpath );
-        g_free ( fpath );
-
-        if ( dir != NULL ) {
-            struct dirent *dent;
-            gsize         dirn_len = 0;
-            gchar         *dirn    = g_locale_to_utf8 ( dirname, -1, NULL, &dirn_len, &error );
-            if ( error != NULL ) {
-                g_debug ( "Failed to convert directory name to UTF-8: %s", error->message );
-                g_clear_error ( &error );
-                closedir ( dir );
-                continue;
-            }
-            gboolean is_homedir = g_str_has_prefix ( dirn, homedir );
-            g_free ( dirn );
-
-            while ( ( dent = readdir ( dir ) ) != NULL ) {
-                if ( dent->d_type != DT_REG && dent->d_type != DT_LNK && dent->d_type != DT_UNKNOWN ) {
-                    continue;
-                }
-                // Skip dot files.
-                if ( dent->d_name[0] == '.' ) {
-                    continue;
-                }
-                if ( is_homedir ) {
-                    gchar    *fpath = g_build_filename ( dirname, dent->d_name, NULL );
-                    gboolean b      = g_file_test ( fpath, G_FILE_TEST_IS_EXECUTABLE );
-                    g_free ( fpath );
-                    if ( !b ) {
-                        continue;
-                    }
-                }
 
-                gsize name_len;
-                gchar *name = g_filename_to_utf8 ( dent->d_name, -1, NULL, &name_len, &error );
-                if ( error != NULL ) {
-                    g_debug ( "Failed to convert filename to UTF-8: %s", error->message );
-                    g_clear_error ( &error );
-                    g_free ( name );
-                    continue;
-                }
-                // This is a nice little penalty, but doable? time will tell.
-                // given num_favorites is max 25.
-                int found = 0;
-                for ( unsigned int j = 0; found == 0 && j < num_favorites; j++ ) {
-                    if ( g_strcmp0 ( name, retv[j] ) == 0 ) {
-                        found = 1;
-                    }
-                }
-
-                if ( found == 1 ) {
-                    g_free ( name );
-                    continue;
-                }
-
-                retv                  = g_realloc ( retv, ( ( *length ) + 2 ) * sizeof ( char* ) );
-                retv[( *length )]     = name;
-                retv[( *length ) + 1] = NULL;
-                ( *length )++;
-            }
-
-            closedir ( dir );
+    // Names already in the list, pointing into the stores.
+    GHashTable *seen = g_hash_table_new ( g_str_hash, g_str_equal );
+    for ( unsigned int i = 0; i < history_index_get_length ( favorites ); i++ ) {
+        uint32_t index = rofi_string_store_append ( retv, history_index_get_entry ( favorites, i ), -1 );
+        if ( index != ROFI_STRING_STORE_INVALID ) {
+            g_hash_table_add ( seen, (gpointer) rofi_string_store_get ( retv, index ) );
         }
     }
-    g_free ( homedir );
+
+    // Collect the executables, then copy them sorted behind the favorites.
+    RofiStringStore *scanned = rofi_string_store_new ( ROFI_STRING_STORE_SORT_KEY );
+    get_apps_path ( scanned );
 
     // Get external apps.
     if ( config.run_list_command != NULL && config.run_list_command[0] != '\0' ) {
-        retv = get_apps_external ( retv, length, num_favorites );
-    }
-    // No sorting needed.
-    if ( ( *length ) == 0 ) {
-        return retv;
+        get_apps_external ( scanned, favorites );
     }
-    // TODO: check this is still fast enough. (takes 1ms on laptop.)
-    if ( ( *length ) > num_favorites ) {
-        g_qsort_with_data ( &retv[num_favorites], ( *length ) - num_favorites, sizeof ( char* ), sort_func, NULL );
-    }
-    g_free ( path );
-
-    unsigned int removed = 0;
-    for ( unsigned int index = num_favorites; index < ( ( *length ) - 1 ); index++ ) {
-        if ( g_strcmp0 ( retv[index], retv[index + 1] ) == 0 ) {
-            g_free ( retv[index] );
-            retv[index] = NULL;
-            removed++;
+    history_index_close ( favorites );
+
+    uint32_t length = 0;
+    uint32_t *order = g_malloc ( rofi_string_store_get_length ( scanned ) * sizeof ( uint32_t ) );
+    for ( uint32_t i = 0; i < rofi_string_store_get_length ( scanned ); i++ ) {
+        const char *name = rofi_string_store_get ( scanned, i );
+        // Remove duplicates.
+        if ( g_hash_table_add ( seen, (gpointer) name ) ) {
+            order[length++] = i;
         }
     }
+    g_hash_table_destroy ( seen );
+    // TODO: check this is still fast enough. (takes 1ms on laptop.)
+    g_qsort_with_data ( order, length, sizeof ( uint32_t ), sort_func, scanned );
 
-    if ( ( *length ) > num_favorites ) {
-        g_qsort_with_data ( &retv[num_favorites], ( *length ) - num_favorites, sizeof ( char* ),
-                            sort_func,
-                            NULL );
+    for ( uint32_t i = 0; i < length; i++ ) {
+        rofi_string_store_append ( retv, rofi_string_store_get ( scanned, order[i] ), rofi_string_store_get_size ( scanned, order[i] ) );
     }
-    // Reduce array length;
-    ( *length ) -= removed;
+    g_free ( order );
+    rofi_string_store_free ( scanned );
 
     TICK_N ( "stop" );
     return retv;
@@ -342,7 +634,7 @@ static int run_mode_init ( Mode *sw )
     if ( sw->private_data == NULL ) {
         RunModePrivateData *pd = g_malloc0 ( sizeof ( *pd ) );
         sw->private_data = (void *) pd;
-        pd->cmd_list     = get_apps ( &( pd->cmd_list_length ) );
+        pd->cmd_list     = get_apps ();
     }
 
     return TRUE;
@@ -351,7 +643,7 @@ static void run_mode_destroy ( Mode *sw )
 {
     RunModePrivateData *rmpd = (RunModePrivateData *) sw->private_data;
     if ( rmpd != NULL ) {
-        g_strfreev ( rmpd->cmd_list );
+        rofi_string_store_free ( rmpd->cmd_list );
         g_free ( rmpd );
         sw->private_data = NULL;
     }
@@ -360,7 +652,7 @@ static void run_mode_destroy ( Mode *sw )
 static unsigned int run_mode_get_num_entries ( const Mode *sw )
 {
     const RunModePrivateData *rmpd = (const RunModePrivateData *) sw->private_data;
-    return rmpd->cmd_list_length;
+    return rofi_string_store_get_length ( rmpd->cmd_list );
 }
 
 static ModeMode run_mode_result ( Mode *sw, int mretv, char **input, unsigned int selected_line )
@@ -369,6 +661,7 @@ static ModeMode run_mode_result ( Mode *sw, int mretv, char **input, unsigned in
     ModeMode           retv  = MODE_EXIT;
 
     gboolean           run_in_term = ( ( mretv & MENU_CUSTOM_ACTION ) == MENU_CUSTOM_ACTION );
+    gboolean           valid_line  = selected_line < rofi_string_store_get_length ( rmpd->cmd_list );
 
     if ( mretv & MENU_NEXT ) {
         retv = NEXT_DIALOG;
@@ -379,14 +672,14 @@ static ModeMode run_mode_result ( Mode *sw, int mretv, char **input, unsigned in
     else if ( mretv & MENU_QUICK_SWITCH ) {
         retv = ( mretv & MENU_LOWER_MASK );
     }
-    else if ( ( mretv & MENU_OK ) && rmpd->cmd_list[selected_line] != NULL ) {
-        exec_cmd ( rmpd->cmd_list[selected_line], run_in_term );
+    else if ( ( mretv & MENU_OK ) && valid_line ) {
+        exec_cmd ( rofi_string_store_get ( rmpd->cmd_list, selected_line ), run_in_term );
     }
     else if ( ( mretv & MENU_CUSTOM_INPUT ) && *input != NULL && *input[0] != '\0' ) {
         exec_cmd ( *input, run_in_term );
     }
-    else if ( ( mretv & MENU_ENTRY_DELETE ) && rmpd->cmd_list[selected_line] ) {
-        delete_entry ( rmpd->cmd_list[selected_line] );
+    else if ( ( mretv & MENU_ENTRY_DELETE ) && valid_line ) {
+        delete_entry ( rofi_string_store_get ( rmpd->cmd_list, selected_line ) );
 
         // Clear the list.
         retv = RELOAD_DIALOG;
@@ -399,13 +692,13 @@ static ModeMode run_mode_result ( Mode *sw, int mretv, char **input, unsigned in
 static char *_get_display_value ( const Mode *sw, unsigned int selected_line, G_GNUC_UNUSED int *state, G_GNUC_UNUSED GList **list, int get_entry )
 {
     const RunModePrivateData *rmpd = (const RunModePrivateData *) sw->private_data;
-    return get_entry ? g_strdup ( rmpd->cmd_list[selected_line] ) : NULL;
+    return get_entry ? g_strdup ( rofi_string_store_get ( rmpd->cmd_list, selected_line ) ) : NULL;
 }
 
 static int run_token_match ( const Mode *sw, rofi_int_matcher **tokens, unsigned int index )
 {
     const RunModePrivateData *rmpd = (const RunModePrivateData *) sw->private_data;
-    return helper_token_match ( tokens, rmpd->cmd_list[index] );
+    return helper_token_match_folded ( tokens, rofi_string_store_get ( rmpd->cmd_list, index ), rofi_string_store_get_casefold ( rmpd->cmd_list, index ) );
 }
 
 #include "mode-private.h"
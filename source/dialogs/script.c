@@ -47,6 +47,7 @@
 
 
 #include "rofi-icon-fetcher.h"
+#include "rofi-string-store.h"
 
 #include "dialogs/dmenuscriptshared.h"
 
@@ -57,6 +58,8 @@ typedef struct
     unsigned int           id;
     /** List of visible items. */
     DmenuScriptEntry            *cmd_list;
+    /** Backing store of the cmd_list entries. */
+    RofiStringStore        *strings;
     /** length list of visible items. */
     unsigned int           cmd_list_length;
 
@@ -90,6 +93,23 @@ void dmenuscript_parse_entry_extras ( G_GNUC_UNUSED Mode *sw, DmenuScriptEntry *
     }
 }
 
+/**
+ * Shared function between DMENU and Script mode.
+ */
+uint32_t dmenuscript_append_row ( RofiStringStore *store, const char *data, size_t length )
+{
+    const char *end = NULL;
+    // Copy the valid parts, replacing each invalid byte, straight into the store.
+    while ( !rofi_utf8_validate ( data, length, &end ) ) {
+        rofi_string_store_append_part ( store, data, end - data );
+        rofi_string_store_append_part ( store, "\uFFFD", strlen ( "\uFFFD" ) );
+        length -= ( end - data ) + 1;
+        data    = end + 1;
+    }
+    rofi_string_store_append_part ( store, data, length );
+    return rofi_string_store_append_end ( store );
+}
+
 /**
  * End of shared functions.
  */
@@ -126,11 +146,12 @@ static void parse_header_entry ( Mode *sw, char *line, ssize_t length )
     }
 }
 
-static DmenuScriptEntry *get_script_output ( Mode *sw, char *command, char *arg, unsigned int *length )
+static DmenuScriptEntry *get_script_output ( Mode *sw, char *command, char *arg, unsigned int *length, RofiStringStore **strings )
 {
     int    fd     = -1;
     GError *error = NULL;
     DmenuScriptEntry *retv = NULL;
+    RofiStringStore  *store = rofi_string_store_new ( ROFI_STRING_STORE_PLAIN );
     char   **argv = NULL;
     int    argc   = 0;
     *length = 0;
@@ -169,7 +190,11 @@ static DmenuScriptEntry *get_script_output ( Mode *sw, char *command, char *arg,
                         retv         = g_realloc ( retv, ( actual_size ) * sizeof ( DmenuScriptEntry ) );
                     }
                     size_t buf_length = strlen(buffer)+1;
-                    retv[( *length )].entry     = g_memdup ( buffer, buf_length);
+                    uint32_t index = dmenuscript_append_row ( store, buffer, buf_length - 1 );
+                    if ( index == ROFI_STRING_STORE_INVALID ) {
+                        continue;
+                    }
+                    retv[( *length )].entry     = (char *) rofi_string_store_get ( store, index );
                     retv[( *length )].icon_name = NULL;
                     retv[(*length)].icon_fetch_uid = 0;
                     if ( buf_length > 0 && (read_length > (ssize_t)buf_length)  ) {
@@ -188,12 +213,17 @@ static DmenuScriptEntry *get_script_output ( Mode *sw, char *command, char *arg,
             }
         }
     }
+    if ( retv == NULL ) {
+        rofi_string_store_free ( store );
+        store = NULL;
+    }
+    *strings = store;
     return retv;
 }
 
-static DmenuScriptEntry *execute_executor ( Mode *sw, char *result, unsigned int *length )
+static DmenuScriptEntry *execute_executor ( Mode *sw, char *result, unsigned int *length, RofiStringStore **strings )
 {
-    DmenuScriptEntry *retv = get_script_output ( sw, sw->ed, result, length );
+    DmenuScriptEntry *retv = get_script_output ( sw, sw->ed, result, length, strings );
     return retv;
 }
 
@@ -212,7 +242,7 @@ static int script_mode_init ( Mode *sw )
     if ( sw->private_data == NULL ) {
         ScriptModePrivateData *pd = g_malloc0 ( sizeof ( *pd ) );
         sw->private_data = (void *) pd;
-        pd->cmd_list     = get_script_output ( sw, (char *) sw->ed, NULL, &( pd->cmd_list_length ) );
+        pd->cmd_list     = get_script_output ( sw, (char *) sw->ed, NULL, &( pd->cmd_list_length ), &( pd->strings ) );
     }
     return TRUE;
 }
@@ -239,6 +269,7 @@ static ModeMode script_mode_result ( Mode *sw, int mretv, char **input, unsigned
     ScriptModePrivateData *rmpd      = (ScriptModePrivateData *) sw->private_data;
     ModeMode              retv       = MODE_EXIT;
     DmenuScriptEntry           *new_list  = NULL;
+    RofiStringStore       *new_strings = NULL;
     unsigned int          new_length = 0;
 
     if ( ( mretv & MENU_NEXT ) ) {
@@ -252,22 +283,23 @@ static ModeMode script_mode_result ( Mode *sw, int mretv, char **input, unsigned
     }
     else if ( ( mretv & MENU_OK ) && rmpd->cmd_list[selected_line].entry != NULL ) {
         script_mode_reset_highlight ( sw );
-        new_list = execute_executor ( sw, rmpd->cmd_list[selected_line].entry, &new_length );
+        new_list = execute_executor ( sw, rmpd->cmd_list[selected_line].entry, &new_length, &new_strings );
     }
     else if ( ( mretv & MENU_CUSTOM_INPUT ) && *input != NULL && *input[0] != '\0' ) {
         script_mode_reset_highlight ( sw );
-        new_list = execute_executor ( sw, *input, &new_length );
+        new_list = execute_executor ( sw, *input, &new_length, &new_strings );
     }
 
     // If a new list was generated, use that an loop around.
     if ( new_list != NULL ) {
         for ( unsigned int i = 0; i < rmpd->cmd_list_length; i++ ){
-            g_free ( rmpd->cmd_list[i].entry );
             g_free ( rmpd->cmd_list[i].icon_name );
         }
         g_free ( rmpd->cmd_list );
+        rofi_string_store_free ( rmpd->strings );
 
         rmpd->cmd_list        = new_list;
+        rmpd->strings         = new_strings;
         rmpd->cmd_list_length = new_length;
         retv                  = RESET_DIALOG;
     }
@@ -279,10 +311,10 @@ static void script_mode_destroy ( Mode *sw )
     ScriptModePrivateData *rmpd = (ScriptModePrivateData *) sw->private_data;
     if ( rmpd != NULL ) {
         for ( unsigned int i = 0; i < rmpd->cmd_list_length; i++ ){
-            g_free ( rmpd->cmd_list[i].entry );
             g_free ( rmpd->cmd_list[i].icon_name );
         }
         g_free ( rmpd->cmd_list );
+        rofi_string_store_free ( rmpd->strings );
         g_free ( rmpd->message );
         g_free ( rmpd->prompt );
         g_free ( rmpd->urgent_list );
@@ -54,6 +54,7 @@
 #include "rofi.h"
 #include "settings.h"
 #include "history.h"
+#include "rofi-string-store.h"
 #include "dialogs/ssh.h"
 
 /**
@@ -61,7 +62,7 @@
  */
 typedef struct _SshEntry {
     /** SSH hostname */
-    char *hostname;
+    const char *hostname;
     /** SSH port number */
     int  port;
 } SshEntry;
@@ -71,6 +72,8 @@ typedef struct _SshEntry {
 typedef struct
 {
     GList *user_known_hosts;
+    /** Backing store of the host names. */
+    RofiStringStore *strings;
     /** List if available ssh hosts.*/
     SshEntry *hosts_list;
     /** Length of the #hosts_list.*/
@@ -168,6 +171,33 @@ static void delete_ssh ( const char *host )
 }
 
 /**
+ * @param pd The plugin data handle
+ * @param retv list of hosts
+ * @param length pointer to length of list [in][out]
+ * @param host The host name to add.
+ * @param port The port number, 0 for the default.
+ *
+ * Append host to the list, the name is kept in the string store of pd.
+ *
+ * @returns updated list of hosts.
+ */
+static SshEntry *add_host ( SSHModePrivateData *pd, SshEntry *retv, unsigned int *length, const char *host, int port )
+{
+    uint32_t index = rofi_string_store_append ( pd->strings, host, -1 );
+    if ( index == ROFI_STRING_STORE_INVALID ) {
+        return retv;
+    }
+    retv                           = g_realloc ( retv, ( ( *length ) + 2 ) * sizeof ( SshEntry ) );
+    retv[( *length )].hostname     = rofi_string_store_get ( pd->strings, index );
+    retv[( *length )].port         = port;
+    retv[( *length ) + 1].hostname = NULL;
+    retv[( *length ) + 1].port     = 0;
+    ( *length )++;
+    return retv;
+}
+
+/**
+ * @param pd The plugin data handle
  * @param path Path of the known host file.
  * @param retv list of hosts
  * @param length pointer to length of list [in][out]
@@ -176,7 +206,7 @@ static void delete_ssh ( const char *host )
  *
  * @returns updated list of hosts.
  */
-static SshEntry *read_known_hosts_file ( const char *path, SshEntry * retv, unsigned int *length )
+static SshEntry *read_known_hosts_file ( SSHModePrivateData *pd, const char *path, SshEntry * retv, unsigned int *length )
 {
     FILE *fd   = fopen ( path, "r" );
     if ( fd != NULL ) {
@@ -238,12 +268,7 @@ static SshEntry *read_known_hosts_file ( const char *path, SshEntry * retv, unsi
 
                 if ( !found ) {
                     // Add this host name to the list.
-                    retv                           = g_realloc ( retv, ( ( *length ) + 2 ) * sizeof ( SshEntry ) );
-                    retv[( *length )].hostname     = g_strdup ( start );
-                    retv[( *length )].port         = port;
-                    retv[( *length ) + 1].hostname = NULL;
-                    retv[( *length ) + 1].port     = 0;
-                    ( *length )++;
+                    retv = add_host ( pd, retv, length, start, port );
                 }
                 start = strsep(&sep,", " );
             }
@@ -262,6 +287,7 @@ static SshEntry *read_known_hosts_file ( const char *path, SshEntry * retv, unsi
 }
 
 /**
+ * @param pd The plugin data handle
  * @param retv The list of hosts to update.
  * @param length The length of the list retv [in][out]
  *
@@ -269,7 +295,7 @@ static SshEntry *read_known_hosts_file ( const char *path, SshEntry * retv, unsi
  *
  * @returns an updated list with the added hosts.
  */
-static SshEntry *read_hosts_file ( SshEntry * retv, unsigned int *length )
+static SshEntry *read_hosts_file ( SSHModePrivateData *pd, SshEntry * retv, unsigned int *length )
 {
     // Read the hosts file.
     FILE *fd = fopen ( "/etc/hosts", "r" );
@@ -305,12 +331,7 @@ static SshEntry *read_hosts_file ( SshEntry * retv, unsigned int *length )
 
                             if ( !found ) {
                                 // Add this host name to the list.
-                                retv = g_realloc ( retv,
-                                                   ( ( *length ) + 2 ) * sizeof ( SshEntry ) );
-                                retv[( *length )].hostname     = g_strdup ( token );
-                                retv[( *length )].port         = 0;
-                                retv[( *length ) + 1].hostname = NULL;
-                                ( *length )++;
+                                retv = add_host ( pd, retv, length, token, 0 );
                             }
                         }
                     }
@@ -434,11 +455,7 @@ static void parse_ssh_config_file ( SSHModePrivateData *pd, const char *filename
                     }
 
                     // Add this host name to the list.
-                    ( *retv )                           = g_realloc ( ( *retv ), ( ( *length ) + 2 ) * sizeof ( SshEntry ) );
-                    ( *retv )[( *length )].hostname     = g_strdup ( token );
-                    ( *retv )[( *length )].port         = 0;
-                    ( *retv )[( *length ) + 1].hostname = NULL;
-                    ( *length )++;
+                    ( *retv ) = add_host ( pd, ( *retv ), length, token, 0 );
                 }
             }
             g_free ( low_token );
@@ -472,12 +489,13 @@ static SshEntry * get_ssh (  SSHModePrivateData *pd, unsigned int *length )
     }
 
     path = g_build_filename ( cache_dir, SSH_CACHE_FILE, NULL );
-    char **h = history_get_list ( path, length );
+    HistoryIndex *h = history_index_open ( path );
 
-    retv = malloc ( (*length)*sizeof(SshEntry));
-    for ( unsigned int i = 0; i < (*length); i++ ){
+    *length = 0;
+    for ( unsigned int i = 0; i < history_index_get_length ( h ); i++ ){
         int port = 0;
-        char *portstr = strchr ( h[i], '\x1F' );
+        char *host = g_strdup ( history_index_get_entry ( h, i ) );
+        char *portstr = strchr ( host, '\x1F' );
         if ( portstr != NULL ) {
             *portstr = '\0';
             errno = 0;
@@ -493,10 +511,10 @@ static SshEntry * get_ssh (  SSHModePrivateData *pd, unsigned int *length )
                 port = number;
             }
         }
-        retv[i].hostname = h[i];
-        retv[i].port = port;
+        retv = add_host ( pd, retv, length, host, port );
+        g_free ( host );
     }
-    g_free (h);
+    history_index_close ( h );
 
     g_free ( path );
     num_favorites = ( *length );
@@ -507,16 +525,16 @@ static SshEntry * get_ssh (  SSHModePrivateData *pd, unsigned int *length )
 
     if ( config.parse_known_hosts == TRUE ) {
         char *path = g_build_filename ( g_get_home_dir (), ".ssh", "known_hosts", NULL );
-        retv = read_known_hosts_file ( path, retv, length );
+        retv = read_known_hosts_file ( pd, path, retv, length );
         g_free ( path );
         for ( GList *iter = g_list_first ( pd->user_known_hosts); iter; iter = g_list_next ( iter ) ) {
             char *path = rofi_expand_path ( (const char *)iter->data);
-            retv = read_known_hosts_file ( (const char*)path, retv, length );
+            retv = read_known_hosts_file ( pd, (const char*)path, retv, length );
             g_free (path);
         }
     }
     if ( config.parse_hosts == TRUE ) {
-        retv = read_hosts_file ( retv, length );
+        retv = read_hosts_file ( pd, retv, length );
     }
 
 
@@ -537,6 +555,7 @@ static int ssh_mode_init ( Mode *sw )
     if ( mode_get_private_data ( sw ) == NULL ) {
         SSHModePrivateData *pd = g_malloc0 ( sizeof ( *pd ) );
         mode_set_private_data ( sw, (void *) pd );
+        pd->strings    = rofi_string_store_new ( config.case_sensitive ? ROFI_STRING_STORE_PLAIN : ROFI_STRING_STORE_CASEFOLD );
         pd->hosts_list = get_ssh ( pd, &( pd->hosts_list_length ) );
     }
     return TRUE;
@@ -563,11 +582,9 @@ static void ssh_mode_destroy ( Mode *sw )
 {
     SSHModePrivateData *rmpd = (SSHModePrivateData *) mode_get_private_data ( sw );
     if ( rmpd != NULL ) {
-        for ( unsigned int i = 0; i < rmpd->hosts_list_length; i++ ){
-            g_free( rmpd->hosts_list[i].hostname );
-        }
         g_list_free_full ( rmpd->user_known_hosts, g_free );
         g_free ( rmpd->hosts_list );
+        rofi_string_store_free ( rmpd->strings );
         g_free ( rmpd );
         mode_set_private_data ( sw, NULL );
     }
@@ -643,7 +660,8 @@ static char *_get_display_value ( const Mode *sw, unsigned int selected_line, G_
 static int ssh_token_match ( const Mode *sw, rofi_int_matcher **tokens, unsigned int index )
 {
     SSHModePrivateData *rmpd = (SSHModePrivateData *) mode_get_private_data ( sw );
-    return helper_token_match ( tokens, rmpd->hosts_list[index].hostname );
+    // The hosts are added to the store in list order.
+    return helper_token_match_folded ( tokens, rmpd->hosts_list[index].hostname, rofi_string_store_get_casefold ( rmpd->strings, index ) );
 }
 #include "mode-private.h"
 Mode ssh_mode =
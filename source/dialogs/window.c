@@ -54,6 +54,7 @@
 #include "helper.h"
 #include "widgets/textbox.h"
 #include "dialogs/window.h"
+#include "dialogs/combi.h"
 
 #include "timings.h"
 
@@ -111,8 +112,18 @@ typedef struct
     char                              *wmdesktopstr;
     cairo_surface_t                   *icon;
     gboolean                          icon_checked;
+    /** A _NET_WM_ICON request is in flight. */
+    gboolean                          icon_pending;
+    /** Bumped when _NET_WM_ICON changes, so replies to older requests are dropped. */
+    uint32_t                          icon_serial;
     uint32_t                          icon_fetch_uid;
     gboolean                          thumbnail_checked;
+    /** The formatted row, cleared when a field it shows changes. */
+    char                              *display;
+    /** The mode #display was formatted for. */
+    const void                        *display_pd;
+    /** The display_serial of that mode when #display was formatted. */
+    unsigned int                      display_serial;
 } client;
 
 // window lists
@@ -123,6 +134,28 @@ typedef struct
     int          len;
 } winlist;
 
+// Fields of the window-format.
+typedef enum
+{
+    WIN_FORMAT_LITERAL,
+    WIN_FORMAT_DESKTOP,
+    WIN_FORMAT_CLASS,
+    WIN_FORMAT_TITLE,
+    WIN_FORMAT_NAME,
+    WIN_FORMAT_ROLE,
+    WIN_FORMAT_NUM_FIELDS,
+} WinFormatField;
+
+// One piece of the compiled window-format.
+typedef struct
+{
+    WinFormatField field;
+    // Width of the field, 0 pads it to the widest value.
+    int            width;
+    // Text of a literal.
+    char           *text;
+} WinFormatSegment;
+
 typedef struct
 {
     unsigned int id;
@@ -135,11 +168,53 @@ typedef struct
     unsigned int name_len;
     unsigned int title_len;
     unsigned int role_len;
-    GRegex       *window_regex;
+    // The compiled window-format.
+    GArray       *format;
+    // Bumped when a width the format pads to changes, this invalidates all formatted rows.
+    unsigned int display_serial;
+    // The widths at the last bump.
+    unsigned int display_widths[WIN_FORMAT_NUM_FIELDS];
 } ModeModePrivateData;
 
+// Source of display serials, unique over all modes so a row formatted for another mode never matches.
+static unsigned int window_format_serial = 0;
+/** The cache missed changes while no window mode was shown, see window_mode_get_num_entries(). */
+static gboolean     window_cache_stale = FALSE;
+
 winlist *cache_client = NULL;
 
+/** A _NET_WM_ICON request waiting for its reply. */
+typedef struct
+{
+    xcb_window_t              window;
+    xcb_get_property_cookie_t cookie;
+    uint32_t                  size;
+    uint32_t                  serial;
+} icon_request;
+
+/** The icon requests sent while drawing, collected together afterwards. */
+static GArray *icon_requests      = NULL;
+/** Source that collects #icon_requests. */
+static guint  icon_requests_idle = 0;
+
+/**
+ * Drop the outstanding icon requests without waiting for their replies.
+ */
+static void icon_requests_cancel ( void )
+{
+    if ( icon_requests_idle > 0 ) {
+        g_source_remove ( icon_requests_idle );
+        icon_requests_idle = 0;
+    }
+    if ( icon_requests != NULL ) {
+        for ( guint i = 0; i < icon_requests->len; i++ ) {
+            xcb_discard_reply ( xcb->connection, g_array_index ( icon_requests, icon_request, i ).cookie.sequence );
+        }
+        g_array_free ( icon_requests, TRUE );
+        icon_requests = NULL;
+    }
+}
+
 /**
  * Create a window list, pre-seeded with WINLIST entries.
  *
@@ -180,24 +255,55 @@ static int winlist_append ( winlist *l, xcb_window_t w, client *d )
     return l->len - 1;
 }
 
+static void client_free ( client *c )
+{
+    if ( c == NULL ) {
+        return;
+    }
+    if ( c->icon ) {
+        cairo_surface_destroy ( c->icon );
+    }
+    g_free ( c->title );
+    g_free ( c->class );
+    g_free ( c->name );
+    g_free ( c->role );
+    g_free ( c->wmdesktopstr );
+    g_free ( c->display );
+    g_free ( c );
+}
+
+/**
+ * @param c The client.
+ *
+ * Drop the formatted row, a field it shows changed.
+ */
+static void client_clear_display ( client *c )
+{
+    g_free ( c->display );
+    c->display = NULL;
+}
+
 static void winlist_empty ( winlist *l )
 {
     while ( l->len > 0 ) {
-        client *c = l->data[--l->len];
-        if ( c != NULL ) {
-            if ( c->icon ) {
-                cairo_surface_destroy ( c->icon );
-            }
-            g_free ( c->title );
-            g_free ( c->class );
-            g_free ( c->name );
-            g_free ( c->role );
-            g_free ( c->wmdesktopstr );
-            g_free ( c );
-        }
+        client_free ( l->data[--l->len] );
     }
 }
 
+/**
+ * @param l The winlist.
+ * @param idx The entry to remove.
+ *
+ * Remove one entry and free its data, keeping the order of the others.
+ */
+static void winlist_remove ( winlist *l, int idx )
+{
+    client_free ( l->data[idx] );
+    l->len--;
+    memmove ( &( l->array[idx] ), &( l->array[idx + 1] ), ( l->len - idx ) * sizeof ( xcb_window_t ) );
+    memmove ( &( l->data[idx] ), &( l->data[idx + 1] ), ( l->len - idx ) * sizeof ( client* ) );
+}
+
 /**
  * @param l The winlist entry
  *
@@ -235,13 +341,26 @@ static int winlist_find ( winlist *l, xcb_window_t w )
 
     return -1;
 }
+/**
+ * @param w The window.
+ * @param mask The event mask.
+ *
+ * Set the events rofi receives for a window it does not own.
+ */
+static void window_select_events ( xcb_window_t w, uint32_t mask )
+{
+    xcb_change_window_attributes ( xcb->connection, w, XCB_CW_EVENT_MASK, &mask );
+}
+
 /**
  * Create empty X11 cache for windows and windows attributes.
+ * The cache is kept up to date from PropertyNotify events on the root and the cached windows.
  */
 static void x11_cache_create ( void )
 {
     if ( cache_client == NULL ) {
         cache_client = winlist_new ();
+        window_select_events ( xcb_stuff_get_root_window (), XCB_EVENT_MASK_PROPERTY_CHANGE );
     }
 }
 
@@ -250,28 +369,44 @@ static void x11_cache_create ( void )
  */
 static void x11_cache_free ( void )
 {
+    window_cache_stale = FALSE;
+    if ( cache_client == NULL ) {
+        return;
+    }
+    icon_requests_cancel ();
+    window_select_events ( xcb_stuff_get_root_window (), XCB_EVENT_MASK_NO_EVENT );
+    for ( int i = 0; i < cache_client->len; i++ ) {
+        window_select_events ( cache_client->array[i], XCB_EVENT_MASK_NO_EVENT );
+    }
     winlist_free ( cache_client );
     cache_client = NULL;
 }
 
 /**
- * @param d Display connection to X server
- * @param w window
- *
- * Get window attributes.
- * This functions uses caching.
+ * @param windows The windows currently managed.
+ * @param len The number of windows.
  *
- * @returns a XWindowAttributes
+ * Drop the cached clients of windows that are no longer managed.
  */
-static xcb_get_window_attributes_reply_t * window_get_attributes ( xcb_window_t w )
+static void x11_cache_prune ( const xcb_window_t *windows, uint32_t len )
 {
-    xcb_get_window_attributes_cookie_t c  = xcb_get_window_attributes ( xcb->connection, w );
-    xcb_get_window_attributes_reply_t  *r = xcb_get_window_attributes_reply ( xcb->connection, c, NULL );
-    if ( r ) {
-        return r;
+    // Both window modes share the cache, keep what the rows of either still show.
+    const Mode *modes[] = { &window_mode, &window_mode_cd };
+    for ( int i = cache_client->len - 1; i >= 0; i-- ) {
+        gboolean found = FALSE;
+        for ( uint32_t j = 0; !found && j < len; j++ ) {
+            found = ( windows[j] == cache_client->array[i] );
+        }
+        for ( unsigned int m = 0; !found && m < G_N_ELEMENTS ( modes ); m++ ) {
+            const ModeModePrivateData *pd = (const ModeModePrivateData *) mode_get_private_data ( modes[m] );
+            found = ( pd != NULL && pd->ids != NULL && winlist_find ( pd->ids, cache_client->array[i] ) >= 0 );
+        }
+        if ( !found ) {
+            winlist_remove ( cache_client, i );
+        }
     }
-    return NULL;
 }
+
 // _NET_WM_STATE_*
 static int client_has_state ( client *c, xcb_atom_t state )
 {
@@ -294,22 +429,141 @@ static int client_has_window_type ( client *c, xcb_atom_t type )
     return 0;
 }
 
-static client* window_client ( ModeModePrivateData *pd, xcb_window_t win )
+/**
+ * Outstanding requests for one client, so the requests for all clients can be
+ * sent before waiting for the first reply.
+ */
+typedef struct
 {
-    if ( win == XCB_WINDOW_NONE ) {
-        return NULL;
+    /** Index in the client cache, or -1 when the requests below were sent. */
+    int                                cache_index;
+    xcb_get_window_attributes_cookie_t attributes;
+    xcb_get_property_cookie_t          state;
+    xcb_get_property_cookie_t          window_type;
+    xcb_get_property_cookie_t          net_wm_name;
+    xcb_get_property_cookie_t          wm_name;
+    xcb_get_property_cookie_t          role;
+    xcb_get_property_cookie_t          class;
+    xcb_get_property_cookie_t          hints;
+} client_cookies;
+
+/**
+ * @param win The window to query.
+ * @param ck  Filled with the cookies of the requests sent.
+ *
+ * Send the requests needed to build the client for win, unless it is cached.
+ */
+static void window_client_send ( xcb_window_t win, client_cookies *ck )
+{
+    ck->cache_index = winlist_find ( cache_client, win );
+    if ( ck->cache_index >= 0 ) {
+        return;
     }
+    // Select before reading, so no change can slip in between.
+    window_select_events ( win, XCB_EVENT_MASK_PROPERTY_CHANGE );
+    ck->attributes  = xcb_get_window_attributes ( xcb->connection, win );
+    ck->state       = xcb_ewmh_get_wm_state ( &xcb->ewmh, win );
+    ck->window_type = xcb_ewmh_get_wm_window_type ( &xcb->ewmh, win );
+    ck->net_wm_name = window_get_text_prop_cookie ( win, xcb->ewmh._NET_WM_NAME );
+    ck->wm_name     = window_get_text_prop_cookie ( win, XCB_ATOM_WM_NAME );
+    ck->role        = window_get_text_prop_cookie ( win, netatoms[WM_WINDOW_ROLE] );
+    ck->class       = xcb_icccm_get_wm_class ( xcb->connection, win );
+    ck->hints       = xcb_icccm_get_wm_hints ( xcb->connection, win );
+}
 
-    int idx = winlist_find ( cache_client, win );
+/**
+ * @param c The client to update.
+ * @param cky The _NET_WM_STATE request.
+ */
+static void window_client_read_state ( client *c, xcb_get_property_cookie_t cky )
+{
+    xcb_ewmh_get_atoms_reply_t states;
+    c->states = 0;
+    if ( xcb_ewmh_get_wm_state_reply ( &xcb->ewmh, cky, &states, NULL ) ) {
+        c->states = MIN ( CLIENTSTATE, states.atoms_len );
+        memcpy ( c->state, states.atoms, MIN ( CLIENTSTATE, states.atoms_len ) * sizeof ( xcb_atom_t ) );
+        xcb_ewmh_get_atoms_reply_wipe ( &states );
+    }
+}
 
-    if ( idx >= 0 ) {
-        return cache_client->data[idx];
+/**
+ * @param c The client to update.
+ * @param net_wm_name The _NET_WM_NAME request.
+ * @param wm_name The WM_NAME request, used when _NET_WM_NAME is not set.
+ */
+static void window_client_read_title ( client *c, xcb_get_property_cookie_t net_wm_name, xcb_get_property_cookie_t wm_name )
+{
+    char *title  = window_get_text_prop_reply ( net_wm_name );
+    char *legacy = window_get_text_prop_reply ( wm_name );
+    if ( title == NULL ) {
+        title  = legacy;
+        legacy = NULL;
+    }
+    g_free ( legacy );
+    g_free ( c->title );
+    c->title = title;
+    client_clear_display ( c );
+}
+
+/**
+ * @param c The client to update.
+ * @param cky The WM_CLASS request.
+ */
+static void window_client_read_class ( client *c, xcb_get_property_cookie_t cky )
+{
+    xcb_icccm_get_wm_class_reply_t wcr;
+    g_free ( c->class );
+    g_free ( c->name );
+    c->class = NULL;
+    c->name  = NULL;
+    client_clear_display ( c );
+    if ( xcb_icccm_get_wm_class_reply ( xcb->connection, cky, &wcr, NULL ) ) {
+        c->class = rofi_latin_to_utf8_strdup ( wcr.class_name, -1 );
+        c->name  = rofi_latin_to_utf8_strdup ( wcr.instance_name, -1 );
+        xcb_icccm_get_wm_class_reply_wipe ( &wcr );
+    }
+}
+
+/**
+ * @param c The client to update.
+ * @param cky The WM_HINTS request.
+ */
+static void window_client_read_hints ( client *c, xcb_get_property_cookie_t cky )
+{
+    xcb_icccm_wm_hints_t r;
+    c->hint_flags = 0;
+    if ( xcb_icccm_get_wm_hints_reply ( xcb->connection, cky, &r, NULL ) ) {
+        c->hint_flags = r.flags;
+    }
+}
+
+/**
+ * @param pd  The mode private data, field widths are updated.
+ * @param win The window queried.
+ * @param ck  The cookies filled in by window_client_send().
+ *
+ * Collect the replies for win and add the client to the cache.
+ *
+ * @returns the client or NULL when the window no longer exists.
+ */
+static client* window_client_receive ( ModeModePrivateData *pd, xcb_window_t win, client_cookies *ck )
+{
+    if ( ck->cache_index >= 0 ) {
+        return cache_client->data[ck->cache_index];
     }
 
     // if this fails, we're up that creek
-    xcb_get_window_attributes_reply_t *attr = window_get_attributes ( win );
+    xcb_get_window_attributes_reply_t *attr = xcb_get_window_attributes_reply ( xcb->connection, ck->attributes, NULL );
 
     if ( !attr ) {
+        // Window is gone, drop the replies still in flight.
+        xcb_discard_reply ( xcb->connection, ck->state.sequence );
+        xcb_discard_reply ( xcb->connection, ck->window_type.sequence );
+        xcb_discard_reply ( xcb->connection, ck->net_wm_name.sequence );
+        xcb_discard_reply ( xcb->connection, ck->wm_name.sequence );
+        xcb_discard_reply ( xcb->connection, ck->role.sequence );
+        xcb_discard_reply ( xcb->connection, ck->class.sequence );
+        xcb_discard_reply ( xcb->connection, ck->hints.sequence );
         return NULL;
     }
     client *c = g_malloc0 ( sizeof ( client ) );
@@ -318,48 +572,39 @@ static client* window_client ( ModeModePrivateData *pd, xcb_window_t win )
     // copy xattr so we don't have to care when stuff is freed
     memmove ( &c->xattr, attr, sizeof ( xcb_get_window_attributes_reply_t ) );
 
-    xcb_get_property_cookie_t  cky = xcb_ewmh_get_wm_state ( &xcb->ewmh, win );
+    window_client_read_state ( c, ck->state );
     xcb_ewmh_get_atoms_reply_t states;
-    if ( xcb_ewmh_get_wm_state_reply ( &xcb->ewmh, cky, &states, NULL ) ) {
-        c->states = MIN ( CLIENTSTATE, states.atoms_len );
-        memcpy ( c->state, states.atoms, MIN ( CLIENTSTATE, states.atoms_len ) * sizeof ( xcb_atom_t ) );
-        xcb_ewmh_get_atoms_reply_wipe ( &states );
-    }
-    cky = xcb_ewmh_get_wm_window_type ( &xcb->ewmh, win );
-    if ( xcb_ewmh_get_wm_window_type_reply ( &xcb->ewmh, cky, &states, NULL ) ) {
+    if ( xcb_ewmh_get_wm_window_type_reply ( &xcb->ewmh, ck->window_type, &states, NULL ) ) {
         c->window_types = MIN ( CLIENTWINDOWTYPE, states.atoms_len );
         memcpy ( c->window_type, states.atoms, MIN ( CLIENTWINDOWTYPE, states.atoms_len ) * sizeof ( xcb_atom_t ) );
         xcb_ewmh_get_atoms_reply_wipe ( &states );
     }
 
-    c->title = window_get_text_prop ( c->window, xcb->ewmh._NET_WM_NAME );
-    if ( c->title == NULL ) {
-        c->title = window_get_text_prop ( c->window, XCB_ATOM_WM_NAME );
-    }
+    window_client_read_title ( c, ck->net_wm_name, ck->wm_name );
     pd->title_len = MAX ( c->title ? g_utf8_strlen ( c->title, -1 ) : 0, pd->title_len );
 
-    c->role      = window_get_text_prop ( c->window, netatoms[WM_WINDOW_ROLE] );
+    c->role      = window_get_text_prop_reply ( ck->role );
     pd->role_len = MAX ( c->role ? g_utf8_strlen ( c->role, -1 ) : 0, pd->role_len );
 
-    cky = xcb_icccm_get_wm_class ( xcb->connection, c->window );
-    xcb_icccm_get_wm_class_reply_t wcr;
-    if ( xcb_icccm_get_wm_class_reply ( xcb->connection, cky, &wcr, NULL ) ) {
-        c->class     = rofi_latin_to_utf8_strdup ( wcr.class_name, -1 );
-        c->name      = rofi_latin_to_utf8_strdup ( wcr.instance_name, -1 );
-        pd->name_len = MAX ( c->name ? g_utf8_strlen ( c->name, -1 ) : 0, pd->name_len );
-        xcb_icccm_get_wm_class_reply_wipe ( &wcr );
-    }
+    window_client_read_class ( c, ck->class );
+    pd->name_len = MAX ( c->name ? g_utf8_strlen ( c->name, -1 ) : 0, pd->name_len );
 
-    xcb_get_property_cookie_t cc = xcb_icccm_get_wm_hints ( xcb->connection, c->window );
-    xcb_icccm_wm_hints_t      r;
-    if ( xcb_icccm_get_wm_hints_reply ( xcb->connection, cc, &r, NULL ) ) {
-        c->hint_flags = r.flags;
-    }
+    window_client_read_hints ( c, ck->hints );
 
     winlist_append ( cache_client, c->window, c );
     g_free ( attr );
     return c;
 }
+
+static client* window_client ( ModeModePrivateData *pd, xcb_window_t win )
+{
+    if ( win == XCB_WINDOW_NONE ) {
+        return NULL;
+    }
+    client_cookies ck;
+    window_client_send ( win, &ck );
+    return window_client_receive ( pd, win, &ck );
+}
 static int window_match ( const Mode *sw, rofi_int_matcher **tokens, unsigned int index )
 {
     ModeModePrivateData *rmpd = (ModeModePrivateData *) mode_get_private_data ( sw );
@@ -443,8 +688,15 @@ static void window_mode_parse_fields ()
     g_free ( switcher_str );
 }
 
+static void window_mode_reload ( void );
+
 static unsigned int window_mode_get_num_entries ( const Mode *sw )
 {
+    if ( window_cache_stale ) {
+        // Changes were missed while another mode was shown, start from an empty cache.
+        x11_cache_free ();
+        window_mode_reload ();
+    }
     const ModeModePrivateData *pd = (const ModeModePrivateData *) mode_get_private_data ( sw );
 
     return pd->ids ? pd->ids->len : 0;
@@ -470,35 +722,48 @@ static void _window_mode_load_data ( Mode *sw, unsigned int cd )
     ModeModePrivateData *pd = (ModeModePrivateData *) mode_get_private_data ( sw );
     // find window list
     xcb_window_t        curr_win_id;
-    int found = 0;
+    int                 found = 0;
 
+    TICK_N ( "Window mode load start" );
     // Create cache
 
     x11_cache_create ();
-    xcb_get_property_cookie_t c = xcb_ewmh_get_active_window ( &( xcb->ewmh ), xcb->screen_nbr );
+    xcb_get_property_cookie_t c              = xcb_ewmh_get_active_window ( &( xcb->ewmh ), xcb->screen_nbr );
+    xcb_get_property_cookie_t desktop_cookie = xcb_ewmh_get_current_desktop ( &xcb->ewmh, xcb->screen_nbr );
+    xcb_get_property_cookie_t names_cookie   = xcb_ewmh_get_desktop_names ( &xcb->ewmh, xcb->screen_nbr );
+    xcb_get_property_cookie_t stack_cookie   = xcb_ewmh_get_client_list_stacking ( &xcb->ewmh, 0 );
+    xcb_get_property_cookie_t list_cookie    = xcb_ewmh_get_client_list ( &xcb->ewmh, xcb->screen_nbr );
+    // All root properties are requested before the first reply is waited for.
+
     if ( !xcb_ewmh_get_active_window_reply ( &xcb->ewmh, c, &curr_win_id, NULL ) ) {
         curr_win_id = 0;
     }
 
     // Get the current desktop.
     unsigned int current_desktop = 0;
-    c = xcb_ewmh_get_current_desktop ( &xcb->ewmh, xcb->screen_nbr );
-    if ( !xcb_ewmh_get_current_desktop_reply ( &xcb->ewmh, c, &current_desktop, NULL ) ) {
+    if ( !xcb_ewmh_get_current_desktop_reply ( &xcb->ewmh, desktop_cookie, &current_desktop, NULL ) ) {
         current_desktop = 0;
     }
 
-    c = xcb_ewmh_get_client_list_stacking ( &xcb->ewmh, 0 );
-    xcb_ewmh_get_windows_reply_t clients = {0,};
-    if ( xcb_ewmh_get_client_list_stacking_reply ( &xcb->ewmh, c, &clients, NULL ) ) {
+    xcb_ewmh_get_utf8_strings_reply_t names;
+    int                               has_names = FALSE;
+    if ( xcb_ewmh_get_desktop_names_reply ( &xcb->ewmh, names_cookie, &names, NULL ) ) {
+        has_names = TRUE;
+    }
+
+    xcb_ewmh_get_windows_reply_t clients = { 0, };
+    if ( xcb_ewmh_get_client_list_stacking_reply ( &xcb->ewmh, stack_cookie, &clients, NULL ) ) {
+        xcb_discard_reply ( xcb->connection, list_cookie.sequence );
         found = 1;
     }
-    else {
-        c = xcb_ewmh_get_client_list ( &xcb->ewmh, xcb->screen_nbr );
-        if  ( xcb_ewmh_get_client_list_reply ( &xcb->ewmh, c, &clients, NULL ) ) {
-            found = 1;
-        }
+    else if  ( xcb_ewmh_get_client_list_reply ( &xcb->ewmh, list_cookie, &clients, NULL ) ) {
+        found = 1;
     }
+    TICK_N ( "Window mode root properties" );
     if ( ! found ) {
+        if ( has_names ) {
+            xcb_ewmh_get_utf8_strings_reply_wipe ( &names );
+        }
         return;
     }
 
@@ -508,15 +773,20 @@ static void _window_mode_load_data ( Mode *sw, unsigned int cd )
         // if we happen to have a window destroyed while we're working...
         pd->ids = winlist_new ();
 
-        xcb_get_property_cookie_t         c = xcb_ewmh_get_desktop_names ( &xcb->ewmh, xcb->screen_nbr );
-        xcb_ewmh_get_utf8_strings_reply_t names;
-        int                               has_names = FALSE;
-        if ( xcb_ewmh_get_desktop_names_reply ( &xcb->ewmh, c, &names, NULL ) ) {
-            has_names = TRUE;
+        client_cookies            *cookies         = g_malloc0_n ( clients.windows_len, sizeof ( client_cookies ) );
+        xcb_get_property_cookie_t *desktop_cookies = g_malloc0_n ( clients.windows_len, sizeof ( xcb_get_property_cookie_t ) );
+        for ( i = 0; i < (int) clients.windows_len; i++ ) {
+            window_client_send ( clients.windows[i], &( cookies[i] ) );
+            desktop_cookies[i] = xcb_get_property ( xcb->connection, 0, clients.windows[i],
+                                                    xcb->ewmh._NET_WM_DESKTOP, XCB_ATOM_CARDINAL, 0, 1 );
         }
+        TICK_N ( "Window mode client requests" );
+
         // calc widths of fields
         for ( i = clients.windows_len - 1; i > -1; i-- ) {
-            client *c = window_client ( pd, clients.windows[i] );
+            client                   *c = window_client_receive ( pd, clients.windows[i], &( cookies[i] ) );
+            // find client's desktop.
+            xcb_get_property_reply_t *r = xcb_get_property_reply ( xcb->connection, desktop_cookies[i], NULL );
             if ( ( c != NULL )
                  && !c->xattr.override_redirect
                  && !client_has_window_type ( c, xcb->ewmh._NET_WM_WINDOW_TYPE_DOCK )
@@ -525,73 +795,380 @@ static void _window_mode_load_data ( Mode *sw, unsigned int cd )
                  && !client_has_state ( c, xcb->ewmh._NET_WM_STATE_SKIP_TASKBAR ) ) {
                 pd->clf_len = MAX ( pd->clf_len, ( c->class != NULL ) ? ( g_utf8_strlen ( c->class, -1 ) ) : 0 );
 
-                if ( client_has_state ( c, xcb->ewmh._NET_WM_STATE_DEMANDS_ATTENTION ) ) {
-                    c->demands = TRUE;
-                }
-                if ( ( c->hint_flags & XCB_ICCCM_WM_HINT_X_URGENCY ) != 0 ) {
-                    c->demands = TRUE;
-                }
-
-                if ( c->window == curr_win_id ) {
-                    c->active = TRUE;
-                }
-                // find client's desktop.
-                xcb_get_property_cookie_t cookie;
-                xcb_get_property_reply_t  *r;
+                // Cached clients are reused on reload, so clear flags that no longer hold.
+                c->demands = client_has_state ( c, xcb->ewmh._NET_WM_STATE_DEMANDS_ATTENTION )
+                             || ( c->hint_flags & XCB_ICCCM_WM_HINT_X_URGENCY ) != 0;
+                c->active = ( c->window == curr_win_id );
 
                 c->wmdesktop = 0xFFFFFFFF;
-                cookie       =
-                    xcb_get_property ( xcb->connection, 0, c->window, xcb->ewmh._NET_WM_DESKTOP, XCB_ATOM_CARDINAL, 0,
-                                       1 );
-                r = xcb_get_property_reply ( xcb->connection, cookie, NULL );
-                if ( r ) {
-                    if ( r->type == XCB_ATOM_CARDINAL ) {
-                        c->wmdesktop = *( (uint32_t *) xcb_get_property_value ( r ) );
-                    }
-                    free ( r );
+                if ( r && r->type == XCB_ATOM_CARDINAL ) {
+                    c->wmdesktop = *( (uint32_t *) xcb_get_property_value ( r ) );
                 }
+                char *wmdesktopstr = NULL;
                 if ( c->wmdesktop != 0xFFFFFFFF ) {
                     if ( has_names ) {
                         if ( ( current_window_manager & WM_PANGO_WORKSPACE_NAMES ) == WM_PANGO_WORKSPACE_NAMES ) {
                             char *output = NULL;
                             if ( pango_parse_markup ( _window_name_list_entry ( names.strings, names.strings_len,
                                                                                 c->wmdesktop ), -1, 0, NULL, &output, NULL, NULL ) ) {
-                                c->wmdesktopstr = output;
+                                wmdesktopstr = output;
                             }
                             else {
-                                c->wmdesktopstr = g_strdup ( "Invalid name" );
+                                wmdesktopstr = g_strdup ( "Invalid name" );
                             }
                         }
                         else {
-                            c->wmdesktopstr = g_strdup ( _window_name_list_entry ( names.strings, names.strings_len, c->wmdesktop ) );
+                            wmdesktopstr = g_strdup ( _window_name_list_entry ( names.strings, names.strings_len, c->wmdesktop ) );
                         }
                     }
                     else {
-                        c->wmdesktopstr = g_strdup_printf ( "%u", (uint32_t) c->wmdesktop );
+                        wmdesktopstr = g_strdup_printf ( "%u", (uint32_t) c->wmdesktop );
                     }
                 }
                 else {
-                    c->wmdesktopstr = g_strdup ( "" );
+                    wmdesktopstr = g_strdup ( "" );
+                }
+                // The client can already be cached by an earlier load, keep its row if nothing changed.
+                if ( g_strcmp0 ( c->wmdesktopstr, wmdesktopstr ) != 0 ) {
+                    g_free ( c->wmdesktopstr );
+                    c->wmdesktopstr = wmdesktopstr;
+                    client_clear_display ( c );
+                }
+                else {
+                    g_free ( wmdesktopstr );
                 }
                 pd->wmdn_len = MAX ( pd->wmdn_len, g_utf8_strlen ( c->wmdesktopstr, -1 ) );
-                if ( cd && c->wmdesktop != current_desktop ) {
-                    continue;
+                if ( !( cd && c->wmdesktop != current_desktop ) ) {
+                    winlist_append ( pd->ids, c->window, NULL );
                 }
-                winlist_append ( pd->ids, c->window, NULL );
             }
+            free ( r );
         }
+        g_free ( desktop_cookies );
+        g_free ( cookies );
+    }
+    x11_cache_prune ( clients.windows, clients.windows_len );
+    if ( has_names ) {
+        xcb_ewmh_get_utf8_strings_reply_wipe ( &names );
+    }
+    TICK_N ( "Window mode client properties" );
+    g_debug ( "Window mode: loaded %u clients.", clients.windows_len );
+    xcb_ewmh_get_windows_reply_wipe ( &clients );
+}
+static void helper_eval_add_str ( GString *str, const char *input, int l, int max_len )
+{
+    // g_utf8 does not work with NULL string.
+    const char *input_nn = input ? input : "";
+    // Both l and max_len are in characters, not bytes.
+    int        nc     = g_utf8_strlen ( input_nn, -1 );
+    int        spaces = 0;
+    if ( l == 0 ) {
+        spaces = MAX ( 0, max_len - nc );
+        g_string_append ( str, input_nn );
+    }
+    else {
+        if ( nc > l ) {
+            int bl = g_utf8_offset_to_pointer ( input_nn, l ) - input_nn;
+            g_string_append_len ( str, input_nn, bl );
+        }
+        else {
+            spaces = l - nc;
+            g_string_append ( str, input_nn );
+        }
+    }
+    while ( spaces-- ) {
+        g_string_append_c ( str, ' ' );
+    }
+}
 
-        if ( has_names ) {
-            xcb_ewmh_get_utf8_strings_reply_wipe ( &names );
+static void window_format_segment_clear ( void *data )
+{
+    WinFormatSegment *seg = (WinFormatSegment *) data;
+    g_free ( seg->text );
+}
+
+static void window_format_add_literal ( GArray *format, const char *text, gssize len )
+{
+    WinFormatSegment seg = { WIN_FORMAT_LITERAL, 0, g_strndup ( text, len ) };
+    g_array_append_val ( format, seg );
+}
+
+/**
+ * @param str The window-format, fields look like {t} or {t:20}.
+ *
+ * Split the format into literals and fields once, so rows can be formatted without matching it again.
+ * Only the first letter of a field is significant, unknown fields are dropped.
+ *
+ * @returns a GArray of WinFormatSegment.
+ */
+static GArray * window_format_compile ( const char *str )
+{
+    GArray     *format = g_array_new ( FALSE, TRUE, sizeof ( WinFormatSegment ) );
+    g_array_set_clear_func ( format, window_format_segment_clear );
+    GRegex     *regex = g_regex_new ( "{[-\\w]+(:-?[0-9]+)?}", 0, 0, NULL );
+    GMatchInfo *info  = NULL;
+    int        offset = 0;
+    g_regex_match ( regex, str, 0, &info );
+    while ( g_match_info_matches ( info ) ) {
+        int start, end;
+        g_match_info_fetch_pos ( info, 0, &start, &end );
+        if ( start > offset ) {
+            window_format_add_literal ( format, &str[offset], start - offset );
+        }
+        const char *match = &str[start];
+        int        l      = 0;
+        if ( match[2] == ':' ) {
+            l = (int) g_ascii_strtoll ( &match[3], NULL, 10 );
+            if ( l < 0 && config.menu_width < 0 ) {
+                l = -config.menu_width + l;
+            }
+            if ( l < 0 ) {
+                l = 0;
+            }
+        }
+        WinFormatSegment seg = { WIN_FORMAT_LITERAL, l, NULL };
+        switch ( match[1] )
+        {
+        case 'w':
+            seg.field = WIN_FORMAT_DESKTOP;
+            break;
+        case 'c':
+            seg.field = WIN_FORMAT_CLASS;
+            break;
+        case 't':
+            seg.field = WIN_FORMAT_TITLE;
+            break;
+        case 'n':
+            seg.field = WIN_FORMAT_NAME;
+            break;
+        case 'r':
+            seg.field = WIN_FORMAT_ROLE;
+            break;
+        default:
+            break;
+        }
+        if ( seg.field != WIN_FORMAT_LITERAL ) {
+            g_array_append_val ( format, seg );
         }
+        offset = end;
+        g_match_info_next ( info, NULL );
+    }
+    g_match_info_free ( info );
+    g_regex_unref ( regex );
+    if ( str[offset] != '\0' ) {
+        window_format_add_literal ( format, &str[offset], -1 );
+    }
+    return format;
+}
+
+static unsigned int window_format_field_width ( const ModeModePrivateData *pd, WinFormatField field )
+{
+    switch ( field )
+    {
+    case WIN_FORMAT_DESKTOP:
+        return pd->wmdn_len;
+    case WIN_FORMAT_CLASS:
+        return pd->clf_len;
+    case WIN_FORMAT_TITLE:
+        return pd->title_len;
+    case WIN_FORMAT_NAME:
+        return pd->name_len;
+    case WIN_FORMAT_ROLE:
+        return pd->role_len;
+    default:
+        return 0;
     }
-    xcb_ewmh_get_windows_reply_wipe ( &clients );
 }
+
+static const char * window_format_field_value ( const client *c, WinFormatField field )
+{
+    switch ( field )
+    {
+    case WIN_FORMAT_DESKTOP:
+        return c->wmdesktopstr;
+    case WIN_FORMAT_CLASS:
+        return c->class;
+    case WIN_FORMAT_TITLE:
+        return c->title;
+    case WIN_FORMAT_NAME:
+        return c->name;
+    case WIN_FORMAT_ROLE:
+        return c->role;
+    default:
+        return NULL;
+    }
+}
+
+static char * _generate_display_string ( const ModeModePrivateData *pd, client *c )
+{
+    GString *str = g_string_new ( NULL );
+    for ( guint i = 0; i < pd->format->len; i++ ) {
+        const WinFormatSegment *seg = &g_array_index ( pd->format, WinFormatSegment, i );
+        if ( seg->field == WIN_FORMAT_LITERAL ) {
+            g_string_append ( str, seg->text );
+        }
+        else {
+            helper_eval_add_str ( str, window_format_field_value ( c, seg->field ), seg->width,
+                                  window_format_field_width ( pd, seg->field ) );
+        }
+    }
+    return g_strchomp ( g_string_free ( str, FALSE ) );
+}
+
+/**
+ * @param pd The mode private data.
+ *
+ * Padding follows the widest value of a field, when one of those widths grew every cached row is stale.
+ */
+static void window_format_check_widths ( ModeModePrivateData *pd )
+{
+    for ( WinFormatField field = WIN_FORMAT_DESKTOP; field < WIN_FORMAT_NUM_FIELDS; field++ ) {
+        unsigned int width = window_format_field_width ( pd, field );
+        if ( pd->display_widths[field] != width ) {
+            pd->display_widths[field] = width;
+            pd->display_serial        = ++window_format_serial;
+        }
+    }
+}
+
+/**
+ * Rebuild the rows of the loaded window modes from the client cache.
+ * Only windows that are new to the cache are queried in full.
+ */
+static void window_mode_reload ( void )
+{
+    Mode *modes[] = { &window_mode, &window_mode_cd };
+    for ( unsigned int m = 0; m < G_N_ELEMENTS ( modes ); m++ ) {
+        ModeModePrivateData *pd = (ModeModePrivateData *) mode_get_private_data ( modes[m] );
+        if ( pd == NULL ) {
+            continue;
+        }
+        winlist_free ( pd->ids );
+        pd->ids = NULL;
+        _window_mode_load_data ( modes[m], modes[m] == &window_mode_cd );
+    }
+}
+
+/**
+ * @param c The client that changed.
+ *
+ * Grow the field widths of the loaded window modes to fit the client.
+ */
+static void window_mode_update_widths ( const client *c )
+{
+    const Mode *modes[] = { &window_mode, &window_mode_cd };
+    for ( unsigned int m = 0; m < G_N_ELEMENTS ( modes ); m++ ) {
+        ModeModePrivateData *pd = (ModeModePrivateData *) mode_get_private_data ( modes[m] );
+        if ( pd == NULL ) {
+            continue;
+        }
+        pd->title_len = MAX ( c->title ? g_utf8_strlen ( c->title, -1 ) : 0, pd->title_len );
+        pd->role_len  = MAX ( c->role ? g_utf8_strlen ( c->role, -1 ) : 0, pd->role_len );
+        pd->name_len  = MAX ( c->name ? g_utf8_strlen ( c->name, -1 ) : 0, pd->name_len );
+        pd->clf_len   = MAX ( c->class ? g_utf8_strlen ( c->class, -1 ) : 0, pd->clf_len );
+    }
+}
+
+/**
+ * @returns TRUE when the active view shows a window mode, directly or through combi.
+ */
+static gboolean window_mode_is_shown ( void )
+{
+    RofiViewState *state = rofi_view_get_active ();
+    if ( state == NULL ) {
+        return FALSE;
+    }
+    const Mode *mode = rofi_view_get_mode ( state );
+    if ( mode == &window_mode || mode == &window_mode_cd ) {
+        return TRUE;
+    }
+    return mode == &combi_mode && ( combi_mode_has_mode ( &window_mode ) || combi_mode_has_mode ( &window_mode_cd ) );
+}
+
+void window_mode_property_notify ( const xcb_property_notify_event_t *ev )
+{
+    if ( cache_client == NULL || window_cache_stale ) {
+        return;
+    }
+    if ( !window_mode_is_shown () ) {
+        // Do not refilter or query for another mode, reload everything once a window mode is shown again.
+        window_cache_stale = TRUE;
+        return;
+    }
+    // Changes that can add, remove or hide rows rebuild the row lists, others only
+    // update the cached client in place.
+    gboolean reload = FALSE;
+    if ( ev->window == xcb_stuff_get_root_window () ) {
+        if ( ev->atom != xcb->ewmh._NET_CLIENT_LIST && ev->atom != xcb->ewmh._NET_CLIENT_LIST_STACKING
+             && ev->atom != xcb->ewmh._NET_ACTIVE_WINDOW && ev->atom != xcb->ewmh._NET_CURRENT_DESKTOP
+             && ev->atom != xcb->ewmh._NET_DESKTOP_NAMES ) {
+            return;
+        }
+        reload = TRUE;
+    }
+    else {
+        int idx = winlist_find ( cache_client, ev->window );
+        if ( idx < 0 ) {
+            return;
+        }
+        client *c = cache_client->data[idx];
+        if ( ev->atom == xcb->ewmh._NET_WM_NAME || ev->atom == XCB_ATOM_WM_NAME ) {
+            xcb_get_property_cookie_t net_wm_name = window_get_text_prop_cookie ( c->window, xcb->ewmh._NET_WM_NAME );
+            xcb_get_property_cookie_t wm_name     = window_get_text_prop_cookie ( c->window, XCB_ATOM_WM_NAME );
+            window_client_read_title ( c, net_wm_name, wm_name );
+        }
+        else if ( ev->atom == netatoms[WM_WINDOW_ROLE] ) {
+            g_free ( c->role );
+            c->role = window_get_text_prop ( c->window, netatoms[WM_WINDOW_ROLE] );
+            client_clear_display ( c );
+        }
+        else if ( ev->atom == XCB_ATOM_WM_CLASS ) {
+            window_client_read_class ( c, xcb_icccm_get_wm_class ( xcb->connection, c->window ) );
+        }
+        else if ( ev->atom == xcb->ewmh._NET_WM_STATE ) {
+            window_client_read_state ( c, xcb_ewmh_get_wm_state ( &xcb->ewmh, c->window ) );
+            reload = TRUE;
+        }
+        else if ( ev->atom == XCB_ATOM_WM_HINTS ) {
+            window_client_read_hints ( c, xcb_icccm_get_wm_hints ( xcb->connection, c->window ) );
+            reload = TRUE;
+        }
+        else if ( ev->atom == xcb->ewmh._NET_WM_DESKTOP ) {
+            reload = TRUE;
+        }
+        else if ( ev->atom == xcb->ewmh._NET_WM_ICON ) {
+            // Only drop what came from the property, a thumbnail stays.
+            if ( c->icon_checked || c->icon_pending ) {
+                if ( c->icon ) {
+                    cairo_surface_destroy ( c->icon );
+                    c->icon = NULL;
+                }
+                c->icon_checked = FALSE;
+                c->icon_pending = FALSE;
+                c->icon_serial++;
+                rofi_view_icons_ready ();
+            }
+            return;
+        }
+        else {
+            return;
+        }
+        window_mode_update_widths ( c );
+    }
+    if ( reload ) {
+        window_mode_reload ();
+    }
+    // Also when window mode is shown through combi, which caches the row offsets of its modes
+    // until the view reloads.
+    rofi_view_rows_changed ( reload );
+}
+
 static int window_mode_init ( Mode *sw )
 {
     if ( mode_get_private_data ( sw ) == NULL ) {
         ModeModePrivateData *pd = g_malloc0 ( sizeof ( *pd ) );
-        pd->window_regex = g_regex_new ( "{[-\\w]+(:-?[0-9]+)?}", 0, 0, NULL );
+        pd->format         = window_format_compile ( config.window_format );
+        pd->display_serial = ++window_format_serial;
         mode_set_private_data ( sw, (void *) pd );
         _window_mode_load_data ( sw, FALSE );
         if ( !window_matching_fields_parsed ) {
@@ -604,7 +1181,8 @@ static int window_mode_init_cd ( Mode *sw )
 {
     if ( mode_get_private_data ( sw ) == NULL ) {
         ModeModePrivateData *pd = g_malloc0 ( sizeof ( *pd ) );
-        pd->window_regex = g_regex_new ( "{[-\\w]+(:-?[0-9]+)?}", 0, 0, NULL );
+        pd->format         = window_format_compile ( config.window_format );
+        pd->display_serial = ++window_format_serial;
         mode_set_private_data ( sw, (void *) pd );
         _window_mode_load_data ( sw, TRUE );
         if ( !window_matching_fields_parsed ) {
@@ -666,15 +1244,16 @@ static ModeMode window_mode_result ( Mode *sw, int mretv, G_GNUC_UNUSED char **i
                 uint32_t                  wmdesktop = 0;
                 xcb_get_property_cookie_t cookie;
                 xcb_get_property_reply_t  *r;
-                // Get the current desktop.
+                // Request both desktops before waiting for either reply.
                 unsigned int              current_desktop = 0;
                 xcb_get_property_cookie_t c               = xcb_ewmh_get_current_desktop ( &xcb->ewmh, xcb->screen_nbr );
+                cookie = xcb_get_property ( xcb->connection, 0, rmpd->ids->array[selected_line],
+                                            xcb->ewmh._NET_WM_DESKTOP, XCB_ATOM_CARDINAL, 0, 1 );
+                // Get the current desktop.
                 if ( !xcb_ewmh_get_current_desktop_reply ( &xcb->ewmh, c, &current_desktop, NULL ) ) {
                     current_desktop = 0;
                 }
 
-                cookie = xcb_get_property ( xcb->connection, 0, rmpd->ids->array[selected_line],
-                                            xcb->ewmh._NET_WM_DESKTOP, XCB_ATOM_CARDINAL, 0, 1 );
                 r = xcb_get_property_reply ( xcb->connection, cookie, NULL );
                 if ( r && r->type == XCB_ATOM_CARDINAL ) {
                     wmdesktop = *( (uint32_t *) xcb_get_property_value ( r ) );
@@ -712,86 +1291,11 @@ static void window_mode_destroy ( Mode *sw )
         winlist_free ( rmpd->ids );
         x11_cache_free ();
         g_free ( rmpd->cache );
-        g_regex_unref ( rmpd->window_regex );
+        g_array_free ( rmpd->format, TRUE );
         g_free ( rmpd );
         mode_set_private_data ( sw, NULL );
     }
 }
-struct arg
-{
-    const ModeModePrivateData *pd;
-    client                    *c;
-};
-
-static void helper_eval_add_str ( GString *str, const char *input, int l, int max_len )
-{
-    // g_utf8 does not work with NULL string.
-    const char *input_nn = input ? input : "";
-    // Both l and max_len are in characters, not bytes.
-    int        nc     = g_utf8_strlen ( input_nn, -1 );
-    int        spaces = 0;
-    if ( l == 0 ) {
-        spaces = MAX ( 0, max_len - nc );
-        g_string_append ( str, input_nn );
-    }
-    else {
-        if ( nc > l ) {
-            int bl = g_utf8_offset_to_pointer ( input_nn, l ) - input_nn;
-            g_string_append_len ( str, input_nn, bl );
-        }
-        else {
-            spaces = l - nc;
-            g_string_append ( str, input_nn );
-        }
-    }
-    while ( spaces-- ) {
-        g_string_append_c ( str, ' ' );
-    }
-}
-static gboolean helper_eval_cb ( const GMatchInfo *info, GString *str, gpointer data )
-{
-    struct arg *d = (struct arg *) data;
-    gchar      *match;
-    // Get the match
-    match = g_match_info_fetch ( info, 0 );
-    if ( match != NULL ) {
-        int l = 0;
-        if ( match[2] == ':' ) {
-            l = (int) g_ascii_strtoll ( &match[3], NULL, 10 );
-            if ( l < 0 && config.menu_width < 0 ) {
-                l = -config.menu_width + l;
-            }
-            if ( l < 0 ) {
-                l = 0;
-            }
-        }
-        if ( match[1] == 'w' ) {
-            helper_eval_add_str ( str, d->c->wmdesktopstr, l, d->pd->wmdn_len );
-        }
-        else if ( match[1] == 'c' ) {
-            helper_eval_add_str ( str, d->c->class, l, d->pd->clf_len );
-        }
-        else if ( match[1] == 't' ) {
-            helper_eval_add_str ( str, d->c->title, l, d->pd->title_len );
-        }
-        else if ( match[1] == 'n' ) {
-            helper_eval_add_str ( str, d->c->name, l, d->pd->name_len );
-        }
-        else if ( match[1] == 'r' ) {
-            helper_eval_add_str ( str, d->c->role, l, d->pd->role_len );
-        }
-        g_free ( match );
-    }
-    return FALSE;
-}
-static char * _generate_display_string ( const ModeModePrivateData *pd, client *c )
-{
-    struct arg d    = { pd, c };
-    char       *res = g_regex_replace_eval ( pd->window_regex, config.window_format, -1, 0, 0,
-                                             helper_eval_cb, &d, NULL );
-    return g_strchomp ( res );
-}
-
 static char *_get_display_value ( const Mode *sw, unsigned int selected_line, int *state, G_GNUC_UNUSED GList **list, int get_entry )
 {
     ModeModePrivateData *rmpd = mode_get_private_data ( sw );
@@ -805,7 +1309,17 @@ static char *_get_display_value ( const Mode *sw, unsigned int selected_line, in
     if ( c->active ) {
         *state |= ACTIVE;
     }
-    return get_entry ? _generate_display_string ( rmpd, c ) : NULL;
+    if ( !get_entry ) {
+        return NULL;
+    }
+    window_format_check_widths ( rmpd );
+    if ( c->display == NULL || c->display_pd != rmpd || c->display_serial != rmpd->display_serial ) {
+        g_free ( c->display );
+        c->display        = _generate_display_string ( rmpd, c );
+        c->display_pd     = rmpd;
+        c->display_serial = rmpd->display_serial;
+    }
+    return g_strdup ( c->display );
 }
 
 /**
@@ -821,19 +1335,11 @@ static cairo_user_data_key_t data_key;
 static cairo_surface_t * draw_surface_from_data ( int width, int height, uint32_t *data )
 {
     unsigned long int len = width * height;
-    unsigned long int i;
-    uint32_t          *buffer = g_new0 ( uint32_t, len );
+    uint32_t          *buffer = g_new ( uint32_t, len );
     cairo_surface_t   *surface;
 
     /* Cairo wants premultiplied alpha, meh :( */
-    for ( i = 0; i < len; i++ ) {
-        uint8_t a     = ( data[i] >> 24 ) & 0xff;
-        double  alpha = a / 255.0;
-        uint8_t r     = ( ( data[i] >> 16 ) & 0xff ) * alpha;
-        uint8_t g     = ( ( data[i] >> 8 ) & 0xff ) * alpha;
-        uint8_t b     = ( ( data[i] >> 0 ) & 0xff ) * alpha;
-        buffer[i] = ( a << 24 ) | ( r << 16 ) | ( g << 8 ) | b;
-    }
+    rofi_premultiply_argb ( buffer, data, len );
 
     surface = cairo_image_surface_create_for_data ( (unsigned char *) buffer,
                                                     CAIRO_FORMAT_ARGB32,
@@ -896,16 +1402,67 @@ static cairo_surface_t * ewmh_window_icon_from_reply ( xcb_get_property_reply_t
 
     return draw_surface_from_data ( found_data[0], found_data[1], found_data + 2 );
 }
-/** Get NET_WM_ICON. */
-static cairo_surface_t * get_net_wm_icon ( xcb_window_t xid, uint32_t preferred_size )
+/**
+ * @param data Unused.
+ *
+ * Collect the replies of the icon requests sent while drawing, after the frame is shown.
+ * The replies arrived in the meantime, so this costs at most one round trip for all rows.
+ *
+ * @returns G_SOURCE_REMOVE
+ */
+static gboolean icon_requests_collect ( G_GNUC_UNUSED gpointer data )
 {
-    xcb_get_property_cookie_t cookie = xcb_get_property_unchecked (
-        xcb->connection, FALSE, xid,
-        xcb->ewmh._NET_WM_ICON, XCB_ATOM_CARDINAL, 0, UINT32_MAX );
-    xcb_get_property_reply_t *r       = xcb_get_property_reply ( xcb->connection, cookie, NULL );
-    cairo_surface_t          *surface = ewmh_window_icon_from_reply ( r, preferred_size );
-    free ( r );
-    return surface;
+    GArray *requests = icon_requests;
+    icon_requests      = NULL;
+    icon_requests_idle = 0;
+    TICK_N ( "Window icons collect start" );
+    for ( guint i = 0; i < requests->len; i++ ) {
+        icon_request             *req = &g_array_index ( requests, icon_request, i );
+        xcb_get_property_reply_t *r   = xcb_get_property_reply ( xcb->connection, req->cookie, NULL );
+        int                      idx  = winlist_find ( cache_client, req->window );
+        if ( idx >= 0 ) {
+            client *c = cache_client->data[idx];
+            // A newer request replaces this one when the icon changed meanwhile.
+            if ( c->icon_pending && c->icon_serial == req->serial ) {
+                c->icon         = ewmh_window_icon_from_reply ( r, req->size );
+                c->icon_pending = FALSE;
+                c->icon_checked = TRUE;
+            }
+        }
+        free ( r );
+    }
+    TICK_N ( "Window icons collect done" );
+    g_debug ( "Window mode: collected %u icons.", requests->len );
+    g_array_free ( requests, TRUE );
+    rofi_view_icons_ready ();
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * @param c The client.
+ * @param size The preferred icon size.
+ *
+ * Request the client's NET_WM_ICON without waiting for it.
+ * The reply is picked up by icon_requests_collect().
+ */
+static void get_net_wm_icon_async ( client *c, uint32_t size )
+{
+    icon_request req = {
+        .window = c->window,
+        .cookie = xcb_get_property_unchecked ( xcb->connection, FALSE, c->window,
+                                               xcb->ewmh._NET_WM_ICON, XCB_ATOM_CARDINAL, 0, UINT32_MAX ),
+        .size   = size,
+        .serial = c->icon_serial,
+    };
+    if ( icon_requests == NULL ) {
+        icon_requests = g_array_new ( FALSE, FALSE, sizeof ( icon_request ) );
+    }
+    g_array_append_val ( icon_requests, req );
+    c->icon_pending = TRUE;
+    if ( icon_requests_idle == 0 ) {
+        // Lower priority than the redraw, so the rows are drawn before the replies are awaited.
+        icon_requests_idle = g_idle_add ( icon_requests_collect, NULL );
+    }
 }
 static cairo_surface_t *_get_icon ( const Mode *sw, unsigned int selected_line, int size )
 {
@@ -916,8 +1473,10 @@ static cairo_surface_t *_get_icon ( const Mode *sw, unsigned int selected_line,
         c->thumbnail_checked = TRUE;
     }
     if ( c->icon == NULL && c->icon_checked == FALSE ) {
-        c->icon         = get_net_wm_icon ( rmpd->ids->array[selected_line], size );
-        c->icon_checked = TRUE;
+        if ( c->icon_pending == FALSE ) {
+            get_net_wm_icon_async ( c, size );
+        }
+        return NULL;
     }
     if ( c->icon == NULL && c->class ) {
         if ( c->icon_fetch_uid > 0 ) {
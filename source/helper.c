@@ -44,6 +44,10 @@
 #include <sys/stat.h>
 #include <pwd.h>
 #include <ctype.h>
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include <pango/pango.h>
 #include <pango/pango-fontmap.h>
 #include <pango/pangocairo.h>
@@ -128,6 +132,9 @@ void helper_tokenize_free ( rofi_int_matcher ** tokens )
 {
     for ( size_t i = 0; tokens && tokens[i]; i++ ) {
         g_regex_unref ( (GRegex *) tokens[i]->regex );
+        if ( tokens[i]->folded != NULL ) {
+            g_regex_unref ( tokens[i]->folded );
+        }
         g_free ( tokens[i] );
     }
     g_free ( tokens );
@@ -187,6 +194,24 @@ static inline GRegex * R ( const char *s, int case_sensitive  )
     return g_regex_new ( s, G_REGEX_OPTIMIZE | ( ( case_sensitive ) ? 0 : G_REGEX_CASELESS ), 0, NULL );
 }
 
+/**
+ * @param input The token.
+ *
+ * @returns the regex for input under the (non-regex) matching method.
+ */
+static gchar *token_to_regex ( const char *input )
+{
+    switch ( config.matching_method )
+    {
+    case MM_GLOB:
+        return glob_to_regex ( input );
+    case MM_FUZZY:
+        return fuzzy_to_regex ( input );
+    default:
+        return g_regex_escape_string ( input, -1 );
+    }
+}
+
 static rofi_int_matcher * create_regex ( const char *input, int case_sensitive )
 {
     GRegex           * retv = NULL;
@@ -196,31 +221,26 @@ static rofi_int_matcher * create_regex ( const char *input, int case_sensitive )
         rv->invert = 1;
         input++;
     }
-    switch ( config.matching_method )
-    {
-    case MM_GLOB:
-        r    = glob_to_regex ( input );
-        retv = R ( r, case_sensitive );
-        g_free ( r );
-        break;
-    case MM_REGEX:
+    if ( config.matching_method == MM_REGEX ) {
         retv = R ( input, case_sensitive );
         if ( retv == NULL ) {
             r    = g_regex_escape_string ( input, -1 );
             retv = R ( r, case_sensitive );
             g_free ( r );
         }
-        break;
-    case MM_FUZZY:
-        r    = fuzzy_to_regex ( input );
-        retv = R ( r, case_sensitive );
-        g_free ( r );
-        break;
-    default:
-        r    = g_regex_escape_string ( input, -1 );
+    }
+    else {
+        r    = token_to_regex ( input );
         retv = R ( r, case_sensitive );
         g_free ( r );
-        break;
+        // Folding a user regex could change its meaning (e.g. \W), so only plain tokens get one.
+        if ( !case_sensitive ) {
+            gchar *folded = g_utf8_casefold ( input, -1 );
+            r          = token_to_regex ( folded );
+            rv->folded = R ( r, TRUE );
+            g_free ( r );
+            g_free ( folded );
+        }
     }
     rv->regex = retv;
     return rv;
@@ -462,6 +482,23 @@ int helper_token_match ( rofi_int_matcher* const *tokens, const char *input )
     return match;
 }
 
+int helper_token_match_folded ( rofi_int_matcher* const *tokens, const char *input, const char *folded )
+{
+    int match = TRUE;
+    if ( tokens ) {
+        for ( int j = 0; match && tokens[j]; j++ ) {
+            if ( folded != NULL && tokens[j]->folded != NULL ) {
+                match = g_regex_match ( tokens[j]->folded, folded, 0, NULL );
+            }
+            else {
+                match = g_regex_match ( tokens[j]->regex, input, 0, NULL );
+            }
+            match ^= tokens[j]->invert;
+        }
+    }
+    return match;
+}
+
 int execute_generator ( const char * cmd )
 {
     char **args = NULL;
@@ -545,17 +582,15 @@ gboolean helper_validate_font ( PangoFontDescription *pfd, const char *font )
 }
 
 /**
- * Do some input validation, especially the first few could break things.
- * It is good to catch them beforehand.
+ * @param msg The string to append the errors to.
  *
- * This functions exits the program with 1 when it finds an invalid configuration.
+ * Check and parse the matching and sorting options.
+ *
+ * @returns TRUE when an invalid option was found.
  */
-int config_sanity_check ( void )
+static int config_sanity_check_filter_options ( GString *msg )
 {
-    int     found_error = FALSE;
-    GString *msg        = g_string_new (
-        "<big><b>The configuration failed to validate:</b></big>\n" );
-
+    int found_error = FALSE;
     if ( config.sorting_method ) {
         if ( g_strcmp0 ( config.sorting_method, "normal" ) == 0 ) {
             config.sorting_method_enum = SORT_NORMAL;
@@ -592,6 +627,35 @@ int config_sanity_check ( void )
             found_error = 1;
         }
     }
+    return found_error;
+}
+
+int config_sanity_check_filter ( void )
+{
+    GString *msg = g_string_new (
+        "<big><b>The configuration failed to validate:</b></big>\n" );
+    if ( config_sanity_check_filter_options ( msg ) ) {
+        g_string_append ( msg, "Please update your configuration." );
+        rofi_add_error_message ( msg );
+        return TRUE;
+    }
+    g_string_free ( msg, TRUE );
+    return FALSE;
+}
+
+/**
+ * Do some input validation, especially the first few could break things.
+ * It is good to catch them beforehand.
+ *
+ * This functions exits the program with 1 when it finds an invalid configuration.
+ */
+int config_sanity_check ( void )
+{
+    int     found_error = FALSE;
+    GString *msg        = g_string_new (
+        "<big><b>The configuration failed to validate:</b></big>\n" );
+
+    found_error = config_sanity_check_filter_options ( msg );
 
     if ( config.element_height < 1 ) {
         g_string_append_printf ( msg, "\t<b>config.element_height</b>=%d is invalid. An element needs to be atleast 1 line high.\n",
@@ -746,18 +810,111 @@ gchar *rofi_escape_markup ( gchar *text )
     return ret;
 }
 
-char * rofi_force_utf8 ( const gchar *data, ssize_t length )
+/**
+ * @param s      The data to scan.
+ * @param length The length of s.
+ *
+ * Find the first byte that is not plain (non-nul) ASCII.
+ * This checks 16 bytes at a time with SSE2, or a word at a time otherwise.
+ *
+ * @returns the offset of the first non ASCII or nul byte, or length.
+ */
+static inline gsize rofi_utf8_ascii_prefix ( const unsigned char *s, gsize length )
 {
-    if ( data == NULL ) {
-        return NULL;
+    gsize i = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128 ();
+    for (; ( i + 16 ) <= length; i += 16 ) {
+        __m128i v = _mm_loadu_si128 ( (const __m128i *) ( s + i ) );
+        // Top bit set (non ASCII) or nul byte.
+        int     mask = _mm_movemask_epi8 ( _mm_or_si128 ( v, _mm_cmpeq_epi8 ( v, zero ) ) );
+        if ( mask != 0 ) {
+            return i + g_bit_nth_lsf ( (gulong) mask, -1 );
+        }
     }
-    const char *end;
-    GString    *string;
+#endif
+    for (; ( i + 8 ) <= length; i += 8 ) {
+        uint64_t w;
+        memcpy ( &w, s + i, 8 );
+        // Top bit set or (classic has-zero-byte trick) nul byte.
+        if ( ( ( w | ( ( w - 0x0101010101010101ULL ) & ~w ) ) & 0x8080808080808080ULL ) != 0 ) {
+            break;
+        }
+    }
+    while ( i < length && s[i] != 0 && s[i] < 0x80 ) {
+        i++;
+    }
+    return i;
+}
 
-    if ( g_utf8_validate ( data, length, &end ) ) {
-        return g_memdup ( data, length + 1 );
+gboolean rofi_utf8_validate ( const char *data, ssize_t length, const char **end )
+{
+    const unsigned char *s = (const unsigned char *) data;
+    gsize               len = ( length < 0 ) ? strlen ( data ) : (gsize) length;
+    gsize               i   = 0;
+
+    while ( TRUE ) {
+        i += rofi_utf8_ascii_prefix ( s + i, len - i );
+        if ( i >= len ) {
+            break;
+        }
+        // Multi-byte sequence, see table 3-7 of the unicode standard.
+        unsigned char c = s[i];
+        unsigned char lo = 0x80, hi = 0xBF;
+        gsize         n  = 0;
+        if ( c >= 0xC2 && c <= 0xDF ) {
+            n = 1;
+        }
+        else if ( c >= 0xE0 && c <= 0xEF ) {
+            n = 2;
+            if ( c == 0xE0 ) {
+                lo = 0xA0;
+            }
+            else if ( c == 0xED ) {
+                // No surrogates.
+                hi = 0x9F;
+            }
+        }
+        else if ( c >= 0xF0 && c <= 0xF4 ) {
+            n = 3;
+            if ( c == 0xF0 ) {
+                lo = 0x90;
+            }
+            else if ( c == 0xF4 ) {
+                hi = 0x8F;
+            }
+        }
+        // nul byte, stray continuation byte, invalid lead byte or truncated sequence.
+        if ( n == 0 || ( len - i ) <= n || s[i + 1] < lo || s[i + 1] > hi ) {
+            break;
+        }
+        gsize k = 2;
+        for (; k <= n && ( s[i + k] & 0xC0 ) == 0x80; k++ ) {
+            ;
+        }
+        if ( k <= n ) {
+            break;
+        }
+        i += n + 1;
+    }
+    if ( end != NULL ) {
+        *end = data + i;
     }
-    string = g_string_sized_new ( length + 16 );
+    return i == len;
+}
+
+/**
+ * @param data   The (partially) invalid data.
+ * @param length The length of data.
+ * @param end    The first invalid byte in data.
+ *
+ * Copy data, replacing the invalid parts with the replacement character.
+ *
+ * @returns the repaired UTF-8 string.
+ */
+static char * rofi_utf8_repair ( const gchar *data, ssize_t length, const char *end )
+{
+    GString *string = g_string_sized_new ( length + 16 );
 
     do {
         /* Valid part of the string */
@@ -766,7 +923,7 @@ char * rofi_force_utf8 ( const gchar *data, ssize_t length )
         g_string_append ( string, "\uFFFD" );
         length -= ( end - data ) + 1;
         data    = end + 1;
-    } while ( !g_utf8_validate ( data, length, &end ) );
+    } while ( !rofi_utf8_validate ( data, length, &end ) );
 
     if ( length ) {
         g_string_append_len ( string, data, length );
@@ -775,6 +932,19 @@ char * rofi_force_utf8 ( const gchar *data, ssize_t length )
     return g_string_free ( string, FALSE );
 }
 
+char * rofi_force_utf8 ( const gchar *data, ssize_t length )
+{
+    if ( data == NULL ) {
+        return NULL;
+    }
+    const char *end;
+
+    if ( rofi_utf8_validate ( data, length, &end ) ) {
+        return g_memdup ( data, length + 1 );
+    }
+    return rofi_utf8_repair ( data, length, end );
+}
+
 /****
  * FZF like scorer
  */
@@ -1132,6 +1302,49 @@ cairo_surface_t* cairo_image_surface_create_from_svg ( const gchar* file, int he
     return surface;
 }
 
+/** Four ARGB pixels, the kernel below works on them at once. */
+typedef uint32_t argb_vec __attribute__( ( vector_size ( 16 ) ) );
+/** Number of pixels in #argb_vec. */
+#define ARGB_VEC_LEN    ( sizeof ( argb_vec ) / sizeof ( uint32_t ) )
+
+/**
+ * @param p The ARGB pixel.
+ *
+ * Premultiply one pixel with its alpha, rounding c * a / 255 to the nearest integer.
+ * Red and blue share one multiply, they are 16 bits apart and can not overflow into each other.
+ *
+ * @returns the premultiplied pixel.
+ */
+static inline uint32_t premultiply_pixel ( uint32_t p )
+{
+    uint32_t a  = p >> 24;
+    uint32_t rb = ( p & 0x00ff00ffu ) * a + 0x00800080u;
+    uint32_t g  = ( p & 0x0000ff00u ) * a + 0x00008000u;
+    rb = ( ( rb + ( ( rb >> 8 ) & 0x00ff00ffu ) ) >> 8 ) & 0x00ff00ffu;
+    g  = ( ( g + ( ( g >> 8 ) & 0x0000ff00u ) ) >> 8 ) & 0x0000ff00u;
+    return ( p & 0xff000000u ) | rb | g;
+}
+
+void rofi_premultiply_argb ( uint32_t *dst, const uint32_t *src, size_t len )
+{
+    size_t i = 0;
+    for (; i + ARGB_VEC_LEN <= len; i += ARGB_VEC_LEN ) {
+        argb_vec p;
+        // The input (e.g. X property data) has no alignment guarantee.
+        memcpy ( &p, src + i, sizeof ( p ) );
+        argb_vec a  = p >> 24;
+        argb_vec rb = ( p & 0x00ff00ffu ) * a + 0x00800080u;
+        argb_vec g  = ( p & 0x0000ff00u ) * a + 0x00008000u;
+        rb = ( ( rb + ( ( rb >> 8 ) & 0x00ff00ffu ) ) >> 8 ) & 0x00ff00ffu;
+        g  = ( ( g + ( ( g >> 8 ) & 0x0000ff00u ) ) >> 8 ) & 0x0000ff00u;
+        p  = ( p & 0xff000000u ) | rb | g;
+        memcpy ( dst + i, &p, sizeof ( p ) );
+    }
+    for (; i < len; i++ ) {
+        dst[i] = premultiply_pixel ( src[i] );
+    }
+}
+
 static void parse_pair ( char  *input, rofi_range_pair  *item )
 {
     // Skip leading blanks.
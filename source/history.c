@@ -30,7 +30,11 @@
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/mman.h>
 #include <errno.h>
 #include <glib.h>
 #include <glib/gstdio.h>
@@ -38,6 +42,28 @@
 #include "history.h"
 #include "settings.h"
 
+/**
+ * The history file starts with the list as it was last compacted, one
+ * "<index> <entry>" line per entry. Changes after that are appended as
+ * "+ <entry>" and "- <entry>" lines, and replayed when the file is read.
+ */
+
+/** Record appended when an entry is used. */
+#define HISTORY_RECORD_INCREMENT    '+'
+/** Record appended when an entry is removed. */
+#define HISTORY_RECORD_REMOVE       '-'
+/** The file is compacted when the log grows beyond this size. */
+#define HISTORY_COMPACT_SIZE        ( 64 * 1024 )
+
+/** Appended to the history filename for the index. */
+#define HISTORY_INDEX_SUFFIX        ".idx"
+/** Magic at the start of the index file. */
+#define HISTORY_INDEX_MAGIC         "rofihidx"
+/** Version of the index format. */
+#define HISTORY_INDEX_VERSION       1
+/** Marks an empty bucket in the index hash table. */
+#define HISTORY_INDEX_EMPTY         UINT32_MAX
+
 /**
  * History element
  */
@@ -47,8 +73,34 @@ typedef struct __element
     long int index;
     /** Entry */
     char     *name;
+    /** Number of the record that last used it, 0 if not since the list was compacted. */
+    long int last;
 }_element;
 
+/**
+ * The history replayed from the file.
+ */
+typedef struct
+{
+    /** The elements in the order they were first seen. */
+    GPtrArray  *list;
+    /** Entry to element. */
+    GHashTable *lookup;
+    /** The lowest index, if min_valid is set. */
+    long int   min_index;
+    /** min_index is up to date. */
+    gboolean   min_valid;
+    /** Number of records replayed. */
+    long int   records;
+} _history;
+
+static void __element_free ( gpointer data )
+{
+    _element *el = (_element *) data;
+    g_free ( el->name );
+    g_free ( el );
+}
+
 static int __element_sort_func ( const void *ea, const void *eb, void *data __attribute__( ( unused ) ) )
 {
     _element *a = *(_element * *) ea;
@@ -76,103 +128,218 @@ static void __history_write_element_list ( FILE *fd, _element **list, unsigned i
     }
 }
 
-static char ** __history_get_element_list_fields ( FILE *fd, unsigned int *length )
+static void __history_increment ( _history *h, const char *name )
 {
-    unsigned int real_length = 0;
-    char         **retv      = NULL;;
-    if  ( length == NULL ) {
-        return NULL;
-    }
-    *length = 0;
-
-    if ( fd == NULL ) {
-        return NULL;
-    }
-    char    *buffer       = NULL;
-    size_t  buffer_length = 0;
-    ssize_t l             = 0;
-    while ( ( l = getline ( &buffer, &buffer_length, fd ) ) > 0 ) {
-        // Jump to the first space.
-        const char *start = strchr ( buffer, ' ' );
-        // not found, skip.
-        if ( start == NULL ) {
-            continue;
+    _element *el = g_hash_table_lookup ( h->lookup, name );
+    h->records++;
+    if ( el != NULL ) {
+        if ( h->min_valid && el->index == h->min_index ) {
+            h->min_valid = FALSE;
         }
-        start++;
-        // remove trailing \n
-        buffer[l - 1] = '\0';
-        if ( real_length < ( *length + 2 ) ) {
-            real_length += 15;
-            // Resize and check.
-            retv = g_realloc ( retv, ( real_length ) * sizeof ( char* ) );
+        el->index++;
+        el->last = h->records;
+        return;
+    }
+    // A new entry goes just above the least used one, like it did when the list was rewritten each time.
+    if ( !h->min_valid ) {
+        h->min_index = 0;
+        for ( guint iter = 0; iter < h->list->len; iter++ ) {
+            _element *e = g_ptr_array_index ( h->list, iter );
+            if ( iter == 0 || e->index < h->min_index ) {
+                h->min_index = e->index;
+            }
         }
-        // Parse the number of times.
-        retv[( *length )] = g_strndup ( start, l - 1 - ( start - buffer ) );
-        // Force trailing '\0'
-        retv[( *length ) + 1] = NULL;
-
-        ( *length )++;
+        h->min_valid = TRUE;
     }
-    if ( buffer_length > 0 ) {
-        g_free ( buffer );
+    el        = g_malloc ( sizeof ( _element ) );
+    el->name  = g_strdup ( name );
+    el->index = h->min_index + 1;
+    el->last  = h->records;
+    g_ptr_array_add ( h->list, el );
+    g_hash_table_insert ( h->lookup, el->name, el );
+    if ( h->list->len == 1 ) {
+        h->min_index = el->index;
     }
-    return retv;
 }
 
-static _element ** __history_get_element_list ( FILE *fd, unsigned int *length )
+static void __history_remove ( _history *h, const char *name )
 {
-    unsigned int real_length = 0;
-    _element     **retv      = NULL;
-
-    if  ( length == NULL ) {
-        return NULL;
+    _element *el = g_hash_table_lookup ( h->lookup, name );
+    if ( el != NULL ) {
+        g_hash_table_remove ( h->lookup, name );
+        g_ptr_array_remove ( h->list, el );
+        h->min_valid = FALSE;
     }
-    *length = 0;
+}
+
+static void __history_free ( _history *h )
+{
+    g_hash_table_destroy ( h->lookup );
+    g_ptr_array_free ( h->list, TRUE );
+    g_free ( h );
+}
+
+/**
+ * @param fd The history file.
+ *
+ * Read the list and replay the records appended to it.
+ *
+ * @returns the history, free with __history_free().
+ */
+static _history * __history_load ( FILE *fd )
+{
+    _history *h = g_malloc0 ( sizeof ( _history ) );
+    h->list   = g_ptr_array_new_with_free_func ( __element_free );
+    h->lookup = g_hash_table_new ( g_str_hash, g_str_equal );
 
-    if ( fd == NULL ) {
-        return NULL;
-    }
     char    *buffer       = NULL;
     size_t  buffer_length = 0;
     ssize_t l             = 0;
     while ( ( l = getline ( &buffer, &buffer_length, fd ) ) > 0 ) {
-        char * start = NULL;
-        // Skip empty lines.
-        if ( l <= 1 ) {
+        // Skip empty lines, and a record that is still being appended.
+        if ( l <= 1 || buffer[l - 1] != '\n' ) {
+            continue;
+        }
+        // remove trailing \n
+        buffer[l - 1] = '\0';
+        if ( ( buffer[0] == HISTORY_RECORD_INCREMENT || buffer[0] == HISTORY_RECORD_REMOVE ) && buffer[1] == ' ' ) {
+            if ( buffer[2] == '\0' ) {
+                continue;
+            }
+            if ( buffer[0] == HISTORY_RECORD_INCREMENT ) {
+                __history_increment ( h, &buffer[2] );
+            }
+            else {
+                __history_remove ( h, &buffer[2] );
+            }
             continue;
         }
 
-        long int index = strtol ( buffer, &start, 10 );
+        char     *start = NULL;
+        long int index  = strtol ( buffer, &start, 10 );
         if ( start == buffer || *start == '\0' ) {
             continue;
         }
         start++;
-        if ( ( l - ( start - buffer ) ) < 2 ) {
+        if ( *start == '\0' ) {
             continue;
         }
-        if ( real_length < ( *length + 2 ) ) {
-            real_length += 15;
-            // Resize and check.
-            retv = g_realloc ( retv, ( real_length ) * sizeof ( _element* ) );
+        _element *el = g_hash_table_lookup ( h->lookup, start );
+        if ( el == NULL ) {
+            el       = g_malloc ( sizeof ( _element ) );
+            el->name = g_strdup ( start );
+            el->last = 0;
+            g_ptr_array_add ( h->list, el );
+            g_hash_table_insert ( h->lookup, el->name, el );
         }
-
-        retv[( *length )] = g_malloc ( sizeof ( _element ) );
-
-        // remove trailing \n
-        buffer[l - 1] = '\0';
-        // Parse the number of times.
-        retv[( *length )]->index = index;
-        retv[( *length )]->name  = g_strndup ( start, l - 1 - ( start - buffer ) );
-        // Force trailing '\0'
-        retv[( *length ) + 1] = NULL;
-
-        ( *length )++;
+        el->index    = index;
+        h->min_valid = FALSE;
     }
     if ( buffer != NULL  ) {
         free ( buffer );
         buffer = NULL;
     }
-    return retv;
+    return h;
+}
+
+/**
+ * @param filename The filename of the history cache.
+ *
+ * Rewrite the history file with just the list, other instances can keep
+ * appending while this runs.
+ */
+static void __history_compact ( const char *filename )
+{
+    int fd = open ( filename, O_RDONLY );
+    if ( fd < 0 ) {
+        return;
+    }
+    struct stat st_fd, st_path;
+    // Appending takes a shared lock.
+    if ( flock ( fd, LOCK_EX ) != 0 || fstat ( fd, &st_fd ) != 0 || stat ( filename, &st_path ) != 0
+         || st_fd.st_ino != st_path.st_ino || st_fd.st_dev != st_path.st_dev || st_fd.st_size <= HISTORY_COMPACT_SIZE ) {
+        // Failed, or another instance compacted it already.
+        close ( fd );
+        return;
+    }
+    FILE *in = fdopen ( dup ( fd ), "r" );
+    if ( in == NULL ) {
+        close ( fd );
+        return;
+    }
+    _history *h = __history_load ( in );
+    fclose ( in );
+
+    // Write to a new file and move it in place, readers see the old or the new file.
+    char *tmp_file = g_strconcat ( filename, ".XXXXXX", NULL );
+    int  tmp_fd    = g_mkstemp ( tmp_file );
+    FILE *out      = ( tmp_fd >= 0 ) ? fdopen ( tmp_fd, "w" ) : NULL;
+    if ( out == NULL ) {
+        g_warning ( "Failed to open file: %s", g_strerror ( errno ) );
+        if ( tmp_fd >= 0 ) {
+            close ( tmp_fd );
+            unlink ( tmp_file );
+        }
+    }
+    else {
+        fchmod ( tmp_fd, st_fd.st_mode & 0777 );
+        __history_write_element_list ( out, (_element * *) h->list->pdata, h->list->len );
+        if ( fclose ( out ) != 0 || rename ( tmp_file, filename ) != 0 ) {
+            g_warning ( "Failed to write history file: %s", g_strerror ( errno ) );
+            unlink ( tmp_file );
+        }
+    }
+    g_free ( tmp_file );
+    __history_free ( h );
+    close ( fd );
+}
+
+/**
+ * @param filename The filename of the history cache.
+ * @param record The type of record.
+ * @param entry The entry.
+ *
+ * Append a record to the history file, and compact it when it grew too big.
+ */
+static void __history_append ( const char *filename, char record, const char *entry )
+{
+    int fd = -1;
+    // A compaction can replace the file between opening and locking it, then try again.
+    for ( int retry = 0; fd < 0 && retry < 5; retry++ ) {
+        fd = open ( filename, O_WRONLY | O_APPEND | ( record == HISTORY_RECORD_INCREMENT ? O_CREAT : 0 ), 0666 );
+        if ( fd < 0 ) {
+            g_warning ( "Failed to open file: %s", g_strerror ( errno ) );
+            return;
+        }
+        struct stat st_fd, st_path;
+        if ( flock ( fd, LOCK_SH ) == 0 && fstat ( fd, &st_fd ) == 0 && stat ( filename, &st_path ) == 0
+             && ( st_fd.st_ino != st_path.st_ino || st_fd.st_dev != st_path.st_dev ) ) {
+            close ( fd );
+            fd = -1;
+        }
+    }
+    if ( fd < 0 ) {
+        g_warning ( "Failed to open history file: it keeps being replaced." );
+        return;
+    }
+    // One write, so records of other instances do not end up in the middle.
+    char    *line   = g_strdup_printf ( "%c %s\n", record, entry );
+    size_t  length  = strlen ( line );
+    gboolean compact = FALSE;
+    if ( write ( fd, line, length ) != (ssize_t) length ) {
+        g_warning ( "Failed to write history file: %s", g_strerror ( errno ) );
+    }
+    else {
+        struct stat st;
+        compact = fstat ( fd, &st ) == 0 && st.st_size > HISTORY_COMPACT_SIZE;
+    }
+    g_free ( line );
+    if ( close ( fd ) != 0 ) {
+        g_warning ( "Failed to close history file: %s", g_strerror ( errno ) );
+    }
+    if ( compact ) {
+        __history_compact ( filename );
+    }
 }
 
 void history_set ( const char *filename, const char *entry )
@@ -193,143 +360,299 @@ void history_set ( const char *filename, const char *entry )
             return;
         }
     }
+    // Entries are stored one per line.
+    if ( strchr ( entry, '\n' ) != NULL ) {
+        return;
+    }
 
-    int          found  = 0;
-    unsigned int curr   = 0;
-    unsigned int length = 0;
-    _element     **list = NULL;
-    // Open file for reading and writing.
-    FILE         *fd = g_fopen ( filename, "r" );
-    if ( fd != NULL ) {
-        // Get list.
-        list = __history_get_element_list ( fd, &length );
-        // Close file, if fails let user know on stderr.
-        if ( fclose ( fd ) != 0 ) {
-            g_warning ( "Failed to close history file: %s", g_strerror ( errno ) );
-        }
+    __history_append ( filename, HISTORY_RECORD_INCREMENT, entry );
+}
+
+void history_remove ( const char *filename, const char *entry )
+{
+    if ( config.disable_history ) {
+        return;
     }
-    // Look if the entry exists.
-    for ( unsigned int iter = 0; !found && iter < length; iter++ ) {
-        if ( strcmp ( list[iter]->name, entry ) == 0 ) {
-            curr  = iter;
-            found = 1;
-        }
+    if ( strchr ( entry, '\n' ) != NULL ) {
+        return;
     }
+    __history_append ( filename, HISTORY_RECORD_REMOVE, entry );
+}
 
-    if ( found ) {
-        // If exists, increment list index number
-        list[curr]->index++;
-    }
-    else{
-        // If not exists, add it.
-        // Increase list by one
-        list         = g_realloc ( list, ( length + 2 ) * sizeof ( _element* ) );
-        list[length] = g_malloc ( sizeof ( _element ) );
-        // Copy name
-        if ( list[length] != NULL ) {
-            list[length]->name = g_strdup ( entry );
-            // set # hits
-            list[length]->index = 1;
+/**
+ * Header of the index file. It is followed by the entries in history order,
+ * the hash table and the string blob.
+ */
+typedef struct
+{
+    /** #HISTORY_INDEX_MAGIC */
+    char     magic[8];
+    /** #HISTORY_INDEX_VERSION */
+    uint32_t version;
+    /** Number of entries. */
+    uint32_t num_entries;
+    /** Number of buckets in the hash table, a power of two. */
+    uint32_t num_buckets;
+    /** Size of the string blob. */
+    uint32_t blob_size;
+    /** The max history size the list was cut to. */
+    uint32_t max_history_size;
+    /** Keeps the fields after it aligned. */
+    uint32_t padding;
+    /** Device of the history file the index was made from. */
+    int64_t  dev;
+    /** Inode of the history file the index was made from. */
+    int64_t  ino;
+    /** Size of the history file the index was made from. */
+    int64_t  size;
+    /** Modification time of the history file the index was made from. */
+    int64_t  mtime;
+    /** Nanoseconds of the modification time. */
+    int64_t  mtime_nsec;
+} HistoryIndexHeader;
 
-            length++;
-            list[length] = NULL;
-        }
+/**
+ * Entry in the index file.
+ */
+typedef struct
+{
+    /** Offset of the entry in the blob. */
+    uint32_t name;
+    /** Hash of the entry. */
+    uint32_t hash;
+    /** Use count. */
+    int64_t  count;
+    /** See #HistoryIndexEntry::last_used. */
+    int64_t  last_used;
+} HistoryIndexRecord;
+
+G_STATIC_ASSERT ( sizeof ( HistoryIndexHeader ) % 8 == 0 );
+G_STATIC_ASSERT ( sizeof ( HistoryIndexRecord ) % 8 == 0 );
+
+struct _HistoryIndex
+{
+    /** The index data, mapped or allocated. */
+    void                     *data;
+    /** Size of the data. */
+    size_t                   size;
+    /** The data is mapped. */
+    gboolean                 mapped;
+    /** The header at the start of data. */
+    const HistoryIndexHeader *header;
+    /** The entries. */
+    const HistoryIndexRecord *records;
+    /** The hash table, index in records. */
+    const uint32_t           *buckets;
+    /** The string blob. */
+    const char               *blob;
+};
+
+/**
+ * @param str The entry.
+ *
+ * FNV-1a, the index is shared between runs so it needs a fixed hash.
+ *
+ * @returns the hash.
+ */
+static uint32_t __history_index_hash ( const char *str )
+{
+    uint32_t hash = 2166136261u;
+    for ( const unsigned char *iter = (const unsigned char *) str; *iter != '\0'; iter++ ) {
+        hash = ( hash ^ *iter ) * 16777619u;
     }
+    return hash;
+}
 
-    fd = fopen ( filename, "w" );
-    if ( fd == NULL ) {
-        g_warning ( "Failed to open file: %s", g_strerror ( errno ) );
+static void __history_index_stamp ( HistoryIndexHeader *header, const struct stat *st )
+{
+    header->dev        = st->st_dev;
+    header->ino        = st->st_ino;
+    header->size       = st->st_size;
+    header->mtime      = st->st_mtim.tv_sec;
+    header->mtime_nsec = st->st_mtim.tv_nsec;
+}
+
+/**
+ * @param index The index, data and size set.
+ *
+ * Check the index data, so lookups do not have to.
+ *
+ * @returns FALSE if the data is corrupt.
+ */
+static gboolean __history_index_validate ( HistoryIndex *index )
+{
+    if ( index->size < sizeof ( HistoryIndexHeader ) ) {
+        return FALSE;
     }
-    else {
-        // Write list.
-        __history_write_element_list ( fd, list, length );
-        // Close file, if fails let user know on stderr.
-        if ( fclose ( fd ) != 0 ) {
-            g_warning ( "Failed to close history file: %s", g_strerror ( errno ) );
+    const HistoryIndexHeader *header = index->header = (const HistoryIndexHeader *) index->data;
+    if ( memcmp ( header->magic, HISTORY_INDEX_MAGIC, sizeof ( header->magic ) ) != 0
+         || header->version != HISTORY_INDEX_VERSION || header->num_buckets == 0
+         || ( header->num_buckets & ( header->num_buckets - 1 ) ) != 0 || header->num_entries >= header->num_buckets ) {
+        return FALSE;
+    }
+    uint64_t size = sizeof ( HistoryIndexHeader ) + (uint64_t) header->num_entries * sizeof ( HistoryIndexRecord )
+                    + (uint64_t) header->num_buckets * sizeof ( uint32_t ) + header->blob_size;
+    if ( size != index->size ) {
+        return FALSE;
+    }
+    index->records = (const HistoryIndexRecord *) ( header + 1 );
+    index->buckets = (const uint32_t *) ( index->records + header->num_entries );
+    index->blob    = (const char *) ( index->buckets + header->num_buckets );
+    if ( header->blob_size == 0 || index->blob[header->blob_size - 1] != '\0' ) {
+        return FALSE;
+    }
+    for ( uint32_t iter = 0; iter < header->num_entries; iter++ ) {
+        if ( index->records[iter].name >= header->blob_size ) {
+            return FALSE;
         }
     }
-    // Free the list.
-    for ( unsigned int iter = 0; iter < length; iter++ ) {
-        g_free ( list[iter]->name );
-        g_free ( list[iter] );
+    uint32_t empty = 0;
+    for ( uint32_t iter = 0; iter < header->num_buckets; iter++ ) {
+        if ( index->buckets[iter] == HISTORY_INDEX_EMPTY ) {
+            empty++;
+        }
+        else if ( index->buckets[iter] >= header->num_entries ) {
+            return FALSE;
+        }
     }
-    g_free ( list );
+    // Each entry takes one bucket, lookups rely on the remaining ones being empty to terminate.
+    return empty >= header->num_buckets - header->num_entries;
 }
 
-void history_remove ( const char *filename, const char *entry )
+/**
+ * @param filename The filename of the index.
+ * @param st The history file.
+ *
+ * @returns the mapped index, or NULL if it is missing, corrupt or out of date.
+ */
+static HistoryIndex * __history_index_map ( const char *filename, const struct stat *st )
 {
-    if ( config.disable_history ) {
-        return;
+    int fd = g_open ( filename, O_RDONLY, 0 );
+    if ( fd < 0 ) {
+        return NULL;
     }
-    _element     ** list = NULL;
-    int          found   = 0;
-    unsigned int curr    = 0;
-    unsigned int length  = 0;
-    // Open file for reading and writing.
-    FILE         *fd = g_fopen ( filename, "r" );
-    if ( fd == NULL ) {
-        g_warning ( "Failed to open file: %s", g_strerror ( errno ) );
-        return;
+    struct stat ist;
+    void        *map = MAP_FAILED;
+    if ( fstat ( fd, &ist ) == 0 && ist.st_size > 0 ) {
+        map = mmap ( NULL, ist.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
     }
-    // Get list.
-    list = __history_get_element_list ( fd, &length );
-
-    // Close file, if fails let user know on stderr.
-    if ( fclose ( fd ) != 0 ) {
-        g_warning ( "Failed to close history file: %s", g_strerror ( errno ) );
+    close ( fd );
+    if ( map == MAP_FAILED ) {
+        return NULL;
     }
-    // Find entry.
-    for ( unsigned int iter = 0; !found && iter < length; iter++ ) {
-        if ( strcmp ( list[iter]->name, entry ) == 0 ) {
-            curr  = iter;
-            found = 1;
-        }
+    HistoryIndex *index = g_malloc0 ( sizeof ( HistoryIndex ) );
+    index->data   = map;
+    index->size   = ist.st_size;
+    index->mapped = TRUE;
+    HistoryIndexHeader stamp;
+    __history_index_stamp ( &stamp, st );
+    if ( !__history_index_validate ( index ) || index->header->dev != stamp.dev || index->header->ino != stamp.ino
+         || index->header->size != stamp.size || index->header->mtime != stamp.mtime
+         || index->header->mtime_nsec != stamp.mtime_nsec || index->header->max_history_size != config.max_history_size ) {
+        history_index_close ( index );
+        return NULL;
     }
+    return index;
+}
 
-    // If found, remove it and write out new file.
-    if ( found ) {
-        // Remove the entry.
-        g_free ( list[curr]->name );
-        g_free ( list[curr] );
-        // Swap last to here (if list is size 1, we just swap empty sets).
-        list[curr] = list[length - 1];
-        // Empty last.
-        list[length - 1] = NULL;
-        length--;
-
-        fd = g_fopen ( filename, "w" );
-        // Clear list.
-        if ( fd != NULL ) {
-            // Write list.
-            __history_write_element_list ( fd, list, length );
-            // Close file, if fails let user know on stderr.
-            if ( fclose ( fd ) != 0 ) {
-                g_warning ( "Failed to close history file: %s", g_strerror ( errno ) );
-            }
-        }
-        else{
-            g_warning ( "Failed to open file: %s", g_strerror ( errno ) );
-        }
+/**
+ * @param fd The history file.
+ * @param st The history file.
+ *
+ * Replay the history file into a new index.
+ *
+ * @returns the index.
+ */
+static HistoryIndex * __history_index_build ( FILE *fd, const struct stat *st )
+{
+    _history     *h      = __history_load ( fd );
+    _element     **list  = (_element * *) h->list->pdata;
+    unsigned int length  = MIN ( h->list->len, config.max_history_size );
+    if ( h->list->len > 0 ) {
+        g_qsort_with_data ( list, h->list->len, sizeof ( _element* ), __element_sort_func, NULL );
+    }
+    HistoryIndexHeader header = {
+        .version          = HISTORY_INDEX_VERSION,
+        .num_entries      = length,
+        .num_buckets      = 1,
+        .max_history_size = config.max_history_size,
+    };
+    memcpy ( header.magic, HISTORY_INDEX_MAGIC, sizeof ( header.magic ) );
+    __history_index_stamp ( &header, st );
+    // Keep the table at most half full.
+    while ( header.num_buckets <= 2 * length ) {
+        header.num_buckets *= 2;
+    }
+    GString            *blob    = g_string_new ( NULL );
+    HistoryIndexRecord *records = g_malloc0_n ( length, sizeof ( HistoryIndexRecord ) );
+    uint32_t           *buckets = g_malloc_n ( header.num_buckets, sizeof ( uint32_t ) );
+    for ( uint32_t iter = 0; iter < header.num_buckets; iter++ ) {
+        buckets[iter] = HISTORY_INDEX_EMPTY;
     }
-
-    // Free the list.
     for ( unsigned int iter = 0; iter < length; iter++ ) {
-        g_free ( list[iter]->name );
-        g_free ( list[iter] );
+        records[iter].name      = blob->len;
+        records[iter].hash      = __history_index_hash ( list[iter]->name );
+        records[iter].count     = list[iter]->index;
+        records[iter].last_used = list[iter]->last;
+        g_string_append_len ( blob, list[iter]->name, strlen ( list[iter]->name ) + 1 );
+        uint32_t bucket = records[iter].hash & ( header.num_buckets - 1 );
+        while ( buckets[bucket] != HISTORY_INDEX_EMPTY ) {
+            bucket = ( bucket + 1 ) & ( header.num_buckets - 1 );
+        }
+        buckets[bucket] = iter;
     }
-    if ( list != NULL ) {
-        g_free ( list );
+    __history_free ( h );
+    g_string_append_c ( blob, '\0' );
+    header.blob_size = blob->len;
+
+    HistoryIndex *index = g_malloc0 ( sizeof ( HistoryIndex ) );
+    index->size = sizeof ( header ) + length * sizeof ( HistoryIndexRecord ) + header.num_buckets * sizeof ( uint32_t ) + blob->len;
+    index->data = g_malloc ( index->size );
+    char *iter = index->data;
+    memcpy ( iter, &header, sizeof ( header ) );
+    iter += sizeof ( header );
+    if ( length > 0 ) {
+        memcpy ( iter, records, length * sizeof ( HistoryIndexRecord ) );
+        iter += length * sizeof ( HistoryIndexRecord );
     }
+    memcpy ( iter, buckets, header.num_buckets * sizeof ( uint32_t ) );
+    iter += header.num_buckets * sizeof ( uint32_t );
+    memcpy ( iter, blob->str, blob->len );
+    g_string_free ( blob, TRUE );
+    g_free ( buckets );
+    g_free ( records );
+    __history_index_validate ( index );
+    return index;
 }
 
-char ** history_get_list ( const char *filename, unsigned int *length )
+/**
+ * @param filename The filename of the index.
+ * @param index The index.
+ *
+ * Write the index for the next run, instances that have the old one mapped keep it.
+ */
+static void __history_index_write ( const char *filename, const HistoryIndex *index )
 {
-    *length = 0;
+    char *tmp_file = g_strconcat ( filename, ".XXXXXX", NULL );
+    int  fd        = g_mkstemp ( tmp_file );
+    if ( fd < 0 ) {
+        g_debug ( "Failed to write history index: %s", g_strerror ( errno ) );
+        g_free ( tmp_file );
+        return;
+    }
+    gboolean ok = write ( fd, index->data, index->size ) == (ssize_t) index->size;
+    if ( close ( fd ) != 0 || !ok || rename ( tmp_file, filename ) != 0 ) {
+        g_debug ( "Failed to write history index: %s", g_strerror ( errno ) );
+        unlink ( tmp_file );
+    }
+    g_free ( tmp_file );
+}
 
+HistoryIndex * history_index_open ( const char *filename )
+{
     if ( config.disable_history ) {
         return NULL;
     }
-    char **retv = NULL;
     // Open file.
     FILE *fd = g_fopen ( filename, "r" );
     if ( fd == NULL ) {
@@ -340,12 +663,86 @@ char ** history_get_list ( const char *filename, unsigned int *length )
         }
         return NULL;
     }
-    // Get list.
-    retv = __history_get_element_list_fields ( fd, length );
+    HistoryIndex *index      = NULL;
+    char         *index_file = g_strconcat ( filename, HISTORY_INDEX_SUFFIX, NULL );
+    struct stat  st;
+    if ( fstat ( fileno ( fd ), &st ) == 0 ) {
+        index = __history_index_map ( index_file, &st );
+        if ( index == NULL ) {
+            index = __history_index_build ( fd, &st );
+            __history_index_write ( index_file, index );
+        }
+    }
+    g_free ( index_file );
 
     // Close file, if fails let user know on stderr.
     if ( fclose ( fd ) != 0 ) {
         g_warning ( "Failed to close history file: %s", g_strerror ( errno ) );
     }
+    return index;
+}
+
+void history_index_close ( HistoryIndex *index )
+{
+    if ( index == NULL ) {
+        return;
+    }
+    if ( index->mapped ) {
+        munmap ( index->data, index->size );
+    }
+    else {
+        g_free ( index->data );
+    }
+    g_free ( index );
+}
+
+unsigned int history_index_get_length ( const HistoryIndex *index )
+{
+    return ( index != NULL ) ? index->header->num_entries : 0;
+}
+
+const char * history_index_get_entry ( const HistoryIndex *index, unsigned int rank )
+{
+    if ( rank >= history_index_get_length ( index ) ) {
+        return NULL;
+    }
+    return &( index->blob[index->records[rank].name] );
+}
+
+gboolean history_index_lookup ( const HistoryIndex *index, const char *entry, HistoryIndexEntry *result )
+{
+    if ( index == NULL ) {
+        return FALSE;
+    }
+    uint32_t hash = __history_index_hash ( entry );
+    uint32_t mask = index->header->num_buckets - 1;
+    // The table is never full, so there is always an empty bucket to stop at.
+    for ( uint32_t bucket = hash & mask; index->buckets[bucket] != HISTORY_INDEX_EMPTY; bucket = ( bucket + 1 ) & mask ) {
+        const HistoryIndexRecord *record = &( index->records[index->buckets[bucket]] );
+        if ( record->hash == hash && strcmp ( &( index->blob[record->name] ), entry ) == 0 ) {
+            if ( result != NULL ) {
+                result->rank      = index->buckets[bucket];
+                result->count     = record->count;
+                result->last_used = record->last_used;
+            }
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+char ** history_get_list ( const char *filename, unsigned int *length )
+{
+    HistoryIndex *index = history_index_open ( filename );
+    char         **retv = NULL;
+    *length = history_index_get_length ( index );
+    if ( *length > 0 ) {
+        retv = g_malloc ( ( *length + 1 ) * sizeof ( char* ) );
+        for ( unsigned int iter = 0; iter < *length; iter++ ) {
+            retv[iter] = g_strdup ( history_index_get_entry ( index, iter ) );
+        }
+        retv[*length] = NULL;
+    }
+    history_index_close ( index );
     return retv;
 }
@@ -0,0 +1,409 @@
+/*
+ * rofi
+ *
+ * MIT/X11 License
+ * Copyright © 2013-2020 Qball Cow <qball@gmpclient.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/** The log domain of this desktop file reader. */
+#define G_LOG_DOMAIN    "DesktopEntry"
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include "rofi-desktop-entry.h"
+
+/** The group describing the application. */
+#define DESKTOP_ENTRY_GROUP      "Desktop Entry"
+/** Prefix of the groups describing the application actions. */
+#define DESKTOP_ACTION_PREFIX    "Desktop Action "
+/** Group index of the lines in groups that are not kept. */
+#define DESKTOP_GROUP_SKIP       G_MAXUINT
+
+/**
+ * A key of one of the groups kept.
+ */
+typedef struct
+{
+    /** Index of the group in #RofiDesktopEntry::groups. */
+    unsigned int group;
+    /** The key name, points into the file contents. */
+    const char   *name;
+    /** The raw untranslated value, NULL if missing. */
+    const char   *value;
+    /** The raw value of the best translation, NULL if missing. */
+    const char   *locale_value;
+    /** Index of the locale of locale_value in g_get_language_names(). */
+    unsigned int locale_rank;
+} DesktopEntryKey;
+
+struct _RofiDesktopEntry
+{
+    /** The file contents, names and values point into it. */
+    char      *contents;
+    /** The names of the groups kept. */
+    GPtrArray *groups;
+    /** The keys of all groups kept. */
+    GArray    *keys;
+    /** Per group, maps the key names to their index in #keys plus one. */
+    GPtrArray *key_index;
+};
+
+static unsigned int desktop_entry_find_group ( const RofiDesktopEntry *de, const char *group )
+{
+    for ( unsigned int i = 0; i < de->groups->len; i++ ) {
+        if ( strcmp ( g_ptr_array_index ( de->groups, i ), group ) == 0 ) {
+            return i;
+        }
+    }
+    return DESKTOP_GROUP_SKIP;
+}
+
+static DesktopEntryKey *desktop_entry_find_key ( const RofiDesktopEntry *de, unsigned int group, const char *key )
+{
+    guint index = GPOINTER_TO_UINT ( g_hash_table_lookup ( g_ptr_array_index ( de->key_index, group ), key ) );
+    return index > 0 ? &g_array_index ( de->keys, DesktopEntryKey, index - 1 ) : NULL;
+}
+
+/**
+ * @param locale The locale of a translated key.
+ *
+ * @returns the index of the locale in the language names, or G_MAXUINT when not used.
+ */
+static unsigned int desktop_entry_locale_rank ( const char *locale )
+{
+    const gchar * const *languages = g_get_language_names ();
+    for ( unsigned int i = 0; languages[i] != NULL; i++ ) {
+        if ( strcmp ( languages[i], locale ) == 0 ) {
+            return i;
+        }
+    }
+    return G_MAXUINT;
+}
+
+/**
+ * @param de The desktop entry being read.
+ * @param group The group of the line.
+ * @param line The line, modified in place.
+ *
+ * @returns FALSE if it is not a key-value pair.
+ */
+static gboolean desktop_entry_parse_key ( RofiDesktopEntry *de, unsigned int group, char *line )
+{
+    char *eq = strchr ( line, '=' );
+    if ( eq == NULL || eq == line ) {
+        return FALSE;
+    }
+    if ( group == DESKTOP_GROUP_SKIP ) {
+        return TRUE;
+    }
+    char *value = eq + 1;
+    while ( *value == ' ' || *value == '\t' ) {
+        value++;
+    }
+    char *key_end = eq;
+    while ( key_end > line && ( key_end[-1] == ' ' || key_end[-1] == '\t' ) ) {
+        key_end--;
+    }
+    *key_end = '\0';
+
+    const char   *locale = NULL;
+    unsigned int rank    = 0;
+    char         *open   = strchr ( line, '[' );
+    if ( open != NULL ) {
+        char *close = strchr ( open, ']' );
+        if ( close == NULL || close[1] != '\0' ) {
+            return FALSE;
+        }
+        *open  = '\0';
+        *close = '\0';
+        locale = open + 1;
+        rank   = desktop_entry_locale_rank ( locale );
+        if ( rank == G_MAXUINT ) {
+            // Translation not used, skip it.
+            return TRUE;
+        }
+    }
+
+    DesktopEntryKey *k = desktop_entry_find_key ( de, group, line );
+    if ( k == NULL ) {
+        DesktopEntryKey nk = { .group = group, .name = line, };
+        g_array_append_val ( de->keys, nk );
+        g_hash_table_insert ( g_ptr_array_index ( de->key_index, group ), line, GUINT_TO_POINTER ( de->keys->len ) );
+        k = &g_array_index ( de->keys, DesktopEntryKey, de->keys->len - 1 );
+    }
+    if ( locale == NULL ) {
+        k->value = value;
+    }
+    else if ( k->locale_value == NULL || rank <= k->locale_rank ) {
+        k->locale_value = value;
+        k->locale_rank  = rank;
+    }
+    return TRUE;
+}
+
+RofiDesktopEntry *rofi_desktop_entry_load ( const char *path, GError **error )
+{
+    gchar *contents = NULL;
+    gsize length    = 0;
+    if ( !g_file_get_contents ( path, &contents, &length, error ) ) {
+        return NULL;
+    }
+    RofiDesktopEntry *de = g_malloc0 ( sizeof ( *de ) );
+    de->contents  = contents;
+    de->groups    = g_ptr_array_new ();
+    de->keys      = g_array_new ( FALSE, FALSE, sizeof ( DesktopEntryKey ) );
+    de->key_index = g_ptr_array_new_with_free_func ( (GDestroyNotify) g_hash_table_destroy );
+
+    gboolean     in_group = FALSE;
+    unsigned int group    = DESKTOP_GROUP_SKIP;
+    unsigned int lineno   = 0;
+    char         *end     = contents + length;
+    // g_file_get_contents() terminates the contents, so the last line is terminated too.
+    for ( char *line = contents, *next; line < end; line = next ) {
+        char *eol = memchr ( line, '\n', end - line );
+        if ( eol == NULL ) {
+            eol = end;
+        }
+        next = ( eol < end ) ? eol + 1 : end;
+        *eol = '\0';
+        lineno++;
+        if ( eol > line && eol[-1] == '\r' ) {
+            eol[-1] = '\0';
+        }
+        while ( *line == ' ' || *line == '\t' ) {
+            line++;
+        }
+        if ( *line == '\0' || *line == '#' ) {
+            continue;
+        }
+        gboolean valid = TRUE;
+        if ( *line == '[' ) {
+            char *close = strchr ( line, ']' );
+            valid = ( close != NULL );
+            if ( valid ) {
+                *close = '\0';
+                const char *name = line + 1;
+                in_group = TRUE;
+                group    = DESKTOP_GROUP_SKIP;
+                if ( strcmp ( name, DESKTOP_ENTRY_GROUP ) == 0 || g_str_has_prefix ( name, DESKTOP_ACTION_PREFIX ) ) {
+                    group = desktop_entry_find_group ( de, name );
+                    if ( group == DESKTOP_GROUP_SKIP ) {
+                        group = de->groups->len;
+                        g_ptr_array_add ( de->groups, (gpointer) name );
+                        g_ptr_array_add ( de->key_index, g_hash_table_new ( g_str_hash, g_str_equal ) );
+                    }
+                }
+            }
+        }
+        else {
+            valid = in_group && desktop_entry_parse_key ( de, group, line );
+        }
+        if ( !valid ) {
+            g_set_error ( error, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_PARSE,
+                          "Line %u is not a key-value pair, group, or comment", lineno );
+            rofi_desktop_entry_free ( de );
+            return NULL;
+        }
+    }
+    return de;
+}
+
+void rofi_desktop_entry_free ( RofiDesktopEntry *de )
+{
+    if ( de == NULL ) {
+        return;
+    }
+    g_ptr_array_free ( de->key_index, TRUE );
+    g_array_free ( de->keys, TRUE );
+    g_ptr_array_free ( de->groups, TRUE );
+    g_free ( de->contents );
+    g_free ( de );
+}
+
+static const DesktopEntryKey *desktop_entry_lookup ( const RofiDesktopEntry *de, const char *group, const char *key )
+{
+    unsigned int index = desktop_entry_find_group ( de, group );
+    if ( index == DESKTOP_GROUP_SKIP ) {
+        return NULL;
+    }
+    return desktop_entry_find_key ( de, index, key );
+}
+
+/**
+ * @param raw The raw value.
+ * @param list If the value is a list, separated by ';'.
+ * @param length Set to the number of items (can be NULL).
+ *
+ * Unescape the value, and split it when it is a list. As for GKeyFile a
+ * trailing separator does not start a new item.
+ *
+ * @returns the items, or NULL if the value is not valid UTF-8.
+ */
+static char **desktop_entry_unescape ( const char *raw, gboolean list, gsize *length )
+{
+    GPtrArray *items = g_ptr_array_new_with_free_func ( g_free );
+    GString   *item  = g_string_sized_new ( strlen ( raw ) );
+    for ( const char *p = raw; ; p++ ) {
+        if ( *p == '\0' || ( list && *p == ';' ) ) {
+            if ( *p != '\0' || !list || item->len > 0 ) {
+                g_ptr_array_add ( items, g_strndup ( item->str, item->len ) );
+            }
+            g_string_truncate ( item, 0 );
+            if ( *p == '\0' ) {
+                break;
+            }
+            continue;
+        }
+        if ( *p == '\\' && p[1] != '\0' ) {
+            p++;
+            switch ( *p )
+            {
+            case 's':
+                g_string_append_c ( item, ' ' );
+                break;
+            case 'n':
+                g_string_append_c ( item, '\n' );
+                break;
+            case 't':
+                g_string_append_c ( item, '\t' );
+                break;
+            case 'r':
+                g_string_append_c ( item, '\r' );
+                break;
+            case '\\':
+                g_string_append_c ( item, '\\' );
+                break;
+            case ';':
+                if ( !list ) {
+                    g_string_append_c ( item, '\\' );
+                }
+                g_string_append_c ( item, ';' );
+                break;
+            default:
+                // Keep unknown escapes as they are.
+                g_string_append_c ( item, '\\' );
+                g_string_append_c ( item, *p );
+                break;
+            }
+            continue;
+        }
+        g_string_append_c ( item, *p );
+    }
+    g_string_free ( item, TRUE );
+    for ( unsigned int i = 0; i < items->len; i++ ) {
+        if ( !g_utf8_validate ( g_ptr_array_index ( items, i ), -1, NULL ) ) {
+            g_ptr_array_free ( items, TRUE );
+            return NULL;
+        }
+    }
+    if ( length != NULL ) {
+        *length = items->len;
+    }
+    g_ptr_array_set_free_func ( items, NULL );
+    g_ptr_array_add ( items, NULL );
+    return (char * *) g_ptr_array_free ( items, FALSE );
+}
+
+static char *desktop_entry_unescape_string ( const char *raw )
+{
+    char **items = raw ? desktop_entry_unescape ( raw, FALSE, NULL ) : NULL;
+    if ( items == NULL ) {
+        return NULL;
+    }
+    char *retv = items[0];
+    g_free ( items );
+    return retv;
+}
+
+gboolean rofi_desktop_entry_has_group ( const RofiDesktopEntry *de, const char *group )
+{
+    return desktop_entry_find_group ( de, group ) != DESKTOP_GROUP_SKIP;
+}
+
+gboolean rofi_desktop_entry_has_key ( const RofiDesktopEntry *de, const char *group, const char *key )
+{
+    const DesktopEntryKey *k = desktop_entry_lookup ( de, group, key );
+    return k != NULL && k->value != NULL;
+}
+
+char *rofi_desktop_entry_get_string ( const RofiDesktopEntry *de, const char *group, const char *key )
+{
+    const DesktopEntryKey *k = desktop_entry_lookup ( de, group, key );
+    return k ? desktop_entry_unescape_string ( k->value ) : NULL;
+}
+
+char *rofi_desktop_entry_get_locale_string ( const RofiDesktopEntry *de, const char *group, const char *key )
+{
+    const DesktopEntryKey *k = desktop_entry_lookup ( de, group, key );
+    if ( k == NULL ) {
+        return NULL;
+    }
+    char *retv = desktop_entry_unescape_string ( k->locale_value );
+    if ( retv == NULL ) {
+        retv = desktop_entry_unescape_string ( k->value );
+    }
+    return retv;
+}
+
+char **rofi_desktop_entry_get_string_list ( const RofiDesktopEntry *de, const char *group, const char *key, gsize *length )
+{
+    const DesktopEntryKey *k = desktop_entry_lookup ( de, group, key );
+    if ( length != NULL ) {
+        *length = 0;
+    }
+    if ( k == NULL || k->value == NULL ) {
+        return NULL;
+    }
+    return desktop_entry_unescape ( k->value, TRUE, length );
+}
+
+char **rofi_desktop_entry_get_locale_string_list ( const RofiDesktopEntry *de, const char *group, const char *key, gsize *length )
+{
+    const DesktopEntryKey *k = desktop_entry_lookup ( de, group, key );
+    if ( length != NULL ) {
+        *length = 0;
+    }
+    if ( k == NULL ) {
+        return NULL;
+    }
+    char **retv = k->locale_value ? desktop_entry_unescape ( k->locale_value, TRUE, length ) : NULL;
+    if ( retv == NULL && k->value != NULL ) {
+        retv = desktop_entry_unescape ( k->value, TRUE, length );
+    }
+    return retv;
+}
+
+gboolean rofi_desktop_entry_get_boolean ( const RofiDesktopEntry *de, const char *group, const char *key )
+{
+    const DesktopEntryKey *k = desktop_entry_lookup ( de, group, key );
+    if ( k == NULL || k->value == NULL ) {
+        return FALSE;
+    }
+    // Ignore trailing white space, like GKeyFile. As GKeyFile only 'true' is true, not '1'.
+    size_t len = strlen ( k->value );
+    while ( len > 0 && g_ascii_isspace ( k->value[len - 1] ) ) {
+        len--;
+    }
+    return len == 4 && strncmp ( k->value, "true", 4 ) == 0;
+}
@@ -28,10 +28,22 @@
 /** The log domain of this Helper. */
 #define G_LOG_DOMAIN    "Helpers.IconFetcher"
 
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <glib/gstdio.h>
+
 #include "rofi-icon-fetcher.h"
 #include "rofi-types.h"
+#include "rofi.h"
 #include "helper.h"
 #include "settings.h"
+#include "timings.h"
 
 #include "xcb.h"
 #include "keyb.h"
@@ -39,38 +51,217 @@
 
 #include "nkutils-xdg-theme.h"
 
+/** Filename of the icon cache in the cache directory. */
+#define ICON_CACHE_FILE         "rofi-icons.cache"
+/** Magic at the start of the icon cache. */
+#define ICON_CACHE_MAGIC        "rofiicon"
+/** Version of the icon cache format. */
+#define ICON_CACHE_VERSION      2
+/** Icons are left out when the cache would grow beyond this size. */
+#define ICON_CACHE_MAX_SIZE     ( 32 * 1024 * 1024 )
+/** Alignment of the pixel data in the icon cache. */
+#define ICON_CACHE_ALIGN        16
+
+/** Filename of the icon theme index in the cache directory. */
+#define ICON_THEME_INDEX_FILE           "rofi-icon-theme.cache"
+/** Magic at the start of the icon theme index. */
+#define ICON_THEME_INDEX_MAGIC          "rofiithm"
+/** Version of the icon theme index format. */
+#define ICON_THEME_INDEX_VERSION        2
+/** Lookups are not stored beyond this number. */
+#define ICON_THEME_INDEX_MAX_RECORDS    65536
+
+/** Least recently used surfaces are dropped when the loaded icons take more memory than this. */
+#define ICON_FETCHER_MAX_BYTES    ( 64 * 1024 * 1024 )
+
+/**
+ * Header of the icon cache. It is followed by the records, the string blob
+ * and the pixel data.
+ */
+typedef struct
+{
+    /** #ICON_CACHE_MAGIC */
+    char     magic[8];
+    /** #ICON_CACHE_VERSION */
+    uint32_t version;
+    /** Number of records. */
+    uint32_t num_records;
+    /** Size of the string blob. */
+    uint32_t blob_size;
+    /** Offset of the settings the icons were loaded with. */
+    uint32_t config_key;
+    /** Size of the pixel data. */
+    uint64_t pixels_size;
+} IconCacheHeader;
+
+/**
+ * An icon in the icon cache.
+ */
+typedef struct
+{
+    /** Offset of the icon name. */
+    uint32_t name;
+    /** Offset of the file the icon was loaded from. */
+    uint32_t path;
+    /** The requested size. */
+    int32_t  size;
+    /** The cairo_format_t of the pixels. */
+    uint32_t format;
+    /** Width in pixels. */
+    uint32_t width;
+    /** Height in pixels. */
+    uint32_t height;
+    /** Bytes per row. */
+    uint32_t stride;
+    /** Keeps the fields after it aligned. */
+    uint32_t padding;
+    /** Modification time of the file in nanoseconds. */
+    int64_t  mtime;
+    /** Offset of the pixels in the pixel data. */
+    uint64_t pixels;
+} IconCacheRecord;
+
+/**
+ * Header of the icon theme index. It is followed by the directory stamps,
+ * the records and the string blob.
+ */
+typedef struct
+{
+    /** #ICON_THEME_INDEX_MAGIC */
+    char     magic[8];
+    /** #ICON_THEME_INDEX_VERSION */
+    uint32_t version;
+    /** Number of directory stamps. */
+    uint32_t num_stamps;
+    /** Number of records. */
+    uint32_t num_records;
+    /** Size of the string blob. */
+    uint32_t blob_size;
+    /** Offset of the icon theme the lookups were done with. */
+    uint32_t theme;
+    /** Keeps the stamps aligned. */
+    uint32_t padding;
+} IconThemeIndexHeader;
+
+/**
+ * Modification time of an icon theme directory.
+ */
+typedef struct
+{
+    /** Offset of the directory. */
+    uint32_t path;
+    /** Keeps the fields after it aligned. */
+    uint32_t padding;
+    /** Modification time in nanoseconds, -1 if it does not exist. */
+    int64_t  mtime;
+} IconThemeIndexStamp;
+
+/**
+ * Result of an icon theme lookup.
+ */
+typedef struct
+{
+    /** Offset of the icon name. */
+    uint32_t name;
+    /** The requested size. */
+    int32_t  size;
+    /** Offset of the file, UINT32_MAX if the theme has no such icon. */
+    uint32_t path;
+} IconThemeIndexRecord;
+
+G_STATIC_ASSERT ( sizeof ( IconCacheHeader ) % 8 == 0 );
+G_STATIC_ASSERT ( sizeof ( IconCacheRecord ) % 8 == 0 );
+G_STATIC_ASSERT ( sizeof ( IconThemeIndexHeader ) % 8 == 0 );
+G_STATIC_ASSERT ( sizeof ( IconThemeIndexStamp ) % 8 == 0 );
+
 typedef struct
 {
     // Context for icon-themes.
-    NkXdgThemeContext *xdg_context;
+    NkXdgThemeContext     *xdg_context;
+    // The themes are preloaded on the first lookup that is not in the index.
+    gsize                 theme_preloaded;
+    // The index is loaded on the first lookup.
+    gsize                 theme_index_loaded;
+    // "size:name" to the icon file, "" if not found. Guarded by the queue lock.
+    GHashTable            *theme_index;
+    // Directory stamps the index is valid for, NULL until it is loaded.
+    GArray                *theme_stamps;
+    // Lookups were added to the index.
+    gboolean              theme_index_dirty;
 
-    // On name.
-    GHashTable        *icon_cache;
+    // On name and size.
+    GHashTable            *icon_cache;
     // On uid.
-    GHashTable        *icon_cache_uid;
+    GHashTable            *icon_cache_uid;
+    // Loaded surfaces, most recently used first.
+    GQueue                lru;
+    // Memory used by the surfaces in lru.
+    size_t                lru_bytes;
+
+    uint32_t              last_uid;
 
-    uint32_t          last_uid;
+    // Guards the queue, the lru and the status of the entries.
+    GMutex                queue_lock;
+    // Requests waiting for a worker, highest priority first.
+    GSequence             *queue;
+    // Bumped when the visible icons change.
+    uint32_t              generation;
+    // Requests are for icons that are not visible yet.
+    gboolean              prefetch;
+    // Pending redraw for visible icons that got loaded.
+    guint                 ready_source;
+
+    // The icon cache is opened on the first query, when the dpi is known.
+    gboolean              disk_cache_opened;
+    // Settings the icons are loaded with.
+    char                  *disk_cache_key;
+    // Mapping of the icon cache file.
+    void                  *disk_cache;
+    size_t                disk_cache_size;
+    const char            *disk_cache_blob;
+    uint8_t               *disk_cache_pixels;
+    // "size:name" to record.
+    GHashTable            *disk_cache_index;
 } IconFetcher;
 
-typedef struct
+/**
+ * Where a request is in the fetcher.
+ */
+typedef enum
 {
-    char  *name;
-    GList *sizes;
-} IconFetcherNameEntry;
+    /** Not queued, or cancelled. */
+    ICON_FETCHER_IDLE,
+    /** Waiting for a worker. */
+    ICON_FETCHER_QUEUED,
+    /** Being loaded. */
+    ICON_FETCHER_RUNNING,
+    /** Loaded, surface is set if it was found. */
+    ICON_FETCHER_DONE,
+} IconFetcherStatus;
 
 typedef struct
 {
-    thread_state         state;
-
-    GCond                *cond;
-    GMutex               *mutex;
-    unsigned int         *acount;
+    // Key in the icon cache.
+    char                 *name;
+    int                  size;
 
     uint32_t             uid;
-    int                  size;
     cairo_surface_t      *surface;
+    // Position in the lru, when the surface is loaded.
+    GList                lru_link;
 
-    IconFetcherNameEntry *entry;
+    // The file the icon was loaded from, to store it in the icon cache.
+    char                 *path;
+    // Modification time of that file.
+    int64_t              mtime;
+    // The icon was taken from the icon cache.
+    gboolean             from_disk_cache;
+
+    IconFetcherStatus    status;
+    // Generation it was last requested in, times two, plus one if visible.
+    uint64_t             priority;
+    // Position in the queue.
+    GSequenceIter        *queue_iter;
 } IconFetcherEntry;
 
 /**
@@ -78,42 +269,656 @@ typedef struct
  */
 IconFetcher *rofi_icon_fetcher_data = NULL;
 
+static void rofi_icon_fetcher_worker ( thread_state *sdata, G_GNUC_UNUSED gpointer user_data );
+
+/** Themes searched after the configured one, hicolor is always searched last. */
+static const gchar * const icon_fallback_themes[] = {
+    "Adwaita",
+    "gnome",
+    NULL
+};
+
+/**
+ * Job pushed to the thread pool for every queued request, the worker picks
+ * the request with the highest priority.
+ */
+static thread_state rofi_icon_fetcher_job = { rofi_icon_fetcher_worker };
+
 static void rofi_icon_fetch_entry_free ( gpointer data )
 {
-    IconFetcherNameEntry *entry = (IconFetcherNameEntry *) data;
+    IconFetcherEntry *sentry = (IconFetcherEntry *) data;
 
-    // Free name/key.
-    g_free ( entry->name );
+    cairo_surface_destroy ( sentry->surface );
+    g_free ( sentry->path );
+    g_free ( sentry->name );
+    g_free ( sentry );
+}
+
+static guint rofi_icon_fetcher_entry_hash ( gconstpointer key )
+{
+    const IconFetcherEntry *sentry = (const IconFetcherEntry *) key;
+    return g_str_hash ( sentry->name ) * 31 + (guint) sentry->size;
+}
 
-    for ( GList *iter = g_list_first ( entry->sizes ); iter; iter = g_list_next ( iter ) ) {
-        IconFetcherEntry *sentry = (IconFetcherEntry *) ( iter->data );
+static gboolean rofi_icon_fetcher_entry_equal ( gconstpointer a, gconstpointer b )
+{
+    const IconFetcherEntry *ea = (const IconFetcherEntry *) a;
+    const IconFetcherEntry *eb = (const IconFetcherEntry *) b;
+    return ea->size == eb->size && g_str_equal ( ea->name, eb->name );
+}
+
+/**
+ * @param sentry The loaded icon.
+ *
+ * Add the surface of the icon to the lru.
+ * Must be called with the queue lock held.
+ */
+static void rofi_icon_fetcher_lru_add ( IconFetcherEntry *sentry )
+{
+    IconFetcher *data = rofi_icon_fetcher_data;
+    if ( sentry->surface == NULL ) {
+        return;
+    }
+    sentry->lru_link.data = sentry;
+    g_queue_push_head_link ( &( data->lru ), &( sentry->lru_link ) );
+    data->lru_bytes += (size_t) cairo_image_surface_get_stride ( sentry->surface ) * cairo_image_surface_get_height ( sentry->surface );
+}
 
+/**
+ * Drop the least recently used surfaces until the loaded icons fit in #ICON_FETCHER_MAX_BYTES.
+ * Dropped icons are loaded again when requested.
+ * Must be called from the main thread, with the queue lock held. Callers
+ * reference the surfaces they keep, so only the fetcher's own reference goes.
+ */
+static void rofi_icon_fetcher_lru_evict ( void )
+{
+    IconFetcher *data = rofi_icon_fetcher_data;
+    // Never drop the surface that was just used.
+    while ( data->lru_bytes > ICON_FETCHER_MAX_BYTES && data->lru.length > 1 ) {
+        IconFetcherEntry *sentry = (IconFetcherEntry *) g_queue_pop_tail_link ( &( data->lru ) )->data;
+        data->lru_bytes -= (size_t) cairo_image_surface_get_stride ( sentry->surface ) * cairo_image_surface_get_height ( sentry->surface );
+        g_debug ( "Evict icon: %s(%d)", sentry->name, sentry->size );
         cairo_surface_destroy ( sentry->surface );
-        g_free ( sentry );
+        sentry->surface         = NULL;
+        sentry->from_disk_cache = FALSE;
+        g_free ( sentry->path );
+        sentry->path   = NULL;
+        sentry->status = ICON_FETCHER_IDLE;
     }
+}
 
-    g_list_free ( entry->sizes );
-    g_free ( entry );
+/**
+ * @param format The cairo format.
+ *
+ * @returns TRUE if the icon cache can store surfaces of this format.
+ */
+static gboolean rofi_icon_fetcher_disk_cache_format ( cairo_format_t format )
+{
+    return format == CAIRO_FORMAT_ARGB32 || format == CAIRO_FORMAT_RGB24;
 }
 
-void rofi_icon_fetcher_init ( void )
+static char *rofi_icon_fetcher_disk_cache_key ( const char *name, int size )
 {
-    g_assert ( rofi_icon_fetcher_data == NULL );
+    return g_strdup_printf ( "%d:%s", size, name );
+}
 
-    static const gchar * const icon_fallback_themes[] = {
-        "Adwaita",
-        "gnome",
+/**
+ * Map the icon cache, if it was written with the current settings.
+ */
+static void rofi_icon_fetcher_disk_cache_open ( void )
+{
+    IconFetcher *data = rofi_icon_fetcher_data;
+    data->disk_cache_opened = TRUE;
+    data->disk_cache_key    = g_strdup_printf ( "%s|%d", config.icon_theme ? config.icon_theme : "", config.dpi );
+    if ( cache_dir == NULL ) {
+        return;
+    }
+    char *path = g_build_filename ( cache_dir, ICON_CACHE_FILE, NULL );
+    int  fd    = g_open ( path, O_RDONLY, 0 );
+    g_free ( path );
+    if ( fd < 0 ) {
+        return;
+    }
+    struct stat st;
+    void        *map = MAP_FAILED;
+    if ( fstat ( fd, &st ) == 0 && (size_t) st.st_size >= sizeof ( IconCacheHeader ) ) {
+        // Writable and private, so surfaces made from it are like any other.
+        map = mmap ( NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+    }
+    close ( fd );
+    if ( map == MAP_FAILED ) {
+        return;
+    }
+    const IconCacheHeader *header  = (const IconCacheHeader *) map;
+    const IconCacheRecord *records = (const IconCacheRecord *) ( header + 1 );
+    const char            *blob    = (const char *) ( records + header->num_records );
+    uint64_t              offset   = sizeof ( IconCacheHeader ) + (uint64_t) header->num_records * sizeof ( IconCacheRecord ) + header->blob_size;
+    offset = ( offset + ICON_CACHE_ALIGN - 1 ) & ~( (uint64_t) ICON_CACHE_ALIGN - 1 );
+    if ( memcmp ( header->magic, ICON_CACHE_MAGIC, sizeof ( header->magic ) ) != 0 || header->version != ICON_CACHE_VERSION
+         || header->pixels_size > (uint64_t) st.st_size || offset + header->pixels_size != (uint64_t) st.st_size || header->blob_size == 0 || blob[header->blob_size - 1] != '\0'
+         || header->config_key >= header->blob_size || g_strcmp0 ( &( blob[header->config_key] ), data->disk_cache_key ) != 0 ) {
+        g_debug ( "Icon cache is outdated or corrupt, ignoring." );
+        munmap ( map, st.st_size );
+        return;
+    }
+    data->disk_cache         = map;
+    data->disk_cache_size    = st.st_size;
+    data->disk_cache_blob    = blob;
+    data->disk_cache_pixels  = (uint8_t *) map + offset;
+    data->disk_cache_index   = g_hash_table_new_full ( g_str_hash, g_str_equal, g_free, NULL );
+    for ( uint32_t index = 0; index < header->num_records; index++ ) {
+        const IconCacheRecord *record = &( records[index] );
+        // Only the last check can overflow, the others keep it in range.
+        if ( record->name >= header->blob_size || record->path >= header->blob_size
+             || !rofi_icon_fetcher_disk_cache_format ( record->format ) || record->width == 0 || record->height == 0
+             || record->stride != (uint32_t) cairo_format_stride_for_width ( record->format, record->width )
+             || record->pixels % ICON_CACHE_ALIGN != 0 || record->pixels > header->pixels_size
+             || (uint64_t) record->stride * record->height > header->pixels_size - record->pixels ) {
+            continue;
+        }
+        g_hash_table_insert ( data->disk_cache_index,
+                              rofi_icon_fetcher_disk_cache_key ( &( blob[record->name] ), record->size ), (gpointer) record );
+    }
+    g_debug ( "Icon cache has %u icons.", g_hash_table_size ( data->disk_cache_index ) );
+}
+
+/**
+ * @param sentry The icon to look up.
+ *
+ * Take the icon from the icon cache, if the file it came from did not change.
+ *
+ * @returns TRUE if the icon was found.
+ */
+static gboolean rofi_icon_fetcher_disk_cache_lookup ( IconFetcherEntry *sentry )
+{
+    IconFetcher *data = rofi_icon_fetcher_data;
+    if ( !data->disk_cache_opened ) {
+        rofi_icon_fetcher_disk_cache_open ();
+    }
+    if ( data->disk_cache_index == NULL ) {
+        return FALSE;
+    }
+    char                  *key    = rofi_icon_fetcher_disk_cache_key ( sentry->name, sentry->size );
+    const IconCacheRecord *record = g_hash_table_lookup ( data->disk_cache_index, key );
+    g_free ( key );
+    if ( record == NULL ) {
+        return FALSE;
+    }
+    const char  *path = &( data->disk_cache_blob[record->path] );
+    struct stat st;
+    if ( g_stat ( path, &st ) != 0 || record->mtime != (int64_t) st.st_mtim.tv_sec * G_GINT64_CONSTANT ( 1000000000 ) + st.st_mtim.tv_nsec ) {
+        return FALSE;
+    }
+    cairo_surface_t *surface = cairo_image_surface_create_for_data ( data->disk_cache_pixels + record->pixels, record->format,
+                                                                     record->width, record->height, record->stride );
+    if ( cairo_surface_status ( surface ) != CAIRO_STATUS_SUCCESS ) {
+        cairo_surface_destroy ( surface );
+        return FALSE;
+    }
+    sentry->surface         = surface;
+    sentry->path            = g_strdup ( path );
+    sentry->mtime           = record->mtime;
+    sentry->from_disk_cache = TRUE;
+    return TRUE;
+}
+
+/**
+ * Write the icons loaded in this run to the icon cache, followed by the
+ * icons of the old cache that were not used, as long as they fit.
+ */
+static void rofi_icon_fetcher_disk_cache_write ( void )
+{
+    IconFetcher *data = rofi_icon_fetcher_data;
+    if ( cache_dir == NULL || data->disk_cache_key == NULL ) {
+        return;
+    }
+    GPtrArray      *loaded = g_ptr_array_new ();
+    gboolean       dirty   = FALSE;
+    GHashTableIter iter;
+    gpointer       value;
+    g_hash_table_iter_init ( &iter, data->icon_cache_uid );
+    while ( g_hash_table_iter_next ( &iter, NULL, &value ) ) {
+        IconFetcherEntry *sentry = (IconFetcherEntry *) value;
+        if ( sentry->surface == NULL || sentry->path == NULL
+             || !rofi_icon_fetcher_disk_cache_format ( cairo_image_surface_get_format ( sentry->surface ) ) ) {
+            continue;
+        }
+        g_ptr_array_add ( loaded, sentry );
+        dirty |= !sentry->from_disk_cache;
+    }
+    if ( !dirty ) {
+        g_ptr_array_free ( loaded, TRUE );
+        return;
+    }
+    TICK_N ( "Icon cache write: start" );
+
+    GArray  *records = g_array_new ( FALSE, TRUE, sizeof ( IconCacheRecord ) );
+    GString *blob    = g_string_new ( NULL );
+    // Pointers to the pixels of each record.
+    GArray  *pixels  = g_array_new ( FALSE, FALSE, sizeof ( const uint8_t * ) );
+    // Keys written, old records for them are left out.
+    GHashTable *written     = g_hash_table_new_full ( g_str_hash, g_str_equal, g_free, NULL );
+    uint64_t   pixels_size  = 0;
+    uint32_t   config_key   = blob->len;
+    g_string_append_len ( blob, data->disk_cache_key, strlen ( data->disk_cache_key ) + 1 );
+
+    for ( guint index = 0; index < loaded->len; index++ ) {
+        IconFetcherEntry *sentry = g_ptr_array_index ( loaded, index );
+        cairo_surface_flush ( sentry->surface );
+        IconCacheRecord  record  = {
+            .size   = sentry->size,
+            .format = cairo_image_surface_get_format ( sentry->surface ),
+            .width  = cairo_image_surface_get_width ( sentry->surface ),
+            .height = cairo_image_surface_get_height ( sentry->surface ),
+            .stride = cairo_image_surface_get_stride ( sentry->surface ),
+            .mtime  = sentry->mtime,
+            .pixels = pixels_size,
+        };
+        if ( pixels_size + (uint64_t) record.stride * record.height > ICON_CACHE_MAX_SIZE ) {
+            continue;
+        }
+        record.name = blob->len;
+        g_string_append_len ( blob, sentry->name, strlen ( sentry->name ) + 1 );
+        record.path = blob->len;
+        g_string_append_len ( blob, sentry->path, strlen ( sentry->path ) + 1 );
+        const uint8_t *p = cairo_image_surface_get_data ( sentry->surface );
+        g_array_append_val ( records, record );
+        g_array_append_val ( pixels, p );
+        pixels_size += ( (uint64_t) record.stride * record.height + ICON_CACHE_ALIGN - 1 ) & ~( (uint64_t) ICON_CACHE_ALIGN - 1 );
+        g_hash_table_add ( written, rofi_icon_fetcher_disk_cache_key ( sentry->name, sentry->size ) );
+    }
+    if ( data->disk_cache_index != NULL ) {
+        g_hash_table_iter_init ( &iter, data->disk_cache_index );
+        gpointer key;
+        while ( g_hash_table_iter_next ( &iter, &key, &value ) ) {
+            const IconCacheRecord *old = (const IconCacheRecord *) value;
+            if ( g_hash_table_contains ( written, key ) ) {
+                continue;
+            }
+            if ( pixels_size + (uint64_t) old->stride * old->height > ICON_CACHE_MAX_SIZE ) {
+                continue;
+            }
+            IconCacheRecord record = *old;
+            record.pixels = pixels_size;
+            record.name   = blob->len;
+            g_string_append_len ( blob, &( data->disk_cache_blob[old->name] ), strlen ( &( data->disk_cache_blob[old->name] ) ) + 1 );
+            record.path = blob->len;
+            g_string_append_len ( blob, &( data->disk_cache_blob[old->path] ), strlen ( &( data->disk_cache_blob[old->path] ) ) + 1 );
+            const uint8_t *p = data->disk_cache_pixels + old->pixels;
+            g_array_append_val ( records, record );
+            g_array_append_val ( pixels, p );
+            pixels_size += ( (uint64_t) record.stride * record.height + ICON_CACHE_ALIGN - 1 ) & ~( (uint64_t) ICON_CACHE_ALIGN - 1 );
+        }
+    }
+
+    IconCacheHeader header = {
+        .version     = ICON_CACHE_VERSION,
+        .num_records = records->len,
+        .blob_size   = blob->len,
+        .config_key  = config_key,
+        .pixels_size = pixels_size,
+    };
+    memcpy ( header.magic, ICON_CACHE_MAGIC, sizeof ( header.magic ) );
+
+    // Write to a new, uniquely named file. Other instances might have the old one mapped,
+    // or be writing their own.
+    char *path     = g_build_filename ( cache_dir, ICON_CACHE_FILE, NULL );
+    char *tmp_file = g_strconcat ( path, ".XXXXXX", NULL );
+    int  tmp_fd    = g_mkstemp ( tmp_file );
+    FILE *fd       = ( tmp_fd >= 0 ) ? fdopen ( tmp_fd, "w" ) : NULL;
+    if ( fd == NULL ) {
+        g_warning ( "Failed to write icon cache: %s", g_strerror ( errno ) );
+        if ( tmp_fd >= 0 ) {
+            close ( tmp_fd );
+            g_unlink ( tmp_file );
+        }
+    }
+    else {
+        static const uint8_t zero[ICON_CACHE_ALIGN] = { 0 };
+        size_t               offset                 = sizeof ( header ) + records->len * sizeof ( IconCacheRecord ) + blob->len;
+        gboolean             ok                     = fwrite ( &header, sizeof ( header ), 1, fd ) == 1;
+        ok = ok && fwrite ( records->data, sizeof ( IconCacheRecord ), records->len, fd ) == records->len;
+        ok = ok && fwrite ( blob->str, 1, blob->len, fd ) == blob->len;
+        ok = ok && fwrite ( zero, 1, ( ICON_CACHE_ALIGN - offset % ICON_CACHE_ALIGN ) % ICON_CACHE_ALIGN, fd ) == ( ICON_CACHE_ALIGN - offset % ICON_CACHE_ALIGN ) % ICON_CACHE_ALIGN;
+        for ( guint index = 0; ok && index < records->len; index++ ) {
+            const IconCacheRecord *record = &g_array_index ( records, IconCacheRecord, index );
+            size_t                length  = (size_t) record->stride * record->height;
+            ok = fwrite ( g_array_index ( pixels, const uint8_t *, index ), 1, length, fd ) == length;
+            ok = ok && fwrite ( zero, 1, ( ICON_CACHE_ALIGN - length % ICON_CACHE_ALIGN ) % ICON_CACHE_ALIGN, fd ) == ( ICON_CACHE_ALIGN - length % ICON_CACHE_ALIGN ) % ICON_CACHE_ALIGN;
+        }
+        if ( fclose ( fd ) != 0 || !ok || g_rename ( tmp_file, path ) != 0 ) {
+            g_warning ( "Failed to write icon cache: %s", g_strerror ( errno ) );
+            g_unlink ( tmp_file );
+        }
+    }
+    g_free ( tmp_file );
+    g_free ( path );
+    g_hash_table_destroy ( written );
+    g_array_free ( pixels, TRUE );
+    g_string_free ( blob, TRUE );
+    g_array_free ( records, TRUE );
+    g_ptr_array_free ( loaded, TRUE );
+    TICK_N ( "Icon cache write: done" );
+}
+
+/**
+ * Directory and modification time, see #IconThemeIndexStamp.
+ */
+typedef struct
+{
+    char    *path;
+    int64_t mtime;
+} IconThemeStamp;
+
+static void rofi_icon_fetcher_theme_stamp ( GArray *stamps, char *path )
+{
+    struct stat    st;
+    IconThemeStamp stamp = { .path = path, .mtime = -1 };
+    if ( g_stat ( path, &st ) == 0 ) {
+        stamp.mtime = (int64_t) st.st_mtim.tv_sec * G_GINT64_CONSTANT ( 1000000000 ) + st.st_mtim.tv_nsec;
+    }
+    g_array_append_val ( stamps, stamp );
+}
+
+/**
+ * @param stamps The stamps to add to.
+ * @param theme The theme directory.
+ * @param inherits [out] Set to the themes it inherits from, if it is still NULL.
+ *
+ * Stamp the index.theme of the theme and the per-size directories it lists, icons are
+ * added to those, often without the theme directory itself changing.
+ */
+static void rofi_icon_fetcher_theme_stamp_dirs ( GArray *stamps, const char *theme, gchar ***inherits )
+{
+    static const char *const keys[]     = { "Directories", "ScaledDirectories" };
+    char                     *index_file = g_build_filename ( theme, "index.theme", NULL );
+    GKeyFile                 *kf         = g_key_file_new ();
+    // The icon theme spec separates lists with commas.
+    g_key_file_set_list_separator ( kf, ',' );
+    gboolean                 loaded = g_key_file_load_from_file ( kf, index_file, G_KEY_FILE_NONE, NULL );
+    rofi_icon_fetcher_theme_stamp ( stamps, index_file );
+    for ( size_t k = 0; loaded && k < G_N_ELEMENTS ( keys ); k++ ) {
+        gchar **dirs = g_key_file_get_string_list ( kf, "Icon Theme", keys[k], NULL, NULL );
+        for ( size_t i = 0; dirs != NULL && dirs[i] != NULL; i++ ) {
+            rofi_icon_fetcher_theme_stamp ( stamps, g_build_filename ( theme, dirs[i], NULL ) );
+        }
+        g_strfreev ( dirs );
+    }
+    if ( loaded && *inherits == NULL ) {
+        *inherits = g_key_file_get_string_list ( kf, "Icon Theme", "Inherits", NULL, NULL );
+    }
+    g_key_file_free ( kf );
+}
+
+/**
+ * @param chain The theme names.
+ * @param name The theme to add.
+ *
+ * Add name to chain, if it is not in it yet.
+ */
+static void rofi_icon_fetcher_theme_chain_add ( GPtrArray *chain, const char *name )
+{
+    if ( name == NULL || name[0] == '\0' ) {
+        return;
+    }
+    for ( guint i = 0; i < chain->len; i++ ) {
+        if ( g_strcmp0 ( g_ptr_array_index ( chain, i ), name ) == 0 ) {
+            return;
+        }
+    }
+    g_ptr_array_add ( chain, g_strdup ( name ) );
+}
+
+/**
+ * Stamp the directories of the themes icons are looked up in: the configured theme, the themes it
+ * inherits from and the fallbacks, in every icon directory, and the pixmaps directory.
+ * Installing, removing or updating one of those themes or adding an icon to it changes one of these.
+ *
+ * @returns a new array of #IconThemeStamp.
+ */
+static GArray *rofi_icon_fetcher_theme_stamps ( void )
+{
+    GArray            *stamps = g_array_new ( FALSE, FALSE, sizeof ( IconThemeStamp ) );
+    GPtrArray         *bases  = g_ptr_array_new_with_free_func ( g_free );
+    GPtrArray         *chain  = g_ptr_array_new_with_free_func ( g_free );
+    const char *const *sys    = g_get_system_data_dirs ();
+    g_ptr_array_add ( bases, g_build_filename ( g_get_user_data_dir (), "icons", NULL ) );
+    g_ptr_array_add ( bases, g_build_filename ( g_get_home_dir (), ".icons", NULL ) );
+    for ( size_t i = 0; sys[i] != NULL; i++ ) {
+        g_ptr_array_add ( bases, g_build_filename ( sys[i], "icons", NULL ) );
+    }
+
+    rofi_icon_fetcher_theme_chain_add ( chain, config.icon_theme );
+    for ( size_t i = 0; icon_fallback_themes[i] != NULL; i++ ) {
+        rofi_icon_fetcher_theme_chain_add ( chain, icon_fallback_themes[i] );
+    }
+    rofi_icon_fetcher_theme_chain_add ( chain, "hicolor" );
+    // The chain grows with the inherited themes while it is walked.
+    for ( guint t = 0; t < chain->len; t++ ) {
+        gchar **inherits = NULL;
+        for ( guint i = 0; i < bases->len; i++ ) {
+            // Stamped when missing too, so installing the theme is noticed.
+            char *path = g_build_filename ( g_ptr_array_index ( bases, i ), g_ptr_array_index ( chain, t ), NULL );
+            rofi_icon_fetcher_theme_stamp ( stamps, path );
+            if ( g_file_test ( path, G_FILE_TEST_IS_DIR ) ) {
+                rofi_icon_fetcher_theme_stamp_dirs ( stamps, path, &inherits );
+            }
+        }
+        for ( size_t i = 0; inherits != NULL && inherits[i] != NULL; i++ ) {
+            rofi_icon_fetcher_theme_chain_add ( chain, inherits[i] );
+        }
+        g_strfreev ( inherits );
+    }
+    rofi_icon_fetcher_theme_stamp ( stamps, g_strdup ( "/usr/share/pixmaps" ) );
+    g_ptr_array_free ( chain, TRUE );
+    g_ptr_array_free ( bases, TRUE );
+    return stamps;
+}
+
+/**
+ * Load the icon theme index, if it was made for the current theme and none of the theme directories changed.
+ * Called once, from the worker doing the first lookup.
+ */
+static void rofi_icon_fetcher_theme_index_load ( void )
+{
+    IconFetcher *data = rofi_icon_fetcher_data;
+    data->theme_stamps = rofi_icon_fetcher_theme_stamps ();
+    if ( cache_dir == NULL ) {
+        return;
+    }
+    char  *path     = g_build_filename ( cache_dir, ICON_THEME_INDEX_FILE, NULL );
+    gchar *contents = NULL;
+    gsize length    = 0;
+    if ( !g_file_get_contents ( path, &contents, &length, NULL ) ) {
+        g_free ( path );
+        return;
+    }
+    g_free ( path );
+    const IconThemeIndexHeader *header  = (const IconThemeIndexHeader *) contents;
+    const IconThemeIndexStamp  *stamps  = (const IconThemeIndexStamp *) ( header + 1 );
+    const IconThemeIndexRecord *records = NULL;
+    const char                 *blob    = NULL;
+    gboolean                   valid    = length >= sizeof ( IconThemeIndexHeader )
+                                          && memcmp ( header->magic, ICON_THEME_INDEX_MAGIC, sizeof ( header->magic ) ) == 0
+                                          && header->version == ICON_THEME_INDEX_VERSION
+                                          && sizeof ( IconThemeIndexHeader ) + (uint64_t) header->num_stamps * sizeof ( IconThemeIndexStamp )
+                                          + (uint64_t) header->num_records * sizeof ( IconThemeIndexRecord ) + header->blob_size == length
+                                          && header->blob_size > 0 && header->num_stamps == data->theme_stamps->len;
+    if ( valid ) {
+        records = (const IconThemeIndexRecord *) ( stamps + header->num_stamps );
+        blob    = (const char *) ( records + header->num_records );
+        valid   = blob[header->blob_size - 1] == '\0' && header->theme < header->blob_size
+                  && g_strcmp0 ( &( blob[header->theme] ), config.icon_theme ? config.icon_theme : "" ) == 0;
+    }
+    for ( uint32_t i = 0; valid && i < header->num_stamps; i++ ) {
+        const IconThemeStamp *stamp = &g_array_index ( data->theme_stamps, IconThemeStamp, i );
+        valid = stamps[i].path < header->blob_size && stamps[i].mtime == stamp->mtime
+                && g_strcmp0 ( &( blob[stamps[i].path] ), stamp->path ) == 0;
+    }
+    if ( !valid ) {
+        g_debug ( "Icon theme index is outdated or corrupt, ignoring." );
+        g_free ( contents );
+        return;
+    }
+    for ( uint32_t i = 0; i < header->num_records; i++ ) {
+        const IconThemeIndexRecord *record = &( records[i] );
+        if ( record->name >= header->blob_size || ( record->path != UINT32_MAX && record->path >= header->blob_size ) ) {
+            continue;
+        }
+        g_hash_table_insert ( data->theme_index,
+                              rofi_icon_fetcher_disk_cache_key ( &( blob[record->name] ), record->size ),
+                              g_strdup ( record->path == UINT32_MAX ? "" : &( blob[record->path] ) ) );
+    }
+    g_debug ( "Icon theme index has %u lookups.", g_hash_table_size ( data->theme_index ) );
+    g_free ( contents );
+}
+
+/**
+ * Write the icon theme index, if lookups were added.
+ */
+static void rofi_icon_fetcher_theme_index_write ( void )
+{
+    IconFetcher *data = rofi_icon_fetcher_data;
+    if ( cache_dir == NULL || !data->theme_index_dirty ) {
+        return;
+    }
+    GArray               *stamps  = g_array_new ( FALSE, TRUE, sizeof ( IconThemeIndexStamp ) );
+    GArray               *records = g_array_new ( FALSE, TRUE, sizeof ( IconThemeIndexRecord ) );
+    GString              *blob    = g_string_new ( NULL );
+    IconThemeIndexHeader header   = { .version = ICON_THEME_INDEX_VERSION, .theme = 0 };
+    memcpy ( header.magic, ICON_THEME_INDEX_MAGIC, sizeof ( header.magic ) );
+    const char *theme = config.icon_theme ? config.icon_theme : "";
+    g_string_append_len ( blob, theme, strlen ( theme ) + 1 );
+    for ( guint i = 0; i < data->theme_stamps->len; i++ ) {
+        const IconThemeStamp *stamp = &g_array_index ( data->theme_stamps, IconThemeStamp, i );
+        IconThemeIndexStamp  istamp = { .path = blob->len, .mtime = stamp->mtime };
+        g_string_append_len ( blob, stamp->path, strlen ( stamp->path ) + 1 );
+        g_array_append_val ( stamps, istamp );
+    }
+    GHashTableIter iter;
+    gpointer       key, value;
+    g_hash_table_iter_init ( &iter, data->theme_index );
+    while ( g_hash_table_iter_next ( &iter, &key, &value ) ) {
+        // Split "size:name".
+        char                 *name   = strchr ( (char *) key, ':' ) + 1;
+        IconThemeIndexRecord record  = {
+            .name = blob->len,
+            .size = (int32_t) g_ascii_strtoll ( (char *) key, NULL, 10 ),
+            .path = UINT32_MAX,
+        };
+        g_string_append_len ( blob, name, strlen ( name ) + 1 );
+        if ( ( (char *) value )[0] != '\0' ) {
+            record.path = blob->len;
+            g_string_append_len ( blob, (char *) value, strlen ( (char *) value ) + 1 );
+        }
+        g_array_append_val ( records, record );
+    }
+    header.num_stamps  = stamps->len;
+    header.num_records = records->len;
+    header.blob_size   = blob->len;
+
+    // Other instances might be writing their own index, so use a unique name.
+    char *path     = g_build_filename ( cache_dir, ICON_THEME_INDEX_FILE, NULL );
+    char *tmp_file = g_strconcat ( path, ".XXXXXX", NULL );
+    int  tmp_fd    = g_mkstemp ( tmp_file );
+    FILE *fd       = ( tmp_fd >= 0 ) ? fdopen ( tmp_fd, "w" ) : NULL;
+    if ( fd == NULL ) {
+        g_warning ( "Failed to write icon theme index: %s", g_strerror ( errno ) );
+        if ( tmp_fd >= 0 ) {
+            close ( tmp_fd );
+            g_unlink ( tmp_file );
+        }
+    }
+    else {
+        gboolean ok = fwrite ( &header, sizeof ( header ), 1, fd ) == 1;
+        ok = ok && fwrite ( stamps->data, sizeof ( IconThemeIndexStamp ), stamps->len, fd ) == stamps->len;
+        ok = ok && fwrite ( records->data, sizeof ( IconThemeIndexRecord ), records->len, fd ) == records->len;
+        ok = ok && fwrite ( blob->str, 1, blob->len, fd ) == blob->len;
+        if ( fclose ( fd ) != 0 || !ok || g_rename ( tmp_file, path ) != 0 ) {
+            g_warning ( "Failed to write icon theme index: %s", g_strerror ( errno ) );
+            g_unlink ( tmp_file );
+        }
+    }
+    g_free ( tmp_file );
+    g_free ( path );
+    g_string_free ( blob, TRUE );
+    g_array_free ( records, TRUE );
+    g_array_free ( stamps, TRUE );
+}
+
+/**
+ * @param name The icon name.
+ * @param size The requested size.
+ *
+ * Find the icon in the icon theme, through the index if it was looked up before.
+ * Called from the workers.
+ *
+ * @returns the file of the icon, NULL if the theme does not have it.
+ */
+static char *rofi_icon_fetcher_theme_lookup ( const char *name, int size )
+{
+    IconFetcher *data  = rofi_icon_fetcher_data;
+    // Stamping the themes touches the disk, so it is done here and not at startup.
+    // Other workers wait for it, the main thread does not use the index.
+    if ( g_once_init_enter ( &( data->theme_index_loaded ) ) ) {
+        rofi_icon_fetcher_theme_index_load ();
+        g_once_init_leave ( &( data->theme_index_loaded ), 1 );
+    }
+    char        *key   = rofi_icon_fetcher_disk_cache_key ( name, size );
+    char        *path  = NULL;
+    gboolean    found  = FALSE;
+    g_mutex_lock ( &( data->queue_lock ) );
+    const char  *value = g_hash_table_lookup ( data->theme_index, key );
+    if ( value != NULL ) {
+        found = TRUE;
+        path  = value[0] != '\0' ? g_strdup ( value ) : NULL;
+    }
+    g_mutex_unlock ( &( data->queue_lock ) );
+    if ( found ) {
+        g_free ( key );
+        return path;
+    }
+
+    // Only walk the themes once something is not in the index.
+    if ( g_once_init_enter ( &( data->theme_preloaded ) ) ) {
+        const char *themes[2] = { config.icon_theme, NULL };
+        nk_xdg_theme_preload_themes_icon ( data->xdg_context, themes );
+        g_once_init_leave ( &( data->theme_preloaded ), 1 );
+    }
+    const gchar *themes[] = {
+        config.icon_theme,
         NULL
     };
-    const char                 *themes[2] = { config.icon_theme, NULL };
+    path = nk_xdg_theme_get_icon ( data->xdg_context, themes, NULL, name, size, 1, TRUE );
+
+    g_mutex_lock ( &( data->queue_lock ) );
+    if ( g_hash_table_size ( data->theme_index ) < ICON_THEME_INDEX_MAX_RECORDS ) {
+        g_hash_table_insert ( data->theme_index, key, g_strdup ( path ? path : "" ) );
+        data->theme_index_dirty = TRUE;
+    }
+    else {
+        g_free ( key );
+    }
+    g_mutex_unlock ( &( data->queue_lock ) );
+    return path;
+}
+
+void rofi_icon_fetcher_init ( void )
+{
+    g_assert ( rofi_icon_fetcher_data == NULL );
 
     rofi_icon_fetcher_data = g_malloc0 ( sizeof ( IconFetcher ) );
 
     rofi_icon_fetcher_data->xdg_context = nk_xdg_theme_context_new ( icon_fallback_themes, NULL );
-    nk_xdg_theme_preload_themes_icon ( rofi_icon_fetcher_data->xdg_context, themes );
+    // The index is loaded, and the themes are preloaded, by the first lookup.
+    rofi_icon_fetcher_data->theme_index = g_hash_table_new_full ( g_str_hash, g_str_equal, g_free, g_free );
 
     rofi_icon_fetcher_data->icon_cache_uid = g_hash_table_new ( g_direct_hash, g_direct_equal );
-    rofi_icon_fetcher_data->icon_cache     = g_hash_table_new_full ( g_str_hash, g_str_equal, NULL, rofi_icon_fetch_entry_free );
+    rofi_icon_fetcher_data->icon_cache     = g_hash_table_new_full ( rofi_icon_fetcher_entry_hash, rofi_icon_fetcher_entry_equal, NULL, rofi_icon_fetch_entry_free );
+    g_queue_init ( &( rofi_icon_fetcher_data->lru ) );
+
+    g_mutex_init ( &( rofi_icon_fetcher_data->queue_lock ) );
+    rofi_icon_fetcher_data->queue = g_sequence_new ( NULL );
 }
 
 void rofi_icon_fetcher_destroy ( void )
@@ -124,36 +929,89 @@ void rofi_icon_fetcher_destroy ( void )
 
     nk_xdg_theme_context_free ( rofi_icon_fetcher_data->xdg_context );
 
+    // The workers are stopped by now.
+    rofi_icon_fetcher_disk_cache_write ();
+    rofi_icon_fetcher_theme_index_write ();
+    g_hash_table_destroy ( rofi_icon_fetcher_data->theme_index );
+    if ( rofi_icon_fetcher_data->theme_stamps != NULL ) {
+        for ( guint i = 0; i < rofi_icon_fetcher_data->theme_stamps->len; i++ ) {
+            g_free ( g_array_index ( rofi_icon_fetcher_data->theme_stamps, IconThemeStamp, i ).path );
+        }
+        g_array_free ( rofi_icon_fetcher_data->theme_stamps, TRUE );
+    }
+
+    if ( rofi_icon_fetcher_data->ready_source > 0 ) {
+        g_source_remove ( rofi_icon_fetcher_data->ready_source );
+    }
+    g_sequence_free ( rofi_icon_fetcher_data->queue );
+    g_mutex_clear ( &( rofi_icon_fetcher_data->queue_lock ) );
+
     g_hash_table_unref ( rofi_icon_fetcher_data->icon_cache_uid );
     g_hash_table_unref ( rofi_icon_fetcher_data->icon_cache );
 
+    // Surfaces from the icon cache point into the mapping.
+    if ( rofi_icon_fetcher_data->disk_cache_index != NULL ) {
+        g_hash_table_destroy ( rofi_icon_fetcher_data->disk_cache_index );
+    }
+    if ( rofi_icon_fetcher_data->disk_cache != NULL ) {
+        munmap ( rofi_icon_fetcher_data->disk_cache, rofi_icon_fetcher_data->disk_cache_size );
+    }
+    g_free ( rofi_icon_fetcher_data->disk_cache_key );
+
     g_free ( rofi_icon_fetcher_data );
 }
-static void rofi_icon_fetcher_worker ( thread_state *sdata, G_GNUC_UNUSED gpointer user_data )
+/**
+ * @param surface The decoded icon, consumed.
+ * @param size The requested size.
+ *
+ * Shrink icons larger than the requested size, so they are resampled once
+ * here instead of on every draw and only the small copy is kept.
+ *
+ * @returns the icon fitting the requested size.
+ */
+static cairo_surface_t *rofi_icon_fetcher_scale ( cairo_surface_t *surface, int size )
 {
-    g_debug ( "starting up icon fetching thread." );
-    // as long as dr->icon is updated atomicly.. (is a pointer write atomic?)
-    // this should be fine running in another thread.
-    IconFetcherEntry *sentry   = (IconFetcherEntry *) sdata;
-    const gchar      *themes[] = {
-        config.icon_theme,
-        NULL
-    };
+    int width  = cairo_image_surface_get_width ( surface );
+    int height = cairo_image_surface_get_height ( surface );
+    int max    = MAX ( width, height );
+    if ( size <= 0 || max <= size ) {
+        return surface;
+    }
+    double          scale   = (double) size / max;
+    int             swidth  = MAX ( 1, (int) ( width * scale + 0.5 ) );
+    int             sheight = MAX ( 1, (int) ( height * scale + 0.5 ) );
+    cairo_surface_t *scaled = cairo_image_surface_create ( CAIRO_FORMAT_ARGB32, swidth, sheight );
+    if ( cairo_surface_status ( scaled ) != CAIRO_STATUS_SUCCESS ) {
+        cairo_surface_destroy ( scaled );
+        return surface;
+    }
+    cairo_t *d = cairo_create ( scaled );
+    cairo_scale ( d, (double) swidth / width, (double) sheight / height );
+    cairo_set_source_surface ( d, surface, 0, 0 );
+    // The default filter skips source pixels when shrinking a lot, this one averages them.
+    cairo_pattern_set_filter ( cairo_get_source ( d ), CAIRO_FILTER_BEST );
+    cairo_paint ( d );
+    cairo_destroy ( d );
+    cairo_surface_destroy ( surface );
+    return scaled;
+}
 
+static void rofi_icon_fetcher_load ( IconFetcherEntry *sentry )
+{
     const gchar      *icon_path;
     gchar            *icon_path_ = NULL;
 
-    if ( g_path_is_absolute ( sentry->entry->name ) ) {
-        icon_path = sentry->entry->name;
+    if ( g_path_is_absolute ( sentry->name ) ) {
+        icon_path = sentry->name;
     }
     else {
-        icon_path = icon_path_ = nk_xdg_theme_get_icon ( rofi_icon_fetcher_data->xdg_context, themes, NULL, sentry->entry->name, sentry->size, 1, TRUE );
+        icon_path = icon_path_ = rofi_icon_fetcher_theme_lookup ( sentry->name, sentry->size );
         if ( icon_path_ == NULL ) {
-            g_debug ( "failed to get icon %s(%d): n/a", sentry->entry->name, sentry->size  );
+            g_debug ( "failed to get icon %s(%d): n/a", sentry->name, sentry->size  );
             return;
         }
         else{
-            g_debug ( "found icon %s(%d): %s", sentry->entry->name, sentry->size, icon_path  );
+            g_debug ( "found icon %s(%d): %s", sentry->name, sentry->size, icon_path  );
         }
     }
     cairo_surface_t *icon_surf = NULL;
@@ -169,46 +1027,152 @@ static void rofi_icon_fetcher_worker ( thread_state *sdata, G_GNUC_UNUSED gpoint
     if ( icon_surf ) {
         // check if surface is valid.
         if ( cairo_surface_status ( icon_surf ) != CAIRO_STATUS_SUCCESS ) {
-            g_debug ( "icon failed to open: %s(%d): %s", sentry->entry->name, sentry->size, icon_path );
+            g_debug ( "icon failed to open: %s(%d): %s", sentry->name, sentry->size, icon_path );
             cairo_surface_destroy ( icon_surf );
             icon_surf = NULL;
         }
+        else {
+            icon_surf = rofi_icon_fetcher_scale ( icon_surf, sentry->size );
+            // Remember where it came from for the icon cache, stat after loading so a change while loading is caught next time.
+            struct stat st;
+            if ( g_stat ( icon_path, &st ) == 0 ) {
+                sentry->mtime = (int64_t) st.st_mtim.tv_sec * G_GINT64_CONSTANT ( 1000000000 ) + st.st_mtim.tv_nsec;
+                sentry->path  = g_strdup ( icon_path );
+            }
+        }
         sentry->surface = icon_surf;
     }
     g_free ( icon_path_ );
-    rofi_view_reload ();
 }
 
-uint32_t rofi_icon_fetcher_query ( const char *name, const int size )
+static gboolean rofi_icon_fetcher_ready_idle ( G_GNUC_UNUSED gpointer user_data )
 {
-    g_debug ( "Query: %s(%d)", name, size );
-    IconFetcherNameEntry *entry = g_hash_table_lookup ( rofi_icon_fetcher_data->icon_cache, name );
-    if ( entry == NULL ) {
-        entry       = g_new0 ( IconFetcherNameEntry, 1 );
-        entry->name = g_strdup ( name );
-        g_hash_table_insert ( rofi_icon_fetcher_data->icon_cache, entry->name, entry );
+    g_mutex_lock ( &( rofi_icon_fetcher_data->queue_lock ) );
+    rofi_icon_fetcher_data->ready_source = 0;
+    g_mutex_unlock ( &( rofi_icon_fetcher_data->queue_lock ) );
+    rofi_view_icons_ready ();
+    return G_SOURCE_REMOVE;
+}
+
+static void rofi_icon_fetcher_worker ( G_GNUC_UNUSED thread_state *sdata, G_GNUC_UNUSED gpointer user_data )
+{
+    g_debug ( "starting up icon fetching thread." );
+    IconFetcher *data = rofi_icon_fetcher_data;
+    g_mutex_lock ( &( data->queue_lock ) );
+    // Cancelled requests leave jobs without a request behind.
+    if ( g_sequence_is_empty ( data->queue ) ) {
+        g_mutex_unlock ( &( data->queue_lock ) );
+        return;
+    }
+    GSequenceIter    *iter   = g_sequence_get_begin_iter ( data->queue );
+    IconFetcherEntry *sentry = g_sequence_get ( iter );
+    g_sequence_remove ( iter );
+    sentry->queue_iter = NULL;
+    sentry->status     = ICON_FETCHER_RUNNING;
+    g_mutex_unlock ( &( data->queue_lock ) );
+
+    rofi_icon_fetcher_load ( sentry );
+
+    g_mutex_lock ( &( data->queue_lock ) );
+    sentry->status = ICON_FETCHER_DONE;
+    rofi_icon_fetcher_lru_add ( sentry );
+    // Only redraw for icons requested by a visible row, prefetched and off-screen ones are drawn once scrolled to.
+    gboolean visible = ( sentry->priority & 1 ) && sentry->priority / 2 + 1 >= data->generation;
+    if ( sentry->surface != NULL && visible && data->ready_source == 0 ) {
+        // Called from a worker thread, let the main loop do the redraw.
+        data->ready_source = g_idle_add ( rofi_icon_fetcher_ready_idle, NULL );
+    }
+    g_mutex_unlock ( &( data->queue_lock ) );
+}
+
+static gint rofi_icon_fetcher_queue_cmp ( gconstpointer a, gconstpointer b, G_GNUC_UNUSED gpointer user_data )
+{
+    const IconFetcherEntry *ea = (const IconFetcherEntry *) a;
+    const IconFetcherEntry *eb = (const IconFetcherEntry *) b;
+    if ( ea->priority != eb->priority ) {
+        return ea->priority > eb->priority ? -1 : 1;
+    }
+    // Oldest request first.
+    return ea->uid < eb->uid ? -1 : ( ea->uid > eb->uid );
+}
+
+/**
+ * @param sentry The requested icon.
+ *
+ * Queue the icon with the current priority, or raise its priority if it is queued.
+ * Must be called from the main thread, with the queue lock held.
+ */
+static void rofi_icon_fetcher_touch ( IconFetcherEntry *sentry )
+{
+    IconFetcher *data    = rofi_icon_fetcher_data;
+    uint64_t    priority = (uint64_t) data->generation * 2 + ( data->prefetch ? 0 : 1 );
+    if ( sentry->status == ICON_FETCHER_IDLE ) {
+        // Decoded icons from earlier runs are ready right away.
+        if ( rofi_icon_fetcher_disk_cache_lookup ( sentry ) ) {
+            sentry->status = ICON_FETCHER_DONE;
+            rofi_icon_fetcher_lru_add ( sentry );
+            return;
+        }
+        sentry->priority   = priority;
+        sentry->queue_iter = g_sequence_insert_sorted ( data->queue, sentry, rofi_icon_fetcher_queue_cmp, NULL );
+        sentry->status     = ICON_FETCHER_QUEUED;
+        g_thread_pool_push ( tpool, &rofi_icon_fetcher_job, NULL );
+    }
+    else if ( sentry->status == ICON_FETCHER_QUEUED && priority > sentry->priority ) {
+        sentry->priority = priority;
+        g_sequence_sort_changed ( sentry->queue_iter, rofi_icon_fetcher_queue_cmp, NULL );
     }
-    IconFetcherEntry *sentry;
-    for ( GList *iter = g_list_first ( entry->sizes ); iter; iter = g_list_next ( iter ) ) {
-        sentry = iter->data;
-        if ( sentry->size == size ) {
-            return sentry->uid;
+}
+
+void rofi_icon_fetcher_visible_changed ( void )
+{
+    IconFetcher *data = rofi_icon_fetcher_data;
+    g_mutex_lock ( &( data->queue_lock ) );
+    data->generation++;
+    // Requests not repeated in the previous generation went off-screen, the
+    // lowest priorities are at the end.
+    while ( !g_sequence_is_empty ( data->queue ) ) {
+        GSequenceIter    *iter   = g_sequence_iter_prev ( g_sequence_get_end_iter ( data->queue ) );
+        IconFetcherEntry *sentry = g_sequence_get ( iter );
+        if ( sentry->priority / 2 + 1 >= data->generation ) {
+            break;
         }
+        g_sequence_remove ( iter );
+        sentry->queue_iter = NULL;
+        sentry->status     = ICON_FETCHER_IDLE;
+    }
+    g_mutex_unlock ( &( data->queue_lock ) );
+}
+
+void rofi_icon_fetcher_set_prefetch ( gboolean prefetch )
+{
+    rofi_icon_fetcher_data->prefetch = prefetch;
+}
+
+uint32_t rofi_icon_fetcher_query ( const char *name, const int size )
+{
+    g_debug ( "Query: %s(%d)", name, size );
+    IconFetcherEntry key     = { .name = (char *) name, .size = size };
+    IconFetcherEntry *sentry = g_hash_table_lookup ( rofi_icon_fetcher_data->icon_cache, &key );
+    if ( sentry != NULL ) {
+        return sentry->uid;
     }
 
     // Not found.
     sentry          = g_new0 ( IconFetcherEntry, 1 );
     sentry->uid     = ++( rofi_icon_fetcher_data->last_uid );
+    sentry->name    = g_strdup ( name );
     sentry->size    = size;
-    sentry->entry   = entry;
     sentry->surface = NULL;
 
-    entry->sizes = g_list_prepend ( entry->sizes, sentry );
+    g_hash_table_add ( rofi_icon_fetcher_data->icon_cache, sentry );
     g_hash_table_insert ( rofi_icon_fetcher_data->icon_cache_uid, GINT_TO_POINTER ( sentry->uid ), sentry );
 
     // Push into fetching queue.
-    sentry->state.callback = rofi_icon_fetcher_worker;
-    g_thread_pool_push ( tpool, sentry, NULL );
+    g_mutex_lock ( &( rofi_icon_fetcher_data->queue_lock ) );
+    rofi_icon_fetcher_touch ( sentry );
+    rofi_icon_fetcher_lru_evict ();
+    g_mutex_unlock ( &( rofi_icon_fetcher_data->queue_lock ) );
 
     return sentry->uid;
 }
@@ -217,7 +1181,22 @@ cairo_surface_t * rofi_icon_fetcher_get  ( const uint32_t uid )
 {
     IconFetcherEntry *sentry = g_hash_table_lookup ( rofi_icon_fetcher_data->icon_cache_uid, GINT_TO_POINTER ( uid ) );
     if ( sentry ) {
-        return sentry->surface;
+        cairo_surface_t *surface = NULL;
+        g_mutex_lock ( &( rofi_icon_fetcher_data->queue_lock ) );
+        if ( sentry->status == ICON_FETCHER_DONE ) {
+            surface = sentry->surface;
+            if ( surface != NULL ) {
+                g_queue_unlink ( &( rofi_icon_fetcher_data->lru ), &( sentry->lru_link ) );
+                g_queue_push_head_link ( &( rofi_icon_fetcher_data->lru ), &( sentry->lru_link ) );
+            }
+        }
+        else {
+            // Still wanted, move it up or queue it again if it was cancelled or evicted.
+            rofi_icon_fetcher_touch ( sentry );
+        }
+        rofi_icon_fetcher_lru_evict ();
+        g_mutex_unlock ( &( rofi_icon_fetcher_data->queue_lock ) );
+        return surface;
     }
     return NULL;
 }
@@ -0,0 +1,303 @@
+/*
+ * rofi
+ *
+ * MIT/X11 License
+ * Copyright © 2013-2020 Qball Cow <qball@gmpclient.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+
+/** The log domain of this string store. */
+#define G_LOG_DOMAIN    "StringStore"
+
+#include <config.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <glib.h>
+#include "rofi-string-store.h"
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS    MAP_ANON
+#endif
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE    0
+#endif
+
+/** Largest reservation tried, row offsets are 32-bit. */
+#define STRING_STORE_MAX_RESERVE    ( (uint64_t) G_MAXUINT32 + 1 )
+/** Smallest reservation tried before giving up. */
+#define STRING_STORE_MIN_RESERVE    ( (size_t) 16 << 20 )
+/** Granularity in which reserved pages are made writable. */
+#define STRING_STORE_COMMIT_SIZE    ( (size_t) 1 << 20 )
+
+/**
+ * Location of a string inside the arena.
+ */
+typedef struct
+{
+    /** Offset from the start of the arena. */
+    uint32_t offset;
+    /** Length in bytes, excluding the terminating NUL. */
+    uint32_t length;
+} RofiStringStoreSpan;
+
+struct _RofiStringStore
+{
+    /** The optional columns kept. */
+    RofiStringStoreFlags flags;
+    /** Start of the reservation. */
+    char                 *arena;
+    /** Size of the reservation. */
+    size_t               reserved;
+    /** Part of the reservation that is writable. */
+    size_t               committed;
+    /** Part of the reservation that is in use. */
+    size_t               used;
+    /** Length of the row being appended, it starts at used. */
+    size_t               pending;
+    /** If appending to the pending row failed. */
+    gboolean             pending_failed;
+    /** The rows. */
+    RofiStringStoreSpan  *rows;
+    /** Case-folded rows, if kept. */
+    RofiStringStoreSpan  *casefold;
+    /** Collation keys, if kept. */
+    RofiStringStoreSpan  *sort_key;
+    /** Number of rows. */
+    uint32_t             length;
+    /** Number of rows allocated. */
+    uint32_t             size;
+};
+
+RofiStringStore *rofi_string_store_new ( RofiStringStoreFlags flags )
+{
+    RofiStringStore *store = g_malloc0 ( sizeof ( RofiStringStore ) );
+    store->flags = flags;
+    return store;
+}
+
+void rofi_string_store_free ( RofiStringStore *store )
+{
+    if ( store == NULL ) {
+        return;
+    }
+    if ( store->arena != NULL ) {
+        munmap ( store->arena, store->reserved );
+    }
+    g_free ( store->rows );
+    g_free ( store->casefold );
+    g_free ( store->sort_key );
+    g_free ( store );
+}
+
+/**
+ * @param store The store.
+ *
+ * Reserve (but do not commit) the address space for the arena. Smaller
+ * reservations are tried when the address space is limited.
+ *
+ * @returns TRUE when successful.
+ */
+static gboolean rofi_string_store_reserve ( RofiStringStore *store )
+{
+    size_t size = (size_t) MIN ( STRING_STORE_MAX_RESERVE, (uint64_t) SIZE_MAX / 2 + 1 );
+    for (; size >= STRING_STORE_MIN_RESERVE; size /= 2 ) {
+        void *arena = mmap ( NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+        if ( arena != MAP_FAILED ) {
+            store->arena    = arena;
+            store->reserved = size;
+            return TRUE;
+        }
+    }
+    g_warning ( "Failed to reserve memory for string store: %s", g_strerror ( errno ) );
+    return FALSE;
+}
+
+/**
+ * @param store  The store.
+ * @param needed The number of bytes of the arena that should be writable.
+ *
+ * @returns TRUE when the first needed bytes of the arena are writable.
+ */
+static gboolean rofi_string_store_commit ( RofiStringStore *store, size_t needed )
+{
+    if ( needed <= store->committed ) {
+        return TRUE;
+    }
+    if ( needed > store->reserved ) {
+        g_warning ( "String store is full (%zu bytes).", store->reserved );
+        return FALSE;
+    }
+    size_t commit = MIN ( ( needed + STRING_STORE_COMMIT_SIZE - 1 ) & ~( STRING_STORE_COMMIT_SIZE - 1 ), store->reserved );
+    if ( mprotect ( store->arena + store->committed, commit - store->committed, PROT_READ | PROT_WRITE ) != 0 ) {
+        g_warning ( "Failed to grow string store: %s", g_strerror ( errno ) );
+        return FALSE;
+    }
+    store->committed = commit;
+    return TRUE;
+}
+
+/**
+ * @param store The store.
+ * @param span  Set to the location of the copy.
+ * @param str   The string to copy, is freed.
+ *
+ * Copy str, NUL terminated, to the end of the arena.
+ *
+ * @returns TRUE when successful.
+ */
+static gboolean rofi_string_store_copy_take ( RofiStringStore *store, RofiStringStoreSpan *span, char *str )
+{
+    size_t   len  = strlen ( str );
+    gboolean retv = len < G_MAXUINT32 && rofi_string_store_commit ( store, store->used + len + 1 );
+    if ( retv ) {
+        span->offset = (uint32_t) store->used;
+        span->length = (uint32_t) len;
+        memcpy ( store->arena + store->used, str, len + 1 );
+        store->used += len + 1;
+    }
+    g_free ( str );
+    return retv;
+}
+
+void rofi_string_store_append_part ( RofiStringStore *store, const char *str, gsize len )
+{
+    g_return_if_fail ( store != NULL );
+    if ( store->pending_failed || len == 0 ) {
+        return;
+    }
+    if ( store->arena == NULL && !rofi_string_store_reserve ( store ) ) {
+        store->pending_failed = TRUE;
+        return;
+    }
+    // Keep room for the terminating NUL.
+    if ( store->pending + len >= G_MAXUINT32 || !rofi_string_store_commit ( store, store->used + store->pending + len + 1 ) ) {
+        store->pending_failed = TRUE;
+        return;
+    }
+    memcpy ( store->arena + store->used + store->pending, str, len );
+    store->pending += len;
+}
+
+uint32_t rofi_string_store_append_end ( RofiStringStore *store )
+{
+    g_return_val_if_fail ( store != NULL, ROFI_STRING_STORE_INVALID );
+    gboolean failed = store->pending_failed || store->length == ROFI_STRING_STORE_INVALID - 1;
+    size_t   len    = store->pending;
+    store->pending        = 0;
+    store->pending_failed = FALSE;
+    if ( failed ) {
+        return ROFI_STRING_STORE_INVALID;
+    }
+    // An empty row still needs its NUL.
+    if ( store->arena == NULL && !rofi_string_store_reserve ( store ) ) {
+        return ROFI_STRING_STORE_INVALID;
+    }
+    if ( !rofi_string_store_commit ( store, store->used + len + 1 ) ) {
+        return ROFI_STRING_STORE_INVALID;
+    }
+    if ( store->length == store->size ) {
+        store->size = MAX ( 64, MIN ( store->size, G_MAXUINT32 / 4 ) * 2 );
+        store->rows = g_realloc ( store->rows, store->size * sizeof ( RofiStringStoreSpan ) );
+        if ( store->flags & ROFI_STRING_STORE_CASEFOLD ) {
+            store->casefold = g_realloc ( store->casefold, store->size * sizeof ( RofiStringStoreSpan ) );
+        }
+        if ( store->flags & ROFI_STRING_STORE_SORT_KEY ) {
+            store->sort_key = g_realloc ( store->sort_key, store->size * sizeof ( RofiStringStoreSpan ) );
+        }
+    }
+    uint32_t   index = store->length;
+    size_t     used  = store->used;
+    const char *row  = store->arena + used;
+    store->rows[index].offset       = (uint32_t) used;
+    store->rows[index].length       = (uint32_t) len;
+    store->arena[store->used + len] = '\0';
+    store->used                    += len + 1;
+
+    // The columns are stored behind the row, so pop() drops them with it.
+    gboolean ok = TRUE;
+    if ( store->flags & ROFI_STRING_STORE_CASEFOLD ) {
+        ok = rofi_string_store_copy_take ( store, &( store->casefold[index] ), g_utf8_casefold ( row, len ) );
+    }
+    if ( ok && ( store->flags & ROFI_STRING_STORE_SORT_KEY ) ) {
+        ok = rofi_string_store_copy_take ( store, &( store->sort_key[index] ), g_utf8_collate_key ( row, len ) );
+    }
+    if ( !ok ) {
+        // Drop the partially added row.
+        store->used = used;
+        return ROFI_STRING_STORE_INVALID;
+    }
+    store->length++;
+    return index;
+}
+
+uint32_t rofi_string_store_append ( RofiStringStore *store, const char *str, gssize len )
+{
+    g_return_val_if_fail ( store != NULL, ROFI_STRING_STORE_INVALID );
+    g_return_val_if_fail ( str != NULL, ROFI_STRING_STORE_INVALID );
+
+    if ( len < 0 ) {
+        len = strlen ( str );
+    }
+    rofi_string_store_append_part ( store, str, len );
+    return rofi_string_store_append_end ( store );
+}
+
+void rofi_string_store_pop ( RofiStringStore *store )
+{
+    g_return_if_fail ( store != NULL && store->length > 0 );
+    store->length--;
+    store->used = store->rows[store->length].offset;
+}
+
+uint32_t rofi_string_store_get_length ( const RofiStringStore *store )
+{
+    return store->length;
+}
+
+const char *rofi_string_store_get ( const RofiStringStore *store, uint32_t index )
+{
+    return store->arena + store->rows[index].offset;
+}
+
+uint32_t rofi_string_store_get_size ( const RofiStringStore *store, uint32_t index )
+{
+    return store->rows[index].length;
+}
+
+const char *rofi_string_store_get_casefold ( const RofiStringStore *store, uint32_t index )
+{
+    if ( store->casefold == NULL ) {
+        return NULL;
+    }
+    return store->arena + store->casefold[index].offset;
+}
+
+const char *rofi_string_store_get_sort_key ( const RofiStringStore *store, uint32_t index )
+{
+    if ( store->sort_key == NULL ) {
+        return NULL;
+    }
+    return store->arena + store->sort_key[index].offset;
+}
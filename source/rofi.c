@@ -839,7 +839,9 @@ int main ( int argc, char *argv[] )
     bindings = nk_bindings_new ( 0 );
     TICK_N ( "NK Bindings" );
 
-    if ( !display_setup ( main_loop, bindings ) ) {
+    // dmenu -dump only filters, it does not need a display.
+    gboolean headless = dmenu_mode && find_arg ( "-dump" ) >= 0;
+    if ( !headless && !display_setup ( main_loop, bindings ) ) {
         g_warning ( "Connection has error" );
         cleanup ();
         return EXIT_FAILURE;
@@ -867,7 +869,9 @@ int main ( int argc, char *argv[] )
         }
         g_free ( etc );
         // Load in config from X resources.
-        config_parse_xresource_options ( xcb );
+        if ( !headless ) {
+            config_parse_xresource_options ( xcb );
+        }
         if ( config_path_new && g_file_test ( config_path_new, G_FILE_TEST_IS_REGULAR ) ) {
             if ( rofi_theme_parse_file ( config_path_new ) ) {
                 rofi_theme_free ( rofi_theme );
@@ -1039,6 +1043,22 @@ int main ( int argc, char *argv[] )
         return EXIT_SUCCESS;
     }
 
+    if ( headless ) {
+        rofi_view_workers_initialize ();
+        if ( config_sanity_check_filter () ) {
+            for ( GList *iter = g_list_first ( list_of_error_msgs );
+                  iter != NULL; iter = g_list_next ( iter ) ) {
+                g_warning ( "Error: %s%s%s",
+                            color_bold, ( (GString *) iter->data )->str, color_reset );
+            }
+            cleanup ();
+            return EX_DATAERR;
+        }
+        dmenu_dump ();
+        cleanup ();
+        return return_code;
+    }
+
     unsigned int interval = 1;
     if ( find_arg_uint ( "-record-screenshots", &interval ) ) {
         g_timeout_add ( 1000 / (double) interval, record, NULL );
@@ -112,6 +112,8 @@ struct
     workarea           mon;
     /** timeout for reloading */
     guint              idle_timeout;
+    /** Pending reload needs to reload all rows, not only appended ones. */
+    gboolean           idle_reload_rows;
     /** debug counter for redraws */
     unsigned long long count;
     /** redraw idle time. */
@@ -119,17 +121,18 @@ struct
     /** Window fullscreen */
     gboolean           fullscreen;
 } CacheState = {
-    .main_window    = XCB_WINDOW_NONE,
-    .fake_bg        = NULL,
-    .edit_surf      = NULL,
-    .edit_draw      = NULL,
-    .fake_bgrel     = FALSE,
-    .flags          = MENU_NORMAL,
-    .views          = G_QUEUE_INIT,
-    .idle_timeout   = 0,
-    .count          = 0L,
-    .repaint_source = 0,
-    .fullscreen     = FALSE,
+    .main_window      = XCB_WINDOW_NONE,
+    .fake_bg          = NULL,
+    .edit_surf        = NULL,
+    .edit_draw        = NULL,
+    .fake_bgrel       = FALSE,
+    .flags            = MENU_NORMAL,
+    .views            = G_QUEUE_INIT,
+    .idle_timeout     = 0,
+    .idle_reload_rows = FALSE,
+    .count            = 0L,
+    .repaint_source   = 0,
+    .fullscreen       = FALSE,
 };
 
 void rofi_view_get_current_monitor ( int *width, int *height )
@@ -414,17 +417,50 @@ static void rofi_view_reload_message_bar ( RofiViewState *state )
 static gboolean rofi_view_reload_idle ( G_GNUC_UNUSED gpointer data )
 {
     if ( current_active_menu ) {
-        current_active_menu->reload   = TRUE;
-        current_active_menu->refilter = TRUE;
+        if ( CacheState.idle_reload_rows ) {
+            current_active_menu->reload   = TRUE;
+            current_active_menu->refilter = TRUE;
+        }
+        else {
+            current_active_menu->append = TRUE;
+        }
         rofi_view_queue_redraw ();
     }
-    CacheState.idle_timeout = 0;
+    CacheState.idle_timeout     = 0;
+    CacheState.idle_reload_rows = FALSE;
     return G_SOURCE_REMOVE;
 }
 
 void rofi_view_reload ( void  )
 {
     // @TODO add check if current view is equal to the callee
+    CacheState.idle_reload_rows = TRUE;
+    if ( CacheState.idle_timeout == 0 ) {
+        CacheState.idle_timeout = g_timeout_add ( 1000 / 10, rofi_view_reload_idle, NULL );
+    }
+}
+
+void rofi_view_icons_ready ( void )
+{
+    if ( current_active_menu && current_active_menu->list_view ) {
+        widget_queue_redraw ( WIDGET ( current_active_menu->list_view ) );
+        rofi_view_queue_redraw ();
+    }
+}
+
+void rofi_view_rows_changed ( gboolean reload )
+{
+    if ( current_active_menu ) {
+        if ( reload ) {
+            current_active_menu->reload = TRUE;
+        }
+        current_active_menu->refilter = TRUE;
+        rofi_view_queue_redraw ();
+    }
+}
+
+void rofi_view_append ( void  )
+{
     if ( CacheState.idle_timeout == 0 ) {
         CacheState.idle_timeout = g_timeout_add ( 1000 / 10, rofi_view_reload_idle, NULL );
     }
@@ -973,6 +1009,13 @@ static void update_callback ( textbox *t,icon *ico, unsigned int index, void *ud
     }
 }
 
+static void prefetch_callback ( icon *ico, unsigned int index, void *udata )
+{
+    RofiViewState *state = (RofiViewState *) udata;
+    // Only queues the icon, it is picked up when the row is drawn.
+    mode_get_icon ( state->sw, state->line_map[index], widget_get_desired_height ( WIDGET ( ico ) ) );
+}
+
 void rofi_view_update ( RofiViewState *state, gboolean qr )
 {
     if ( !widget_need_redraw ( WIDGET ( state->main_window ) ) ) {
@@ -1023,86 +1066,80 @@ static void _rofi_view_reload_row ( RofiViewState *state )
     rofi_view_reload_message_bar ( state );
 }
 
-static void rofi_view_refilter ( RofiViewState *state )
+/**
+ * @param state   The Menu Handle
+ * @param start   First (unfiltered) row to match.
+ * @param stop    Row after the last row to match.
+ * @param pattern The preprocessed input, used for sorting.
+ * @param plen    The length of pattern in characters.
+ *
+ * Match the rows [start, stop) against the current tokens and append the matching rows
+ * to state->line_map at position state->filtered_lines.
+ * Row indexes in line_map at or beyond start are used as scratch space.
+ *
+ * @returns the number of matched rows.
+ */
+static unsigned int rofi_view_filter_rows ( RofiViewState *state, unsigned int start, unsigned int stop, const char *pattern, glong plen )
 {
-    TICK_N ( "Filter start" );
-    if ( state->reload ) {
-        _rofi_view_reload_row ( state );
-        state->reload = FALSE;
-    }
-    TICK_N ("Filter reload rows");
-    if ( state->tokens ) {
-        helper_tokenize_free ( state->tokens );
-        state->tokens = NULL;
-    }
-    TICK_N ("Filter tokenize");
-    if ( state->text && strlen ( state->text->text ) > 0 ) {
-        unsigned int j        = 0;
-        gchar        *pattern = mode_preprocess_input ( state->sw, state->text->text );
-        glong        plen     = pattern ? g_utf8_strlen ( pattern, -1 ) : 0;
-        state->tokens = helper_tokenize ( pattern, config.case_sensitive );
-        /**
-         * On long lists it can be beneficial to parallelize.
-         * If number of threads is 1, no thread is spawn.
-         * If number of threads > 1 and there are enough (> 1000) items, spawn jobs for the thread pool.
-         * For large lists with 8 threads I see a factor three speedup of the whole function.
-         */
-        unsigned int      nt = MAX ( 1, state->num_lines / 500 );
-        thread_state_view states[nt];
-        GCond             cond;
-        GMutex            mutex;
-        g_mutex_init ( &mutex );
-        g_cond_init ( &cond );
-        unsigned int count = nt;
-        unsigned int steps = ( state->num_lines + nt ) / nt;
-        for ( unsigned int i = 0; i < nt; i++ ) {
-            states[i].state       = state;
-            states[i].start       = i * steps;
-            states[i].stop        = MIN ( state->num_lines, ( i + 1 ) * steps );
-            states[i].count       = 0;
-            states[i].cond        = &cond;
-            states[i].mutex       = &mutex;
-            states[i].acount      = &count;
-            states[i].plen        = plen;
-            states[i].pattern     = pattern;
-            states[i].st.callback = filter_elements;
-            if ( i > 0 ) {
-                g_thread_pool_push ( tpool, &states[i], NULL );
-            }
-        }
-        // Run one in this thread.
-        rofi_view_call_thread ( &states[0], NULL );
-        // No need to do this with only one thread.
-        if ( nt > 1 ) {
-            g_mutex_lock ( &mutex );
-            while ( count > 0 ) {
-                g_cond_wait ( &cond, &mutex );
-            }
-            g_mutex_unlock ( &mutex );
-        }
-        g_cond_clear ( &cond );
-        g_mutex_clear ( &mutex );
-        for ( unsigned int i = 0; i < nt; i++ ) {
-            if ( j != states[i].start ) {
-                memmove ( &( state->line_map[j] ), &( state->line_map[states[i].start] ), sizeof ( unsigned int ) * ( states[i].count ) );
-            }
-            j += states[i].count;
+    unsigned int j = state->filtered_lines;
+    /**
+     * On long lists it can be beneficial to parallelize.
+     * If number of threads is 1, no thread is spawn.
+     * If number of threads > 1 and there are enough (> 1000) items, spawn jobs for the thread pool.
+     * For large lists with 8 threads I see a factor three speedup of the whole function.
+     */
+    unsigned int      nrows = stop - start;
+    unsigned int      nt    = MAX ( 1, nrows / 500 );
+    thread_state_view states[nt];
+    GCond             cond;
+    GMutex            mutex;
+    g_mutex_init ( &mutex );
+    g_cond_init ( &cond );
+    unsigned int count = nt;
+    unsigned int steps = ( nrows + nt ) / nt;
+    for ( unsigned int i = 0; i < nt; i++ ) {
+        states[i].state       = state;
+        states[i].start       = start + i * steps;
+        states[i].stop        = MIN ( stop, start + ( i + 1 ) * steps );
+        states[i].count       = 0;
+        states[i].cond        = &cond;
+        states[i].mutex       = &mutex;
+        states[i].acount      = &count;
+        states[i].plen        = plen;
+        states[i].pattern     = pattern;
+        states[i].st.callback = filter_elements;
+        if ( i > 0 ) {
+            g_thread_pool_push ( tpool, &states[i], NULL );
         }
-        if ( config.sort ) {
-            g_qsort_with_data ( state->line_map, j, sizeof ( int ), lev_sort, state->distance );
+    }
+    // Run one in this thread.
+    rofi_view_call_thread ( &states[0], NULL );
+    // No need to do this with only one thread.
+    if ( nt > 1 ) {
+        g_mutex_lock ( &mutex );
+        while ( count > 0 ) {
+            g_cond_wait ( &cond, &mutex );
         }
-
-        // Cleanup + bookkeeping.
-        state->filtered_lines = j;
-        g_free ( pattern );
+        g_mutex_unlock ( &mutex );
     }
-    else{
-        for ( unsigned int i = 0; i < state->num_lines; i++ ) {
-            state->line_map[i] = i;
+    g_cond_clear ( &cond );
+    g_mutex_clear ( &mutex );
+    for ( unsigned int i = 0; i < nt; i++ ) {
+        if ( j != states[i].start ) {
+            memmove ( &( state->line_map[j] ), &( state->line_map[states[i].start] ), sizeof ( unsigned int ) * ( states[i].count ) );
         }
-        state->filtered_lines = state->num_lines;
+        j += states[i].count;
     }
-    TICK_N ("Filter matching done");
+    return j - state->filtered_lines;
+}
+
+/**
+ * @param state The Menu Handle
+ *
+ * Update the row counters, auto-select and window size after the filtered list changed.
+ */
+static void rofi_view_filter_update ( RofiViewState *state )
+{
     listview_set_num_elements ( state->list_view, state->filtered_lines );
 
     if ( state->tb_filtered_rows ) {
@@ -1134,9 +1171,110 @@ static void rofi_view_refilter ( RofiViewState *state )
         g_debug ( "Resize based on re-filter" );
     }
     TICK_N ("Filter resize window based on window ");
+}
+
+static void rofi_view_refilter ( RofiViewState *state )
+{
+    TICK_N ( "Filter start" );
+    if ( state->reload || state->append ) {
+        _rofi_view_reload_row ( state );
+        state->reload = FALSE;
+        state->append = FALSE;
+    }
+    TICK_N ("Filter reload rows");
+    if ( state->tokens ) {
+        helper_tokenize_free ( state->tokens );
+        state->tokens = NULL;
+    }
+    TICK_N ("Filter tokenize");
+    if ( state->text && strlen ( state->text->text ) > 0 ) {
+        gchar        *pattern = mode_preprocess_input ( state->sw, state->text->text );
+        glong        plen     = pattern ? g_utf8_strlen ( pattern, -1 ) : 0;
+        state->tokens = helper_tokenize ( pattern, config.case_sensitive );
+
+        state->filtered_lines = 0;
+        unsigned int j = rofi_view_filter_rows ( state, 0, state->num_lines, pattern, plen );
+        if ( config.sort ) {
+            g_qsort_with_data ( state->line_map, j, sizeof ( int ), lev_sort, state->distance );
+        }
+
+        // Cleanup + bookkeeping.
+        state->filtered_lines = j;
+        g_free ( pattern );
+    }
+    else{
+        for ( unsigned int i = 0; i < state->num_lines; i++ ) {
+            state->line_map[i] = i;
+        }
+        state->filtered_lines = state->num_lines;
+    }
+    TICK_N ("Filter matching done");
+    rofi_view_filter_update ( state );
     state->refilter = FALSE;
     TICK_N ( "Filter done" );
 }
+
+/**
+ * @param state The Menu Handle
+ *
+ * The mode appended rows to the end of its list, match only the new rows against the
+ * current tokens and merge them into the filtered list.
+ */
+static void rofi_view_refilter_append ( RofiViewState *state )
+{
+    TICK_N ( "Filter append start" );
+    unsigned int old_lines = state->num_lines;
+    unsigned int num_lines = mode_get_num_entries ( state->sw );
+    state->append = FALSE;
+    if ( num_lines < old_lines ) {
+        // Rows got removed, this is not an append.
+        state->reload = TRUE;
+        rofi_view_refilter ( state );
+        return;
+    }
+    if ( num_lines == old_lines ) {
+        return;
+    }
+    state->num_lines = num_lines;
+    state->line_map  = g_realloc_n ( state->line_map, num_lines, sizeof ( unsigned int ) );
+    state->distance  = g_realloc_n ( state->distance, num_lines, sizeof ( int ) );
+    memset ( &( state->distance[old_lines] ), 0, ( num_lines - old_lines ) * sizeof ( int ) );
+    listview_set_max_lines ( state->list_view, state->num_lines );
+    rofi_view_reload_message_bar ( state );
+
+    if ( state->text && strlen ( state->text->text ) > 0 ) {
+        gchar        *pattern = mode_preprocess_input ( state->sw, state->text->text );
+        glong        plen     = pattern ? g_utf8_strlen ( pattern, -1 ) : 0;
+        unsigned int old      = state->filtered_lines;
+        unsigned int n        = rofi_view_filter_rows ( state, old_lines, num_lines, pattern, plen );
+        if ( config.sort && n > 0 ) {
+            unsigned int *new_rows = g_memdup ( &( state->line_map[old] ), n * sizeof ( unsigned int ) );
+            g_qsort_with_data ( new_rows, n, sizeof ( int ), lev_sort, state->distance );
+            // Merge back to front, on equal distance the older row goes first.
+            unsigned int a = old, b = n, k = old + n;
+            while ( b > 0 ) {
+                if ( a > 0 && state->distance[state->line_map[a - 1]] > state->distance[new_rows[b - 1]] ) {
+                    state->line_map[--k] = state->line_map[--a];
+                }
+                else {
+                    state->line_map[--k] = new_rows[--b];
+                }
+            }
+            g_free ( new_rows );
+        }
+        state->filtered_lines = old + n;
+        g_free ( pattern );
+    }
+    else {
+        for ( unsigned int i = old_lines; i < num_lines; i++ ) {
+            state->line_map[i] = i;
+        }
+        state->filtered_lines = num_lines;
+    }
+    TICK_N ("Filter append matching done");
+    rofi_view_filter_update ( state );
+    TICK_N ( "Filter append done" );
+}
 /**
  * @param state The Menu Handle
  *
@@ -1450,6 +1588,9 @@ void rofi_view_maybe_update ( RofiViewState *state )
     if ( state->refilter ) {
         rofi_view_refilter ( state );
     }
+    else if ( state->append ) {
+        rofi_view_refilter_append ( state );
+    }
     rofi_view_update ( state, TRUE );
 }
 
@@ -1700,6 +1841,7 @@ static void rofi_view_add_widget ( RofiViewState *state, widget *parent_widget,
         listview_set_multi_select ( state->list_view, ( state->menu_flags & MENU_INDICATOR ) == MENU_INDICATOR );
         listview_set_scroll_type ( state->list_view, config.scroll_method );
         listview_set_mouse_activated_cb ( state->list_view, rofi_view_listview_mouse_activated_cb, state );
+        listview_set_prefetch_cb ( state->list_view, prefetch_callback, state );
 
         int lines = rofi_theme_get_integer ( WIDGET ( state->list_view ), "lines", config.menu_lines );
         listview_set_num_lines ( state->list_view, lines );
@@ -90,11 +90,17 @@ static void icon_draw ( widget *wid, cairo_t *draw )
     int tpad = widget_padding_get_top    ( WIDGET ( b ) ) ;
     int bpad = widget_padding_get_bottom ( WIDGET ( b ) ) ;
 
+    double x = lpad + ( b->widget.w - iconw * scale - lpad -rpad )*b->xalign;
+    double y = tpad + ( b->widget.h- iconh * scale -tpad - bpad )*b->yalign;
+    if ( icons == b->size ) {
+        // The fetcher scaled it already, keep it on whole pixels so it is copied, not resampled.
+        x = (int) ( x + 0.5 );
+        y = (int) ( y + 0.5 );
+    }
+
     cairo_save ( draw );
 
-    cairo_translate ( draw,
-            lpad + ( b->widget.w - iconw * scale - lpad -rpad )*b->xalign,
-            tpad + ( b->widget.h- iconh * scale -tpad - bpad )*b->yalign );
+    cairo_translate ( draw, x, y );
     cairo_scale ( draw, scale, scale );
     cairo_set_source_surface ( draw, b->icon, 0, 0 );
     cairo_paint ( draw );
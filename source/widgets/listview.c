@@ -38,6 +38,7 @@
 #include "theme.h"
 
 #include "timings.h"
+#include "rofi-icon-fetcher.h"
 
 /** Default spacing between the elements in the listview. */
 #define DEFAULT_SPACING    2
@@ -119,6 +120,9 @@ struct _listview
     listview_mouse_activated_cb mouse_activated;
     void                        *mouse_activated_data;
 
+    listview_prefetch_cb        prefetch;
+    void                        *prefetch_data;
+
     char                        *listview_name;
 
 
@@ -386,6 +390,30 @@ static void barview_draw ( widget *wid, cairo_t *draw )
     }
 }
 
+/**
+ * @param lv The listview.
+ * @param offset The first visible element.
+ * @param max The number of visible elements.
+ *
+ * Request the icons of the page after and before the visible elements, after the visible ones.
+ */
+static void listview_prefetch ( listview *lv, unsigned int offset, unsigned int max )
+{
+    if ( lv->prefetch == NULL || lv->boxes[0].icon == NULL ) {
+        return;
+    }
+    rofi_icon_fetcher_set_prefetch ( TRUE );
+    unsigned int end = MIN ( lv->req_elements, offset + max + lv->cur_elements );
+    for ( unsigned int i = offset + max; i < end; i++ ) {
+        lv->prefetch ( lv->boxes[0].icon, i, lv->prefetch_data );
+    }
+    unsigned int start = offset > lv->cur_elements ? ( offset - lv->cur_elements ) : 0;
+    for ( unsigned int i = offset; i > start; i-- ) {
+        lv->prefetch ( lv->boxes[0].icon, i - 1, lv->prefetch_data );
+    }
+    rofi_icon_fetcher_set_prefetch ( FALSE );
+}
+
 static void listview_draw ( widget *wid, cairo_t *draw )
 {
     unsigned int offset = 0;
@@ -420,6 +448,8 @@ static void listview_draw ( widget *wid, cairo_t *draw )
         // Set new x/y position.
         unsigned int max = MIN ( lv->cur_elements, lv->req_elements - offset );
         if ( lv->rchanged ) {
+            // Other rows are visible now, their icons go first.
+            rofi_icon_fetcher_visible_changed ();
             unsigned int width = lv->widget.w;
             width -= widget_padding_get_padding_width ( wid );
             if ( widget_enabled ( WIDGET ( lv->scrollbar ) ) ) {
@@ -457,6 +487,7 @@ static void listview_draw ( widget *wid, cairo_t *draw )
                 update_element ( lv, i, i + offset, TRUE );
                 widget_draw ( WIDGET ( lv->boxes[i].box ), draw );
             }
+            listview_prefetch ( lv, offset, max );
             lv->rchanged = FALSE;
 
         }
@@ -923,6 +954,13 @@ void listview_set_mouse_activated_cb ( listview *lv, listview_mouse_activated_cb
         lv->mouse_activated_data = udata;
     }
 }
+void listview_set_prefetch_cb ( listview *lv, listview_prefetch_cb cb, void *udata )
+{
+    if ( lv ) {
+        lv->prefetch      = cb;
+        lv->prefetch_data = udata;
+    }
+}
 void listview_set_multi_select ( listview *lv, gboolean enable )
 {
     if ( lv ) {
@@ -320,7 +320,7 @@ void textbox_text ( textbox *tb, const char *text )
     g_free ( tb->text );
     const gchar *last_pointer = NULL;
 
-    if ( g_utf8_validate ( text, -1, &last_pointer ) ) {
+    if ( rofi_utf8_validate ( text, -1, &last_pointer ) ) {
         tb->text = g_strdup ( text );
     }
     else {
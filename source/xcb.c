@@ -63,6 +63,7 @@
 #include "timings.h"
 
 #include <rofi.h>
+#include "dialogs/window.h"
 
 /** Minimal randr prefered for running rofi (1.5) (Major version number) */
 #define RANDR_PREF_MAJOR_VERSION    1
@@ -220,8 +221,17 @@ cairo_surface_t * x11_helper_get_bg_surface ( void )
 // technically we could use window_get_prop(), but this is better for character set support
 char* window_get_text_prop ( xcb_window_t w, xcb_atom_t atom )
 {
-    xcb_get_property_cookie_t c  = xcb_get_property ( xcb->connection, 0, w, atom, XCB_GET_PROPERTY_TYPE_ANY, 0, UINT_MAX );
-    xcb_get_property_reply_t  *r = xcb_get_property_reply ( xcb->connection, c, NULL );
+    return window_get_text_prop_reply ( window_get_text_prop_cookie ( w, atom ) );
+}
+
+xcb_get_property_cookie_t window_get_text_prop_cookie ( xcb_window_t w, xcb_atom_t atom )
+{
+    return xcb_get_property ( xcb->connection, 0, w, atom, XCB_GET_PROPERTY_TYPE_ANY, 0, UINT_MAX );
+}
+
+char* window_get_text_prop_reply ( xcb_get_property_cookie_t c )
+{
+    xcb_get_property_reply_t *r = xcb_get_property_reply ( xcb->connection, c, NULL );
     if ( r ) {
         if ( xcb_get_property_value_length ( r ) > 0 ) {
             char *str = NULL;
@@ -942,6 +952,11 @@ static void main_loop_x11_event_handler_view ( xcb_generic_event_t *event )
         }
         break;
     }
+#ifdef WINDOW_MODE
+    case XCB_PROPERTY_NOTIFY:
+        window_mode_property_notify ( (xcb_property_notify_event_t *) event );
+        break;
+#endif
     // Paste event.
     case XCB_SELECTION_NOTIFY:
         rofi_view_paste ( state, (xcb_selection_notify_event_t *) event );
@@ -229,6 +229,8 @@ static XrmOption xrmOptions[] = {
       "DRUN: build and use a cache with desktop file content.", CONFIG_DEFAULT },
     { xrm_Boolean,  "drun-reload-desktop-cache",   { .snum  = &config.drun_reload_desktop_cache}, NULL,
       "DRUN: If enabled, reload the cache with desktop file content.", CONFIG_DEFAULT },
+    { xrm_Boolean,  "run-use-path-cache",       { .snum  = &config.run_use_path_cache          }, NULL,
+      "RUN: Cache the executables found per PATH directory.", CONFIG_DEFAULT },
 };
 
 /** Dynamic array of extra options */
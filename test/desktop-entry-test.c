@@ -0,0 +1,151 @@
+/*
+ * rofi
+ *
+ * MIT/X11 License
+ * Copyright © 2013-2017 Qball Cow <qball@gmpclient.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+#include "rofi-desktop-entry.h"
+
+static unsigned int test = 0;
+
+#define TASSERT( a )    {                                \
+        assert ( a );                                    \
+        printf ( "Test %u passed (%s)\n", ++test, # a ); \
+}
+
+static RofiDesktopEntry *load ( const char *contents )
+{
+    char  *path = NULL;
+    int   fd    = g_file_open_tmp ( "rofi-desktop-entry-XXXXXX.desktop", &path, NULL );
+    g_assert ( fd >= 0 );
+    close ( fd );
+    g_assert ( g_file_set_contents ( path, contents, -1, NULL ) );
+    RofiDesktopEntry *de = rofi_desktop_entry_load ( path, NULL );
+    unlink ( path );
+    g_free ( path );
+    return de;
+}
+
+static gboolean str_equal ( char *str, const char *expected )
+{
+    gboolean retv = g_strcmp0 ( str, expected ) == 0;
+    g_free ( str );
+    return retv;
+}
+
+static void desktop_entry_test ( void )
+{
+    RofiDesktopEntry *de = load ( "# Comment\n"
+                                  "\n"
+                                  "[Desktop Entry]\n"
+                                  "Type=Application\n"
+                                  "Name=Editor\n"
+                                  "Name[nl]=Tekst\\sverwerker\n"
+                                  "Name[nl_NL]=Verwerker\n"
+                                  "Name[de]=Bearbeiter\n"
+                                  "GenericName[de]=Nur Deutsch\n"
+                                  "Comment = spaced\r\n"
+                                  "Keywords=edit;text\\;plain;;\n"
+                                  "Keywords[nl]=bewerk;\n"
+                                  "Terminal=true \n"
+                                  "NoDisplay=false\n"
+                                  "Actions=new;\n"
+                                  "\n"
+                                  "[Desktop Action new]\n"
+                                  "Name=New Window\n"
+                                  "Exec=editor --new\n"
+                                  "\n"
+                                  "[Other Group]\n"
+                                  "Name=Skipped\n" );
+    TASSERT ( de != NULL );
+    TASSERT ( rofi_desktop_entry_has_group ( de, "Desktop Entry" ) );
+    TASSERT ( rofi_desktop_entry_has_group ( de, "Desktop Action new" ) );
+    TASSERT ( !rofi_desktop_entry_has_group ( de, "Other Group" ) );
+    TASSERT ( rofi_desktop_entry_has_key ( de, "Desktop Entry", "Name" ) );
+    TASSERT ( !rofi_desktop_entry_has_key ( de, "Desktop Entry", "GenericName" ) );
+    TASSERT ( !rofi_desktop_entry_has_key ( de, "Desktop Entry", "Exec" ) );
+    TASSERT ( str_equal ( rofi_desktop_entry_get_string ( de, "Desktop Entry", "Type" ), "Application" ) );
+    TASSERT ( str_equal ( rofi_desktop_entry_get_string ( de, "Desktop Entry", "Name" ), "Editor" ) );
+    // Best match in LANGUAGE order, other translations are ignored.
+    TASSERT ( str_equal ( rofi_desktop_entry_get_locale_string ( de, "Desktop Entry", "Name" ), "Verwerker" ) );
+    TASSERT ( str_equal ( rofi_desktop_entry_get_locale_string ( de, "Desktop Entry", "GenericName" ), NULL ) );
+    TASSERT ( str_equal ( rofi_desktop_entry_get_locale_string ( de, "Desktop Entry", "Comment" ), "spaced" ) );
+    TASSERT ( str_equal ( rofi_desktop_entry_get_string ( de, "Desktop Action new", "Exec" ), "editor --new" ) );
+    TASSERT ( str_equal ( rofi_desktop_entry_get_locale_string ( de, "Desktop Action new", "Name" ), "New Window" ) );
+    TASSERT ( rofi_desktop_entry_get_boolean ( de, "Desktop Entry", "Terminal" ) );
+    TASSERT ( !rofi_desktop_entry_get_boolean ( de, "Desktop Entry", "NoDisplay" ) );
+    TASSERT ( !rofi_desktop_entry_get_boolean ( de, "Desktop Entry", "Hidden" ) );
+
+    gsize length = 0;
+    char  **list = rofi_desktop_entry_get_string_list ( de, "Desktop Entry", "Keywords", &length );
+    TASSERT ( length == 3 );
+    TASSERT ( strcmp ( list[1], "text;plain" ) == 0 );
+    TASSERT ( strcmp ( list[2], "" ) == 0 );
+    TASSERT ( list[3] == NULL );
+    g_strfreev ( list );
+    list = rofi_desktop_entry_get_locale_string_list ( de, "Desktop Entry", "Keywords", &length );
+    TASSERT ( length == 1 );
+    TASSERT ( strcmp ( list[0], "bewerk" ) == 0 );
+    g_strfreev ( list );
+    list = rofi_desktop_entry_get_string_list ( de, "Desktop Entry", "Categories", &length );
+    TASSERT ( list == NULL && length == 0 );
+    rofi_desktop_entry_free ( de );
+
+    // Invalid files.
+    TASSERT ( load ( "Name=No group\n[Desktop Entry]\n" ) == NULL );
+    TASSERT ( load ( "[Desktop Entry]\nNot a key\n" ) == NULL );
+    TASSERT ( load ( "[Desktop Entry\nName=x\n" ) == NULL );
+    TASSERT ( rofi_desktop_entry_load ( "/nonexisting/rofi.desktop", NULL ) == NULL );
+
+    // Only 'true' is true, as for GKeyFile.
+    de = load ( "[Desktop Entry]\nTerminal=1\nNoDisplay=True\nHidden=true\nName=a\nName=b\n" );
+    TASSERT ( de != NULL );
+    TASSERT ( !rofi_desktop_entry_get_boolean ( de, "Desktop Entry", "Terminal" ) );
+    TASSERT ( !rofi_desktop_entry_get_boolean ( de, "Desktop Entry", "NoDisplay" ) );
+    TASSERT ( rofi_desktop_entry_get_boolean ( de, "Desktop Entry", "Hidden" ) );
+    // A repeated key keeps the last value.
+    TASSERT ( str_equal ( rofi_desktop_entry_get_string ( de, "Desktop Entry", "Name" ), "b" ) );
+    rofi_desktop_entry_free ( de );
+
+    // Invalid UTF-8 is not returned.
+    de = load ( "[Desktop Entry]\nName=\xff\xfe\nExec=x" );
+    TASSERT ( de != NULL );
+    TASSERT ( str_equal ( rofi_desktop_entry_get_string ( de, "Desktop Entry", "Name" ), NULL ) );
+    TASSERT ( str_equal ( rofi_desktop_entry_get_string ( de, "Desktop Entry", "Exec" ), "x" ) );
+    rofi_desktop_entry_free ( de );
+
+    rofi_desktop_entry_free ( NULL );
+}
+
+int main ( G_GNUC_UNUSED int argc, G_GNUC_UNUSED char **argv )
+{
+    g_setenv ( "LANGUAGE", "nl_NL:nl", TRUE );
+    desktop_entry_test ();
+    return 0;
+}
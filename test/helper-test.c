@@ -137,6 +137,53 @@ int main ( int argc, char ** argv )
         TASSERT ( g_utf8_collate ( str, "Valid utf8 until �( we continue here" ) == 0 );
         g_free ( str );
     }
+    {
+        // Every alpha and channel value, against the rounded division.
+        uint32_t *src = g_new ( uint32_t, 256 * 256 + 1 );
+        uint32_t *dst = g_new ( uint32_t, 256 * 256 + 1 );
+        for ( uint32_t a = 0; a < 256; a++ ) {
+            for ( uint32_t c = 0; c < 256; c++ ) {
+                src[a * 256 + c] = ( a << 24 ) | ( c << 16 ) | ( ( 255 - c ) << 8 ) | ( c ^ 0x5a );
+            }
+        }
+        src[256 * 256] = 0x80ff00ffu;
+        unsigned int errors = 0;
+        // Once with a tail that is not a multiple of 4, once from an unaligned start.
+        for ( uint32_t shift = 0; shift < 2; shift++ ) {
+            size_t len = 256 * 256 + 1 - shift;
+            rofi_premultiply_argb ( dst, src + shift, len );
+            for ( size_t i = 0; i < len; i++ ) {
+                uint32_t p = src[i + shift];
+                uint32_t a = p >> 24;
+                uint32_t expected = p & 0xff000000u;
+                for ( uint32_t s = 0; s < 24; s += 8 ) {
+                    expected |= ( ( ( ( p >> s ) & 0xff ) * a + 127 ) / 255 ) << s;
+                }
+                if ( dst[i] != expected ) {
+                    errors++;
+                }
+            }
+        }
+        TASSERT ( errors == 0 );
+        g_free ( src );
+        g_free ( dst );
+    }
+    {
+        const char *end = NULL;
+        const char *in  = "A long enough ASCII prefix to hit the vector path €uro ¡µ 😀";
+        TASSERT ( rofi_utf8_validate ( in, -1, &end ) == TRUE );
+        TASSERT ( end == ( in + strlen ( in ) ) );
+        // Surrogate, overlong, out of range, truncated and embedded nul.
+        const char *invalid[] = { "A long enough ASCII prefix \xed\xa0\x80", "A long enough ASCII prefix \xc0\xaf",
+                                  "A long enough ASCII prefix \xf4\x90\x80\x80", "A long enough ASCII prefix \xe2\x82" };
+        for ( unsigned int i = 0; i < G_N_ELEMENTS ( invalid ); i++ ) {
+            TASSERT ( rofi_utf8_validate ( invalid[i], -1, &end ) == FALSE );
+            TASSERT ( end == ( invalid[i] + 27 ) );
+            TASSERT ( g_utf8_validate ( invalid[i], -1, NULL ) == FALSE );
+        }
+        TASSERT ( rofi_utf8_validate ( "nul\0byte", 8, &end ) == FALSE );
+        TASSERT ( rofi_utf8_validate ( "nul\0byte", -1, &end ) == TRUE );
+    }
     {
         TASSERT ( utf8_strncmp ( "aapno", "aap€",3) == 0 );
         TASSERT ( utf8_strncmp ( "aapno", "aap€",4) != 0 );
@@ -137,6 +137,32 @@ START_TEST ( test_tokenizer_match_normal_multiple_ci_negate )
 }
 END_TEST
 
+START_TEST ( test_tokenizer_match_normal_folded )
+{
+    config.matching_method = MM_NORMAL;
+    rofi_int_matcher **tokens = helper_tokenize ( "-Noot AAP", FALSE );
+    ck_assert_ptr_ne ( tokens[0]->folded, NULL );
+    ck_assert_int_eq ( helper_token_match_folded ( tokens, "Aap Noot", "aap noot" ) , FALSE );
+    ck_assert_int_eq ( helper_token_match_folded ( tokens, "Aap Mies", "aap mies" ) , TRUE );
+    ck_assert_int_eq ( helper_token_match_folded ( tokens, "Mies", "mies" ) , FALSE );
+    // Without a folded row the caseless regex is used.
+    ck_assert_int_eq ( helper_token_match_folded ( tokens, "Aap Mies", NULL ) , TRUE );
+    helper_tokenize_free ( tokens );
+
+    tokens = helper_tokenize ( "Noot", TRUE );
+    ck_assert_ptr_eq ( tokens[0]->folded, NULL );
+    ck_assert_int_eq ( helper_token_match_folded ( tokens, "aap noot", "aap noot" ) , FALSE );
+    ck_assert_int_eq ( helper_token_match_folded ( tokens, "aap Noot", "aap noot" ) , TRUE );
+    helper_tokenize_free ( tokens );
+
+    // A user regex is not folded.
+    config.matching_method = MM_REGEX;
+    tokens = helper_tokenize ( "\\W", FALSE );
+    ck_assert_ptr_eq ( tokens[0]->folded, NULL );
+    helper_tokenize_free ( tokens );
+}
+END_TEST
+
 START_TEST ( test_tokenizer_match_glob_single_ci )
 {
     config.matching_method = MM_GLOB;
@@ -411,6 +437,7 @@ static Suite * helper_tokenizer_suite (void)
         tcase_add_test(tc_normal, test_tokenizer_match_normal_multiple_ci );
         tcase_add_test(tc_normal, test_tokenizer_match_normal_single_ci_negate );
         tcase_add_test(tc_normal, test_tokenizer_match_normal_multiple_ci_negate);
+        tcase_add_test(tc_normal, test_tokenizer_match_normal_folded);
         suite_add_tcase(s, tc_normal);
     }
     {
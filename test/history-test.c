@@ -30,6 +30,7 @@
 #include <stdio.h>
 #include <assert.h>
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <history.h>
 #include <string.h>
 
@@ -41,10 +42,12 @@ static unsigned int test = 0;
 }
 
 const char *file = "text";
+const char *index_file = "text.idx";
 
 static void history_test ( void )
 {
     unlink ( file );
+    unlink ( index_file );
 
     // Empty list.
     unsigned int length = 0;
@@ -115,11 +118,140 @@ static void history_test ( void )
     g_strfreev ( retv );
 
     unlink ( file );
+    unlink ( index_file );
+}
+
+static void history_log_test ( void )
+{
+    unlink ( file );
+    unlink ( index_file );
+
+    unsigned int length = 0;
+    char         **retv = NULL;
+
+    history_set ( file, "aap" );
+    history_set ( file, "noot" );
+    history_set ( file, "noot" );
+    history_set ( file, "mies" );
+    history_remove ( file, "aap" );
+
+    retv = history_get_list ( file, &length );
+    TASSERT ( length == 2 );
+    TASSERT ( g_strcmp0 ( retv[0], "noot" ) == 0 );
+    TASSERT ( g_strcmp0 ( retv[1], "mies" ) == 0 );
+    g_strfreev ( retv );
+
+    // A record that is still being written is ignored.
+    FILE *fd = fopen ( file, "a" );
+    fputs ( "+ mie", fd );
+    fclose ( fd );
+    retv = history_get_list ( file, &length );
+    TASSERT ( length == 2 );
+    TASSERT ( g_strcmp0 ( retv[1], "mies" ) == 0 );
+    g_strfreev ( retv );
+    unlink ( file );
+    unlink ( index_file );
+
+    // The log is compacted when it grows.
+    char *name = g_strnfill ( 200, 'x' );
+    history_set ( file, "aap" );
+    for ( unsigned int iter = 0; iter < 1000; iter++ ) {
+        history_set ( file, name );
+    }
+    GStatBuf st;
+    TASSERT ( g_stat ( file, &st ) == 0 );
+    TASSERT ( st.st_size < 1000 * 200 );
+    retv = history_get_list ( file, &length );
+    TASSERT ( length == 2 );
+    TASSERT ( g_strcmp0 ( retv[0], name ) == 0 );
+    TASSERT ( g_strcmp0 ( retv[1], "aap" ) == 0 );
+    g_strfreev ( retv );
+    g_free ( name );
+
+    unlink ( file );
+    unlink ( index_file );
+}
+
+static void history_index_test ( void )
+{
+    HistoryIndexEntry entry;
+
+    unlink ( file );
+    unlink ( index_file );
+
+    HistoryIndex *index = history_index_open ( file );
+    TASSERT ( index == NULL );
+    TASSERT ( history_index_get_length ( index ) == 0 );
+    TASSERT ( history_index_lookup ( index, "aap", &entry ) == FALSE );
+
+    history_set ( file, "aap" );
+    history_set ( file, "noot" );
+    history_set ( file, "noot" );
+
+    index = history_index_open ( file );
+    TASSERT ( index != NULL );
+    TASSERT ( g_file_test ( index_file, G_FILE_TEST_EXISTS ) );
+    TASSERT ( history_index_get_length ( index ) == 2 );
+    TASSERT ( g_strcmp0 ( history_index_get_entry ( index, 0 ), "noot" ) == 0 );
+    TASSERT ( history_index_get_entry ( index, 2 ) == NULL );
+    TASSERT ( history_index_lookup ( index, "noot", &entry ) );
+    TASSERT ( entry.rank == 0 );
+    TASSERT ( history_index_lookup ( index, "aap", &entry ) );
+    TASSERT ( entry.rank == 1 );
+    TASSERT ( history_index_lookup ( index, "mies", NULL ) == FALSE );
+    history_index_close ( index );
+
+    // The index on disk is used while the history is unchanged.
+    index = history_index_open ( file );
+    TASSERT ( history_index_lookup ( index, "aap", &entry ) );
+    TASSERT ( entry.rank == 1 );
+    history_index_close ( index );
+
+    // And rebuilt when it changed.
+    history_set ( file, "aap" );
+    history_set ( file, "aap" );
+    history_set ( file, "aap" );
+    history_set ( file, "mies" );
+    index = history_index_open ( file );
+    TASSERT ( history_index_get_length ( index ) == 3 );
+    TASSERT ( history_index_lookup ( index, "aap", &entry ) );
+    TASSERT ( entry.rank == 0 );
+    TASSERT ( history_index_lookup ( index, "noot", &entry ) );
+    TASSERT ( entry.rank == 2 );
+    history_index_close ( index );
+
+    // A corrupt index is rebuilt.
+    g_file_set_contents ( index_file, "rofihidx", -1, NULL );
+    index = history_index_open ( file );
+    TASSERT ( history_index_get_length ( index ) == 3 );
+    history_index_close ( index );
+
+    // An index without empty buckets is rebuilt, lookups would never terminate.
+    gchar *data = NULL;
+    gsize size  = 0;
+    TASSERT ( g_file_get_contents ( index_file, &data, &size, NULL ) );
+    uint32_t num_entries, num_buckets;
+    // Header is 72 bytes, counts at offset 12 and 16, records are 24 bytes.
+    memcpy ( &num_entries, data + 12, sizeof ( uint32_t ) );
+    memcpy ( &num_buckets, data + 16, sizeof ( uint32_t ) );
+    TASSERT ( 72 + num_entries * 24 + num_buckets * sizeof ( uint32_t ) < size );
+    memset ( data + 72 + num_entries * 24, 0, num_buckets * sizeof ( uint32_t ) );
+    TASSERT ( g_file_set_contents ( index_file, data, size, NULL ) );
+    g_free ( data );
+    index = history_index_open ( file );
+    TASSERT ( history_index_lookup ( index, "wim", NULL ) == FALSE );
+    TASSERT ( history_index_lookup ( index, "mies", &entry ) );
+    history_index_close ( index );
+
+    unlink ( file );
+    unlink ( index_file );
 }
 
 int main (  G_GNUC_UNUSED int argc, G_GNUC_UNUSED char **argv )
 {
     history_test ();
+    history_log_test ();
+    history_index_test ();
 
     return 0;
 }
@@ -0,0 +1,19 @@
+#!/usr/bin/env bash
+
+# -dump should not need a display.
+unset DISPLAY
+
+OUTPUT=$( echo -e -n "aap\nnoot\nmies\nnoot mies" | rofi -dmenu -dump -filter "noot" | tr '\n' ' ' )
+if [ "${OUTPUT}" != 'noot noot mies ' ]
+then
+    echo "Got: '${OUTPUT}' expected 'noot noot mies '"
+    exit 1
+fi
+
+OUTPUT=$( echo -e -n "noot mies\nnoot\naap" | rofi -dmenu -dump -sort -filter "noot" -format i | tr '\n' ' ' )
+if [ "${OUTPUT}" != '1 0 ' ]
+then
+    echo "Got: '${OUTPUT}' expected '1 0 '"
+    exit 1
+fi
+exit 0
@@ -0,0 +1,117 @@
+/*
+ * rofi
+ *
+ * MIT/X11 License
+ * Copyright © 2013-2017 Qball Cow <qball@gmpclient.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <glib.h>
+#include "rofi-string-store.h"
+
+static unsigned int test = 0;
+
+#define TASSERT( a )    {                                \
+        assert ( a );                                    \
+        printf ( "Test %u passed (%s)\n", ++test, # a ); \
+}
+
+static void string_store_test ( void )
+{
+    RofiStringStore *store = rofi_string_store_new ( ROFI_STRING_STORE_PLAIN );
+    TASSERT ( rofi_string_store_get_length ( store ) == 0 );
+
+    TASSERT ( rofi_string_store_append ( store, "aap", -1 ) == 0 );
+    TASSERT ( rofi_string_store_append ( store, "noot mies", 4 ) == 1 );
+    TASSERT ( rofi_string_store_append ( store, "", 0 ) == 2 );
+    TASSERT ( rofi_string_store_get_length ( store ) == 3 );
+
+    const char *first = rofi_string_store_get ( store, 0 );
+    TASSERT ( strcmp ( first, "aap" ) == 0 );
+    TASSERT ( rofi_string_store_get_size ( store, 0 ) == 3 );
+    TASSERT ( strcmp ( rofi_string_store_get ( store, 1 ), "noot" ) == 0 );
+    TASSERT ( rofi_string_store_get_size ( store, 1 ) == 4 );
+    TASSERT ( strcmp ( rofi_string_store_get ( store, 2 ), "" ) == 0 );
+    TASSERT ( rofi_string_store_get_casefold ( store, 0 ) == NULL );
+    TASSERT ( rofi_string_store_get_sort_key ( store, 0 ) == NULL );
+
+    // Rows stay where they are while the store grows.
+    char buffer[32];
+    for ( unsigned int i = 0; i < 200000; i++ ) {
+        int l = g_snprintf ( buffer, sizeof ( buffer ), "row %u", i );
+        rofi_string_store_append ( store, buffer, l );
+    }
+    TASSERT ( rofi_string_store_get_length ( store ) == 200003 );
+    TASSERT ( rofi_string_store_get ( store, 0 ) == first );
+    TASSERT ( strcmp ( first, "aap" ) == 0 );
+    TASSERT ( strcmp ( rofi_string_store_get ( store, 200002 ), "row 199999" ) == 0 );
+    rofi_string_store_free ( store );
+
+    // Rows appended in parts, and dropping the last row.
+    store = rofi_string_store_new ( ROFI_STRING_STORE_PLAIN );
+    rofi_string_store_append_part ( store, "Fire", 4 );
+    rofi_string_store_append_part ( store, "", 0 );
+    rofi_string_store_append_part ( store, "fox", 3 );
+    TASSERT ( rofi_string_store_append_end ( store ) == 0 );
+    TASSERT ( rofi_string_store_append_end ( store ) == 1 );
+    TASSERT ( strcmp ( rofi_string_store_get ( store, 0 ), "Firefox" ) == 0 );
+    TASSERT ( rofi_string_store_get_size ( store, 0 ) == 7 );
+    TASSERT ( strcmp ( rofi_string_store_get ( store, 1 ), "" ) == 0 );
+    rofi_string_store_pop ( store );
+    TASSERT ( rofi_string_store_get_length ( store ) == 1 );
+    TASSERT ( rofi_string_store_append ( store, "alacritty", -1 ) == 1 );
+    TASSERT ( strcmp ( rofi_string_store_get ( store, 1 ), "alacritty" ) == 0 );
+    TASSERT ( strcmp ( rofi_string_store_get ( store, 0 ), "Firefox" ) == 0 );
+    rofi_string_store_free ( store );
+
+    // The columns are filled when the row is added, also when added in parts.
+    store = rofi_string_store_new ( ROFI_STRING_STORE_CASEFOLD | ROFI_STRING_STORE_SORT_KEY );
+    TASSERT ( rofi_string_store_append ( store, "Firefox", -1 ) == 0 );
+    rofi_string_store_append_part ( store, "ALA", 3 );
+    rofi_string_store_append_part ( store, "critty", 6 );
+    TASSERT ( rofi_string_store_append_end ( store ) == 1 );
+    TASSERT ( strcmp ( rofi_string_store_get ( store, 0 ), "Firefox" ) == 0 );
+    TASSERT ( strcmp ( rofi_string_store_get ( store, 1 ), "ALAcritty" ) == 0 );
+    TASSERT ( strcmp ( rofi_string_store_get_casefold ( store, 0 ), "firefox" ) == 0 );
+    TASSERT ( strcmp ( rofi_string_store_get_casefold ( store, 1 ), "alacritty" ) == 0 );
+    TASSERT ( rofi_string_store_get_sort_key ( store, 0 ) != NULL );
+    TASSERT ( strcmp ( rofi_string_store_get_sort_key ( store, 1 ), rofi_string_store_get_sort_key ( store, 0 ) ) < 0 );
+    // Popping a row drops its columns too.
+    rofi_string_store_pop ( store );
+    TASSERT ( rofi_string_store_append ( store, "Zathura", -1 ) == 1 );
+    TASSERT ( strcmp ( rofi_string_store_get ( store, 1 ), "Zathura" ) == 0 );
+    TASSERT ( strcmp ( rofi_string_store_get_casefold ( store, 1 ), "zathura" ) == 0 );
+    TASSERT ( strcmp ( rofi_string_store_get_casefold ( store, 0 ), "firefox" ) == 0 );
+    TASSERT ( strcmp ( rofi_string_store_get_sort_key ( store, 0 ), rofi_string_store_get_sort_key ( store, 1 ) ) < 0 );
+    rofi_string_store_free ( store );
+
+    rofi_string_store_free ( NULL );
+}
+
+int main ( G_GNUC_UNUSED int argc, G_GNUC_UNUSED char **argv )
+{
+    string_store_test ();
+    return 0;
+}